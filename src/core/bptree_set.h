@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <optional>
+#include <vector>
 
 #include "base/pmr/memory_resource.h"
 #include "core/detail/bptree_internal.h"
@@ -65,6 +66,12 @@ template <typename T, typename Policy = BPTreePolicy<T>> class BPTree {
 
   void Clear();
 
+  /// @brief Builds an empty tree bottom-up from sorted items. Unlike inserting the items one by
+  /// one, it does not search or split nodes, and it fills the nodes up to their capacity.
+  /// @param items - strictly increasing according to Policy::KeyCompareTo.
+  /// @param count - number of items.
+  void FromSorted(const KeyT* items, size_t count);
+
   const BPTreeNode* DEBUG_root() const {
     return root_;
   }
@@ -173,6 +180,74 @@ template <typename T, typename Policy> void BPTree<T, Policy>::Clear() {
   height_ = count_ = 0;
 }
 
+template <typename T, typename Policy>
+void BPTree<T, Policy>::FromSorted(const KeyT* items, size_t count) {
+  using Layout = detail::BPNodeLayout<T>;
+
+  assert(root_ == nullptr);
+  if (count == 0)
+    return;
+
+  // Every level is a sequence of nodes with a separator between each two adjacent nodes.
+  // k nodes of capacity c hold k * c + (k - 1) items at most, so the level needs
+  // ceil((count + 1) / (c + 1)) nodes. The items are spread evenly between them, so every node
+  // is at least half full.
+  size_t num_nodes = (count + Layout::kMaxLeafKeys + 1) / (Layout::kMaxLeafKeys + 1);
+  size_t num_keys = count - (num_nodes - 1);
+  std::vector<BPTreeNode*> nodes(num_nodes);
+  std::vector<KeyT> separators;
+  separators.reserve(num_nodes - 1);
+
+  for (size_t i = 0; i < num_nodes; ++i) {
+    unsigned len = num_keys / num_nodes + (i < num_keys % num_nodes);
+    nodes[i] = CreateNode(true);
+    nodes[i]->InitKeys(items, len);
+    items += len;
+    if (i + 1 < num_nodes)
+      separators.push_back(*items++);
+  }
+  height_ = 1;
+
+  // Build the inner levels: a parent with n children takes the n - 1 separators between them,
+  // and the separators between the parents move one level up.
+  while (nodes.size() > 1) {
+    size_t num_children = nodes.size();
+    num_nodes = (num_children + Layout::kMaxInnerKeys) / (Layout::kMaxInnerKeys + 1);
+
+    std::vector<BPTreeNode*> parents(num_nodes);
+    std::vector<KeyT> parent_separators;
+    parent_separators.reserve(num_nodes - 1);
+
+    size_t child = 0;
+    for (size_t i = 0; i < num_nodes; ++i) {
+      unsigned len = num_children / num_nodes + (i < num_children % num_nodes);
+      assert(len >= 2);
+
+      BPTreeNode* parent = CreateNode(false);
+      parent->InitKeys(separators.data() + child, len - 1);
+
+      uint32_t tree_count = len - 1;
+      for (unsigned j = 0; j < len; ++j) {
+        parent->SetChild(j, nodes[child + j]);
+        tree_count += nodes[child + j]->TreeCount();
+      }
+      parent->SetTreeCount(tree_count);
+
+      child += len;
+      if (i + 1 < num_nodes)
+        parent_separators.push_back(separators[child - 1]);
+      parents[i] = parent;
+    }
+
+    nodes.swap(parents);
+    separators.swap(parent_separators);
+    height_++;
+  }
+
+  root_ = nodes.front();
+  count_ = count;
+}
+
 template <typename T, typename Policy> bool BPTree<T, Policy>::Insert(KeyT item) {
   if (!root_) {
     root_ = CreateNode(true);
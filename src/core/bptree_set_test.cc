@@ -7,6 +7,7 @@
 #include <gmock/gmock.h>
 #include <mimalloc.h>
 
+#include <algorithm>
 #include <random>
 
 extern "C" {
@@ -175,6 +176,45 @@ TEST_F(BPTreeSetTest, BPtreeInsert) {
   ASSERT_EQ(mi_alloc_.used(), 0u);
 }
 
+TEST_F(BPTreeSetTest, FromSorted) {
+  vector<uint64_t> items;
+  for (size_t count : {1u, 2u, 31u, 32u, 33u, 1000u, 20000u}) {
+    items.clear();
+    for (uint64_t i = 0; i < count; ++i)
+      items.push_back(i * 2);
+
+    bptree_.FromSorted(items.data(), items.size());
+    ASSERT_EQ(count, bptree_.Size());
+    ASSERT_TRUE(Validate()) << count;
+    for (uint64_t i = 0; i < count; ++i) {
+      ASSERT_EQ(i, bptree_.GetRank(i * 2));
+    }
+
+    // The tree stays valid when it is modified after the bulk load.
+    for (uint64_t i = 0; i < count; ++i) {
+      ASSERT_TRUE(bptree_.Insert(i * 2 + 1));
+      ASSERT_TRUE(bptree_.Delete(i * 2));
+    }
+    ASSERT_TRUE(Validate()) << count;
+    bptree_.Clear();
+    ASSERT_EQ(mi_alloc_.used(), 0u);
+  }
+
+  // Fully packed leaves take less memory than the tree built by random insertions.
+  items.clear();
+  for (uint64_t i = 0; i < 20000; ++i)
+    items.push_back(i);
+  bptree_.FromSorted(items.data(), items.size());
+  size_t bulk_used = mi_alloc_.used();
+  bptree_.Clear();
+
+  shuffle(items.begin(), items.end(), generator_);
+  for (uint64_t item : items)
+    bptree_.Insert(item);
+  ASSERT_TRUE(Validate());
+  EXPECT_LT(bulk_used, mi_alloc_.used());
+}
+
 TEST_F(BPTreeSetTest, Delete) {
   for (unsigned i = 31; i > 10; --i) {
     bptree_.Insert(i);
@@ -5,6 +5,7 @@
 #include "core/compact_object.h"
 
 // #define XXH_INLINE_ALL
+#include <lz4.h>
 #include <xxhash.h>
 
 extern "C" {
@@ -17,9 +18,12 @@ extern "C" {
 #include "redis/zmalloc.h"  // for non-string objects.
 #include "redis/zset.h"
 }
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/str_cat.h>
 #include <absl/strings/strip.h>
 
+#include <deque>
+
 #include <jsoncons/json.hpp>
 
 #include "base/flags.h"
@@ -109,6 +113,19 @@ size_t MallocUsedStream(unsigned encoding, void* streamv) {
   return 0;  // TODO
 }
 
+// Returns the DenseSet that backs the object, if there is one.
+DenseSet* GetDenseSet(const detail::RobjWrapper& robj) {
+  if (robj.encoding() == kEncodingStrMap2) {
+    if (robj.type() == OBJ_SET)
+      return static_cast<StringSet*>(robj.inner_obj());
+    if (robj.type() == OBJ_HASH)
+      return static_cast<StringMap*>(robj.inner_obj());
+  }
+  if (robj.type() == OBJ_ZSET && robj.encoding() == OBJ_ENCODING_SKIPLIST)
+    return static_cast<detail::SortedMap*>(robj.inner_obj())->members();
+  return nullptr;
+}
+
 inline void FreeObjHash(unsigned encoding, void* ptr) {
   switch (encoding) {
     case kEncodingStrMap2:
@@ -198,11 +215,151 @@ static_assert(ascii_len(15) == 17);
 static_assert(ascii_len(16) == 18);
 static_assert(ascii_len(17) == 19);
 
+// Only prefixes up to this length that end with the ':' delimiter are looked up.
+constexpr size_t kMaxKeyPrefixLen = 64;
+
+// Only every kPrefixLearnSampleRate-th key is counted towards learning, and only the first
+// kMaxLearnDelims prefixes of it that are longer than its dictionary prefix.
+constexpr uint32_t kPrefixLearnSampleRate = 8;
+constexpr unsigned kMaxLearnDelims = 4;
+
+// Number of sampled keys that must share a candidate prefix before it is learned.
+constexpr uint32_t kPrefixLearnThreshold = 32;
+constexpr size_t kMaxPrefixCandidates = 1024;
+constexpr size_t kMaxKeyPrefixes = UINT16_MAX;
+
+// Append-only dictionary of key prefixes, referenced by id from the prefixed keys.
+class KeyPrefixDict {
+ public:
+  void Init(const vector<string>& prefixes, unsigned max_learned);
+
+  // Returns the id of the longest dictionary prefix of key or -1 if there is none.
+  // Samples the keys for longer prefix candidates if learning is enabled.
+  int Find(string_view key);
+
+  string_view Get(uint16_t id) const {
+    DCHECK_LT(id, prefixes_.size());
+    return prefixes_[id];
+  }
+
+  bool IsActive() const {
+    return !prefixes_.empty() || learned_ < max_learned_;
+  }
+
+  size_t size() const {
+    return prefixes_.size();
+  }
+
+ private:
+  void Add(string_view prefix);
+
+  // Counts the delimited prefixes of key longer than min_len and shorter than window.
+  void Learn(string_view key, size_t min_len, size_t window);
+
+  deque<string> prefixes_;  // stable addresses for the views in index_.
+  absl::flat_hash_map<string_view, uint16_t> index_;
+  uint64_t prefix_lens_ = 0;  // bit i is set if there is a prefix of length i + 1.
+
+  // Counters of the candidate prefixes, keyed by their hash to save the copies.
+  absl::flat_hash_map<uint64_t, uint32_t> candidates_;
+  unsigned max_learned_ = 0;
+  unsigned learned_ = 0;
+  uint32_t learn_tick_ = 0;
+};
+
+static_assert(kMaxKeyPrefixLen <= 64);
+
+void KeyPrefixDict::Init(const vector<string>& prefixes, unsigned max_learned) {
+  prefixes_.clear();
+  index_.clear();
+  prefix_lens_ = 0;
+  candidates_.clear();
+  learned_ = 0;
+
+  for (const auto& prefix : prefixes) {
+    if (prefix.empty() || prefix.size() > kMaxKeyPrefixLen || prefix.back() != ':') {
+      LOG(WARNING) << "Ignoring key prefix '" << prefix << "', it must end with ':' and be at most "
+                   << kMaxKeyPrefixLen << " bytes long";
+      continue;
+    }
+    Add(prefix);
+  }
+  max_learned_ = min<size_t>(max_learned, kMaxKeyPrefixes - prefixes_.size());
+}
+
+void KeyPrefixDict::Add(string_view prefix) {
+  if (prefixes_.size() >= kMaxKeyPrefixes || index_.contains(prefix))
+    return;
+
+  prefixes_.emplace_back(prefix);
+  index_.emplace(prefixes_.back(), prefixes_.size() - 1);
+  prefix_lens_ |= 1ULL << (prefix.size() - 1);
+}
+
+int KeyPrefixDict::Find(string_view key) {
+  size_t window = min(key.size(), kMaxKeyPrefixLen);
+  int res = -1;
+  size_t len = 0;
+
+  // Try the longest candidate first, only probing the lengths of the dictionary prefixes.
+  uint64_t lens = prefix_lens_ & (window == 64 ? ~0ULL : (1ULL << window) - 1);
+  const char* delim = key.data() + window;
+  while (lens && (delim = (const char*)memrchr(key.data(), ':', delim - key.data())) != nullptr) {
+    len = delim - key.data() + 1;
+    if ((lens >> (len - 1)) & 1) {
+      auto it = index_.find(key.substr(0, len));
+      if (it != index_.end()) {
+        res = it->second;
+        break;
+      }
+    }
+    lens &= (1ULL << (len - 1)) - 1;
+    len = 0;
+  }
+
+  if (learned_ < max_learned_ && ++learn_tick_ % kPrefixLearnSampleRate == 0)
+    Learn(key, len, window);
+  return res;
+}
+
+void KeyPrefixDict::Learn(string_view key, size_t min_len, size_t window) {
+  // Counts a few delimited prefixes of the key, so a common short prefix is learned even if the
+  // longer ones vary between the keys. A longer prefix is learned next to the shorter one that
+  // matches it, and then used for the new keys.
+  unsigned delims = 0;
+  for (size_t pos = key.find(':', min_len); pos < window && delims < kMaxLearnDelims;
+       pos = key.find(':', pos + 1), ++delims) {
+    if (candidates_.size() >= kMaxPrefixCandidates)
+      candidates_.clear();  // Forget the rare candidates.
+
+    string_view prefix = key.substr(0, pos + 1);
+    auto [it, inserted] = candidates_.try_emplace(XXH3_64bits(prefix.data(), prefix.size()), 0);
+    if (++it->second >= kPrefixLearnThreshold) {
+      Add(prefix);
+      candidates_.erase(it);
+      if (++learned_ == max_learned_) {
+        candidates_.clear();
+        return;
+      }
+    }
+  }
+}
+
 struct TL {
   MemoryResource* local_mr = PMR_NS::get_default_resource();
   size_t small_str_bytes;
   base::PODArray<uint8_t> tmp_buf;
   string tmp_str;
+  KeyPrefixDict key_prefixes;
+  size_t prefixed_keys = 0;
+  size_t key_prefix_saved_bytes = 0;
+  size_t compressed_raw_bytes = 0;
+  size_t compressed_bytes = 0;
+  XXH3_state_t* hash_state = nullptr;
+
+  ~TL() {
+    XXH3_freeState(hash_state);
+  }
 };
 
 thread_local TL tl;
@@ -524,6 +681,10 @@ using namespace std;
 auto CompactObj::GetStats() -> Stats {
   Stats res;
   res.small_string_bytes = tl.small_str_bytes;
+  res.key_prefix_entries = tl.key_prefixes.size();
+  res.key_prefix_saved_bytes = tl.key_prefix_saved_bytes;
+  res.compressed_raw_bytes = tl.compressed_raw_bytes;
+  res.compressed_bytes = tl.compressed_bytes;
 
   return res;
 }
@@ -533,6 +694,11 @@ void CompactObj::InitThreadLocal(MemoryResource* mr) {
   tl.tmp_buf = base::PODArray<uint8_t>{mr};
 }
 
+void CompactObj::InitKeyPrefixes(const vector<string>& prefixes, unsigned max_learned) {
+  CHECK_EQ(tl.prefixed_keys, 0u) << "Key prefixes are in use";
+  tl.key_prefixes.Init(prefixes, max_learned);
+}
+
 CompactObj::~CompactObj() {
   if (HasAllocated()) {
     Free();
@@ -573,6 +739,13 @@ size_t CompactObj::Size() const {
       case ROBJ_TAG:
         raw_size = u_.r_obj.Size();
         break;
+      case PREFIX_TAG:
+        raw_size = tl.key_prefixes.Get(u_.prefixed_key.prefix_id).size() +
+                   u_.prefixed_key.suffix().size();
+        break;
+      case COMPRESSED_TAG:
+        raw_size = u_.compressed.raw_len;
+        break;
       default:
         LOG(DFATAL) << "Should not reach " << int(taglen_);
     }
@@ -609,6 +782,29 @@ uint64_t CompactObj::HashCode() const {
       absl::AlphaNum an(u_.ival);
       return XXH3_64bits_withSeed(an.data(), an.size(), kHashSeed);
     }
+    case COMPRESSED_TAG: {
+      string_view raw = GetSlice(&tl.tmp_str);
+      return XXH3_64bits_withSeed(raw.data(), raw.size(), kHashSeed);
+    }
+    case PREFIX_TAG: {
+      string_view prefix = tl.key_prefixes.Get(u_.prefixed_key.prefix_id);
+      string_view suffix = u_.prefixed_key.suffix();
+
+      // Short keys are cheaper to hash in one shot from the stack than with the streaming api.
+      char buf[128];
+      if (prefix.size() + suffix.size() <= sizeof(buf)) {
+        memcpy(buf, prefix.data(), prefix.size());
+        memcpy(buf + prefix.size(), suffix.data(), suffix.size());
+        return XXH3_64bits_withSeed(buf, prefix.size() + suffix.size(), kHashSeed);
+      }
+
+      if (!tl.hash_state)
+        tl.hash_state = XXH3_createState();
+      XXH3_64bits_reset_withSeed(tl.hash_state, kHashSeed);
+      XXH3_64bits_update(tl.hash_state, prefix.data(), prefix.size());
+      XXH3_64bits_update(tl.hash_state, suffix.data(), suffix.size());
+      return XXH3_64bits_digest(tl.hash_state);
+    }
   }
   // We need hash only for keys.
   LOG(DFATAL) << "Should not reach " << int(taglen_);
@@ -621,7 +817,8 @@ uint64_t CompactObj::HashCode(string_view str) {
 }
 
 unsigned CompactObj::ObjType() const {
-  if (IsInline() || taglen_ == INT_TAG || taglen_ == SMALL_TAG || taglen_ == EXTERNAL_TAG)
+  if (IsInline() || taglen_ == INT_TAG || taglen_ == SMALL_TAG || taglen_ == EXTERNAL_TAG ||
+      taglen_ == PREFIX_TAG || taglen_ == COMPRESSED_TAG)
     return OBJ_STRING;
 
   if (taglen_ == ROBJ_TAG)
@@ -690,14 +887,15 @@ std::optional<int64_t> CompactObj::TryGetInt() const {
 }
 
 auto CompactObj::GetJson() const -> JsonType* {
-  if (ObjType() == OBJ_JSON) {
+  if (ObjType() == OBJ_JSON && u_.json_obj.encoding == kEncodingJsonCons) {
     return u_.json_obj.json_ptr;
   }
   return nullptr;
 }
 
 void CompactObj::SetJson(JsonType&& j) {
-  if (taglen_ == JSON_TAG) {                  // already json
+  // already json in the same encoding.
+  if (taglen_ == JSON_TAG && u_.json_obj.encoding == kEncodingJsonCons) {
     DCHECK(u_.json_obj.json_ptr != nullptr);  // must be allocated
     *u_.json_obj.json_ptr = std::move(j);
   } else {
@@ -707,6 +905,15 @@ void CompactObj::SetJson(JsonType&& j) {
   }
 }
 
+void CompactObj::SetJson(const uint8_t* buf, size_t len) {
+  CHECK_LE(len, UINT32_MAX);
+  SetMeta(JSON_TAG);
+  u_.json_obj.flat_ptr = (uint8_t*)tl.local_mr->allocate(len, kAlignSize);
+  memcpy(u_.json_obj.flat_ptr, buf, len);
+  u_.json_obj.flat_len = len;
+  u_.json_obj.encoding = kEncodingJsonFlat;
+}
+
 void CompactObj::SetString(std::string_view str) {
   uint8_t mask = mask_ & ~kEncMask;
   CHECK(!IsExternal());
@@ -779,6 +986,79 @@ void CompactObj::SetString(std::string_view str) {
   u_.r_obj.SetString(encoded, tl.local_mr);
 }
 
+void CompactObj::SetKey(string_view key) {
+  // Short keys are stored inline anyway.
+  if (key.size() <= kInlineLen || !tl.key_prefixes.IsActive())
+    return SetString(key);
+
+  int id = tl.key_prefixes.Find(key);
+  if (id < 0)
+    return SetString(key);
+
+  string_view prefix = tl.key_prefixes.Get(id);
+  string_view suffix = key.substr(prefix.size());
+
+  // Unless the suffix fits inline, ascii packing of the whole key may be more compact.
+  if (suffix.size() > PrefixedKey::kInlineSuffixLen && prefix.size() * 8 < key.size())
+    return SetString(key);
+
+  SetMeta(PREFIX_TAG, mask_ & ~kEncMask);
+  PrefixedKey& pk = u_.prefixed_key;
+  pk.prefix_id = id;
+  if (suffix.size() <= PrefixedKey::kInlineSuffixLen) {
+    pk.suffix_len = suffix.size();
+    memcpy(pk.inline_suffix, suffix.data(), suffix.size());
+  } else {
+    pk.suffix_len = PrefixedKey::kHeapSuffix;
+    pk.heap.len = suffix.size();
+    pk.heap.ptr = (char*)tl.local_mr->allocate(suffix.size(), kAlignSize);
+    memcpy(pk.heap.ptr, suffix.data(), suffix.size());
+  }
+
+  tl.prefixed_keys++;
+  tl.key_prefix_saved_bytes += prefix.size();
+}
+
+string_view CompactObj::GetKeyPrefix() const {
+  if (taglen_ != PREFIX_TAG)
+    return string_view{};
+  return tl.key_prefixes.Get(u_.prefixed_key.prefix_id);
+}
+
+bool CompactObj::Compress(size_t min_len) {
+  if (ObjType() != OBJ_STRING || IsCompressed() || IsExternal() || HasIoPending() ||
+      taglen_ == INT_TAG || IsInline())
+    return false;
+
+  size_t raw_len = Size();
+  if (raw_len < min_len || raw_len > LZ4_MAX_INPUT_SIZE)
+    return false;
+
+  GetString(&tl.tmp_str);
+  tl.tmp_buf.resize(LZ4_compressBound(raw_len));
+  char* packed = reinterpret_cast<char*>(tl.tmp_buf.data());
+  int packed_len = LZ4_compress_default(tl.tmp_str.data(), packed, raw_len, tl.tmp_buf.size());
+  if (packed_len <= 0 || size_t(packed_len) > raw_len - raw_len / 8)
+    return false;
+
+  SetMeta(COMPRESSED_TAG, mask_ & ~kEncMask);
+  u_.compressed.raw_len = raw_len;
+  u_.compressed.packed_len = packed_len;
+  u_.compressed.ptr = (char*)tl.local_mr->allocate(packed_len, kAlignSize);
+  memcpy(u_.compressed.ptr, packed, packed_len);
+
+  tl.compressed_raw_bytes += raw_len;
+  tl.compressed_bytes += packed_len;
+  return true;
+}
+
+void CompactObj::Decompress(char* dest) const {
+  DCHECK(IsCompressed());
+  int res = LZ4_decompress_safe(u_.compressed.ptr, dest, u_.compressed.packed_len,
+                                u_.compressed.raw_len);
+  CHECK_EQ(res, int(u_.compressed.raw_len)) << "Corrupted compressed value";
+}
+
 string_view CompactObj::GetSlice(string* scratch) const {
   CHECK(!IsExternal());
   uint8_t is_encoded = mask_ & kEncMask;
@@ -806,6 +1086,18 @@ string_view CompactObj::GetSlice(string* scratch) const {
     return *scratch;
   }
 
+  if (taglen_ == PREFIX_TAG) {
+    scratch->assign(tl.key_prefixes.Get(u_.prefixed_key.prefix_id));
+    scratch->append(u_.prefixed_key.suffix());
+    return *scratch;
+  }
+
+  if (taglen_ == COMPRESSED_TAG) {
+    scratch->resize(u_.compressed.raw_len);
+    Decompress(scratch->data());
+    return *scratch;
+  }
+
   if (is_encoded) {
     if (taglen_ == ROBJ_TAG) {
       CHECK_EQ(OBJ_STRING, u_.r_obj.type());
@@ -876,7 +1168,9 @@ bool CompactObj::HasAllocated() const {
       (taglen_ == ROBJ_TAG && u_.r_obj.inner_obj() == nullptr))
     return false;
 
-  DCHECK(taglen_ == ROBJ_TAG || taglen_ == SMALL_TAG || taglen_ == JSON_TAG);
+  // Prefixed keys are always released to maintain the prefix stats.
+  DCHECK(taglen_ == ROBJ_TAG || taglen_ == SMALL_TAG || taglen_ == JSON_TAG ||
+         taglen_ == PREFIX_TAG || taglen_ == COMPRESSED_TAG);
   return true;
 }
 
@@ -911,6 +1205,19 @@ void CompactObj::GetString(char* dest) const {
     return;
   }
 
+  if (taglen_ == PREFIX_TAG) {
+    string_view prefix = tl.key_prefixes.Get(u_.prefixed_key.prefix_id);
+    string_view suffix = u_.prefixed_key.suffix();
+    memcpy(dest, prefix.data(), prefix.size());
+    memcpy(dest + prefix.size(), suffix.data(), suffix.size());
+    return;
+  }
+
+  if (taglen_ == COMPRESSED_TAG) {
+    Decompress(dest);
+    return;
+  }
+
   if (is_encoded) {
     if (taglen_ == ROBJ_TAG) {
       CHECK_EQ(OBJ_STRING, u_.r_obj.type());
@@ -970,6 +1277,20 @@ std::pair<size_t, size_t> CompactObj::GetExternalSlice() const {
   return pair<size_t, size_t>(offset, size_t(u_.ext_ptr.size));
 }
 
+void CompactObj::DetachFromThread() {
+  if (taglen_ != ROBJ_TAG)
+    return;
+  if (DenseSet* ds = GetDenseSet(u_.r_obj))
+    ds->DetachFromThread();
+}
+
+void CompactObj::AttachToThread() {
+  if (taglen_ != ROBJ_TAG)
+    return;
+  if (DenseSet* ds = GetDenseSet(u_.r_obj))
+    ds->AttachToThread();
+}
+
 void CompactObj::Reset() {
   if (HasAllocated()) {
     Free();
@@ -989,8 +1310,22 @@ void CompactObj::Free() {
     u_.small_str.Free();
   } else if (taglen_ == JSON_TAG) {
     VLOG(1) << "Freeing JSON object";
-    u_.json_obj.json_ptr->~JsonType();
-    tl.local_mr->deallocate(u_.json_obj.json_ptr, sizeof(JsonType), kAlignSize);
+    if (u_.json_obj.encoding == kEncodingJsonFlat) {
+      tl.local_mr->deallocate(u_.json_obj.flat_ptr, u_.json_obj.flat_len, kAlignSize);
+    } else {
+      u_.json_obj.json_ptr->~JsonType();
+      tl.local_mr->deallocate(u_.json_obj.json_ptr, sizeof(JsonType), kAlignSize);
+    }
+  } else if (taglen_ == PREFIX_TAG) {
+    const PrefixedKey& pk = u_.prefixed_key;
+    if (pk.suffix_len == PrefixedKey::kHeapSuffix)
+      tl.local_mr->deallocate(pk.heap.ptr, pk.heap.len, kAlignSize);
+    tl.prefixed_keys--;
+    tl.key_prefix_saved_bytes -= tl.key_prefixes.Get(pk.prefix_id).size();
+  } else if (taglen_ == COMPRESSED_TAG) {
+    tl.local_mr->deallocate(u_.compressed.ptr, u_.compressed.packed_len, kAlignSize);
+    tl.compressed_raw_bytes -= u_.compressed.raw_len;
+    tl.compressed_bytes -= u_.compressed.packed_len;
   } else {
     LOG(FATAL) << "Unsupported tag " << int(taglen_);
   }
@@ -1015,6 +1350,15 @@ size_t CompactObj::MallocUsed() const {
     return u_.small_str.MallocUsed();
   }
 
+  if (taglen_ == PREFIX_TAG) {
+    const PrefixedKey& pk = u_.prefixed_key;
+    return pk.suffix_len == PrefixedKey::kHeapSuffix ? zmalloc_size(pk.heap.ptr) : 0;
+  }
+
+  if (taglen_ == COMPRESSED_TAG) {
+    return zmalloc_size(u_.compressed.ptr);
+  }
+
   LOG(DFATAL) << "should not reach";
   return 0;
 }
@@ -1022,6 +1366,32 @@ size_t CompactObj::MallocUsed() const {
 bool CompactObj::operator==(const CompactObj& o) const {
   DCHECK(taglen_ != JSON_TAG && o.taglen_ != JSON_TAG) << "cannot use JSON type to check equal";
 
+  if (taglen_ == PREFIX_TAG || o.taglen_ == PREFIX_TAG) {
+    if (taglen_ == o.taglen_ && u_.prefixed_key.prefix_id == o.u_.prefixed_key.prefix_id)
+      return u_.prefixed_key.suffix() == o.u_.prefixed_key.suffix();
+
+    // The same key may be encoded differently after a longer prefix has been learned.
+    const CompactObj& prefixed = taglen_ == PREFIX_TAG ? *this : o;
+    const CompactObj& other = taglen_ == PREFIX_TAG ? o : *this;
+    return prefixed == other.GetSlice(&tl.tmp_str);
+  }
+
+  if (taglen_ == COMPRESSED_TAG || o.taglen_ == COMPRESSED_TAG) {
+    if (Size() != o.Size())
+      return false;
+
+    // LZ4 compression is deterministic, so equal values are compressed to equal bytes.
+    if (taglen_ == o.taglen_) {
+      const CompressedBlob& l = u_.compressed;
+      const CompressedBlob& r = o.u_.compressed;
+      return l.packed_len == r.packed_len && memcmp(l.ptr, r.ptr, l.packed_len) == 0;
+    }
+
+    const CompactObj& compressed = taglen_ == COMPRESSED_TAG ? *this : o;
+    const CompactObj& other = taglen_ == COMPRESSED_TAG ? o : *this;
+    return other == compressed.GetSlice(&tl.tmp_str);
+  }
+
   uint8_t m1 = mask_ & kEncMask;
   uint8_t m2 = o.mask_ & kEncMask;
   if (m1 != m2)
@@ -1055,6 +1425,14 @@ bool CompactObj::EqualNonInline(std::string_view sv) const {
       return u_.r_obj.Equal(sv);
     case SMALL_TAG:
       return u_.small_str.Equal(sv);
+    case PREFIX_TAG: {
+      string_view prefix = tl.key_prefixes.Get(u_.prefixed_key.prefix_id);
+      string_view suffix = u_.prefixed_key.suffix();
+      return sv.size() == prefix.size() + suffix.size() && sv.substr(prefix.size()) == suffix &&
+             sv.substr(0, prefix.size()) == prefix;
+    }
+    case COMPRESSED_TAG:
+      return sv.size() == u_.compressed.raw_len && sv == GetSlice(&tl.tmp_str);
     default:
       break;
   }
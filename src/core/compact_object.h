@@ -19,6 +19,9 @@ constexpr unsigned kEncodingStrMap = 1;   // for set/map encodings of strings
 constexpr unsigned kEncodingStrMap2 = 2;  // for set/map encodings of strings using DenseSet
 constexpr unsigned kEncodingListPack = 3;
 
+constexpr unsigned kEncodingJsonCons = 0;  // for json objects held as jsoncons trees
+constexpr unsigned kEncodingJsonFlat = 1;  // for json objects held as flexbuffers
+
 namespace detail {
 
 // redis objects or blobs of upto 4GB size.
@@ -101,6 +104,8 @@ class CompactObj {
     ROBJ_TAG = 19,
     EXTERNAL_TAG = 20,
     JSON_TAG = 21,
+    PREFIX_TAG = 22,
+    COMPRESSED_TAG = 23,
   };
 
   enum MaskBit {
@@ -121,6 +126,7 @@ class CompactObj {
     // by checking if the item was touched from the last time we
     // reached this item while travering the database to set items as cold.
     // https://junchengyang.com/publication/nsdi24-SIEVE.pdf
+    // Keys carry the bit for tiered storage, values for the compression of cold strings.
     TOUCHED = 0x80,
   };
 
@@ -288,15 +294,45 @@ class CompactObj {
   void SetString(std::string_view str);
   void GetString(std::string* res) const;
 
+  // Like SetString but may store the key as an id of the thread-local key prefix dictionary
+  // followed by the rest of the key. Used for the keys of the prime table.
+  void SetKey(std::string_view key);
+
+  // Returns the dictionary prefix of a key set with SetKey or an empty view if it has none.
+  std::string_view GetKeyPrefix() const;
+
+  // Compresses a string value of at least min_len bytes with LZ4 if it saves at least 1/8 of its
+  // size. The value is decompressed on every read and stored uncompressed once it is overwritten.
+  // Returns true if the value was compressed.
+  bool Compress(size_t min_len);
+
+  bool IsCompressed() const {
+    return taglen_ == COMPRESSED_TAG;
+  }
+
   // Will set this to hold OBJ_JSON, after that it is safe to call GetJson
   // NOTE: in order to avid copy which can be expensive in this case,
   // you need to move an object that created with the function JsonFromString
   // into here, no copying is allowed!
   void SetJson(JsonType&& j);
 
-  // pre condition - the type here is OBJ_JSON and was set with SetJson
+  // Sets this to hold OBJ_JSON in the flat encoding, copying the flexbuffer of len bytes.
+  void SetJson(const uint8_t* buf, size_t len);
+
+  // pre condition - the type here is OBJ_JSON and was set with SetJson.
+  // Returns nullptr if the object is in the flat encoding.
   JsonType* GetJson() const;
 
+  // pre condition - the type here is OBJ_JSON. Returns kEncodingJsonCons or kEncodingJsonFlat.
+  unsigned JsonEncoding() const {
+    return u_.json_obj.encoding;
+  }
+
+  // pre condition - the object is in the flat encoding. Returns the flexbuffer.
+  std::string_view GetFlatJson() const {
+    return {reinterpret_cast<const char*>(u_.json_obj.flat_ptr), u_.json_obj.flat_len};
+  }
+
   // dest must have at least Size() bytes available
   void GetString(char* dest) const;
 
@@ -314,6 +350,12 @@ class CompactObj {
   // Resets the object to empty state (string).
   void Reset();
 
+  // Values backed by a DenseSet are tracked by their thread while they grow. A value that moves
+  // to another thread must be detached on the old thread and attached on the new one,
+  // see DenseSet::DetachFromThread().
+  void DetachFromThread();
+  void AttachToThread();
+
   bool IsInline() const {
     return taglen_ <= kInlineLen;
   }
@@ -324,11 +366,20 @@ class CompactObj {
 
   struct Stats {
     size_t small_string_bytes = 0;
+    size_t key_prefix_entries = 0;      // prefixes in the dictionary
+    size_t key_prefix_saved_bytes = 0;  // prefix bytes not stored by prefixed keys
+    size_t compressed_raw_bytes = 0;    // original size of the compressed values
+    size_t compressed_bytes = 0;        // size of the compressed values
   };
 
   static Stats GetStats();
 
   static void InitThreadLocal(MemoryResource* mr);
+
+  // Sets the explicit prefixes of the thread-local key prefix dictionary, each must end with ':'.
+  // Up to max_learned additional prefixes are learned from the keys passed to SetKey.
+  // Must be called before any key uses the dictionary.
+  static void InitKeyPrefixes(const std::vector<std::string>& prefixes, unsigned max_learned);
   static MemoryResource* memory_resource();  // thread-local.
 
   template <typename T> static T* AllocateMR() {
@@ -354,6 +405,9 @@ class CompactObj {
 
   bool CmpEncoded(std::string_view sv) const;
 
+  // Requires: IsCompressed() - true. dest must have at least Size() bytes available.
+  void Decompress(char* dest) const;
+
   void SetMeta(uint8_t taglen, uint8_t mask = 0) {
     if (HasAllocated()) {
       Free();
@@ -374,8 +428,41 @@ class CompactObj {
   } __attribute__((packed));
 
   struct JsonWrapper {
-    JsonType* json_ptr = nullptr;
-    size_t unneeded = 0;
+    union {
+      JsonType* json_ptr = nullptr;
+      uint8_t* flat_ptr;
+    };
+    uint32_t flat_len = 0;
+    uint8_t encoding = kEncodingJsonCons;
+  } __attribute__((packed));
+
+  struct CompressedBlob {
+    uint32_t raw_len;
+    uint32_t packed_len;
+    char* ptr;
+  } __attribute__((packed));
+
+  // A key that starts with an entry of the key prefix dictionary. Only the suffix is stored,
+  // either inline or in a separate allocation.
+  struct PrefixedKey {
+    static constexpr uint8_t kInlineSuffixLen = 13;
+    static constexpr uint8_t kHeapSuffix = 0xFF;
+
+    uint16_t prefix_id;
+    uint8_t suffix_len;  // length of the inline suffix or kHeapSuffix.
+    union {
+      char inline_suffix[kInlineSuffixLen];
+      struct {
+        uint8_t reserved;
+        uint32_t len;
+        char* ptr;
+      } __attribute__((packed)) heap;
+    } __attribute__((packed));
+
+    std::string_view suffix() const {
+      return suffix_len == kHeapSuffix ? std::string_view{heap.ptr, heap.len}
+                                       : std::string_view{inline_suffix, suffix_len};
+    }
   } __attribute__((packed));
 
   // My main data structure. Union of representations.
@@ -388,6 +475,8 @@ class CompactObj {
     SmallString small_str;
     detail::RobjWrapper r_obj;
     JsonWrapper json_obj;
+    PrefixedKey prefixed_key;
+    CompressedBlob compressed;
     int64_t ival __attribute__((packed));
     ExternalPtr ext_ptr;
 
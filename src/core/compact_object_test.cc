@@ -4,6 +4,7 @@
 #include "core/compact_object.h"
 
 #include <absl/strings/str_cat.h>
+#include <flatbuffers/flexbuffers.h>
 #include <mimalloc.h>
 #include <xxhash.h>
 
@@ -302,6 +303,131 @@ TEST_F(CompactObjectTest, MediumString) {
   EXPECT_EQ(27463, cobj_.Size());
 }
 
+TEST_F(CompactObjectTest, KeyPrefix) {
+  CompactObj::InitKeyPrefixes({"user:", "user:session:", "bad"}, 1);
+  EXPECT_EQ(2u, CompactObj::GetStats().key_prefix_entries);
+
+  {
+    string key = "user:session:12345";  // inline suffix
+    CompactObj obj;
+    obj.SetKey(key);
+    EXPECT_EQ("user:session:", obj.GetKeyPrefix());
+    EXPECT_EQ(key.size(), obj.Size());
+    EXPECT_EQ(XXH3_64bits_withSeed(key.data(), key.size(), kSeed), obj.HashCode());
+    EXPECT_EQ(key, obj.GetSlice(&tmp_));
+    EXPECT_EQ(key, obj.ToString());
+    EXPECT_EQ(key, obj);
+    EXPECT_NE("user:session:12346", obj);
+    EXPECT_NE("user:session:1234", obj);
+    EXPECT_EQ(OBJ_STRING, obj.ObjType());
+    EXPECT_EQ(13u, CompactObj::GetStats().key_prefix_saved_bytes);
+
+    CompactObj plain{key};
+    EXPECT_EQ(plain, obj);
+    EXPECT_EQ(obj, plain);
+    EXPECT_EQ(obj, obj.AsRef());
+
+    // Non matching keys and keys whose suffix is not worth it are stored as usual.
+    obj.SetKey("other:key:1234567890");
+    EXPECT_EQ("", obj.GetKeyPrefix());
+    obj.SetKey("user:" + string(100, 'x'));
+    EXPECT_EQ("", obj.GetKeyPrefix());
+    EXPECT_EQ(0u, CompactObj::GetStats().key_prefix_saved_bytes);
+
+    key = "user:session:" + string(50, 'y');  // heap suffix
+    obj.SetKey(key);
+    EXPECT_EQ("user:session:", obj.GetKeyPrefix());
+    EXPECT_EQ(key, obj.ToString());
+    EXPECT_EQ(key, obj);
+    EXPECT_EQ(XXH3_64bits_withSeed(key.data(), key.size(), kSeed), obj.HashCode());
+
+    key = "user:session:" + string(200, 'z');  // hashed with the streaming api
+    obj.SetKey(key);
+    EXPECT_EQ(XXH3_64bits_withSeed(key.data(), key.size(), kSeed), obj.HashCode());
+    EXPECT_EQ(key, obj);
+  }
+
+  // Learns up to 1 prefix from the keys.
+  for (unsigned i = 0; i < 1000; ++i) {
+    CompactObj obj;
+    obj.SetKey(absl::StrCat("order:", i, ":item:", i));
+  }
+  EXPECT_EQ(3u, CompactObj::GetStats().key_prefix_entries);
+
+  CompactObj obj;
+  obj.SetKey("order:123:item:456");
+  EXPECT_EQ("order:", obj.GetKeyPrefix());
+  obj.Reset();
+  EXPECT_EQ(0u, CompactObj::GetStats().key_prefix_saved_bytes);
+
+  // A longer prefix is learned even though a shorter one matches the keys.
+  CompactObj::InitKeyPrefixes({"app:"}, 1);
+  for (unsigned i = 0; i < 1000; ++i) {
+    CompactObj obj;
+    obj.SetKey(absl::StrCat("app:session:", i, ":x"));
+  }
+  EXPECT_EQ(2u, CompactObj::GetStats().key_prefix_entries);
+  obj.SetKey("app:session:12345");
+  EXPECT_EQ("app:session:", obj.GetKeyPrefix());
+  obj.SetKey("app:other:1234567");
+  EXPECT_EQ("app:", obj.GetKeyPrefix());
+  obj.Reset();
+
+  CompactObj::InitKeyPrefixes({}, 0);
+}
+
+TEST_F(CompactObjectTest, Compress) {
+  string val;
+  for (unsigned i = 0; i < 200; ++i)
+    absl::StrAppend(&val, "<div class=\"item\">", i, "</div>");
+
+  EXPECT_FALSE(cobj_.Compress(val.size()));  // too short
+  cobj_.SetString(val);
+  EXPECT_FALSE(cobj_.Compress(val.size() + 1));
+  cobj_.SetExpire(true);
+  ASSERT_TRUE(cobj_.Compress(val.size()));
+  EXPECT_TRUE(cobj_.IsCompressed());
+  EXPECT_FALSE(cobj_.Compress(val.size()));
+  EXPECT_TRUE(cobj_.HasExpire());
+  EXPECT_EQ(OBJ_STRING, cobj_.ObjType());
+  EXPECT_EQ(val.size(), cobj_.Size());
+  EXPECT_EQ(val, cobj_.GetSlice(&tmp_));
+  EXPECT_EQ(val, cobj_.ToString());
+  EXPECT_EQ(val, cobj_);
+  EXPECT_NE(val + "x", cobj_);
+  EXPECT_EQ(CompactObj::HashCode(val), cobj_.HashCode());
+
+  // Compressed values are compared without decompressing both.
+  CompactObj same, other;
+  same.SetString(val);
+  EXPECT_TRUE(same == cobj_ && cobj_ == same);
+  ASSERT_TRUE(same.Compress(val.size()));
+  EXPECT_TRUE(same == cobj_);
+  string other_val = val;
+  other_val.back() = 'x';
+  other.SetString(other_val);
+  EXPECT_FALSE(other == cobj_);
+  ASSERT_TRUE(other.Compress(val.size()));
+  EXPECT_FALSE(other == cobj_);
+
+  CompactObj::Stats stats = CompactObj::GetStats();
+  EXPECT_EQ(val.size(), stats.compressed_raw_bytes);
+  EXPECT_LT(stats.compressed_bytes * 2, val.size());
+
+  // Random data does not compress.
+  CompactObj obj;
+  string rnd(1000, ' ');
+  for (char& c : rnd)
+    c = rand() % 256;
+  obj.SetString(rnd);
+  EXPECT_FALSE(obj.Compress(16));
+
+  cobj_.SetString("bar");
+  stats = CompactObj::GetStats();
+  EXPECT_EQ(0u, stats.compressed_raw_bytes);
+  EXPECT_EQ(0u, stats.compressed_bytes);
+}
+
 TEST_F(CompactObjectTest, AsciiUtil) {
   std::string_view data{"aaaaaabb"};
   uint8_t buf[32];
@@ -470,6 +596,32 @@ TEST_F(CompactObjectTest, JsonTypeTest) {
   ASSERT_TRUE(failed_json == nullptr);
 }
 
+TEST_F(CompactObjectTest, FlatJson) {
+  auto json = JsonFromString(R"({"a":[1,2,3],"b":{"c":"d"}})", CompactObj::memory_resource());
+  ASSERT_TRUE(json);
+  flexbuffers::Builder fbb;
+  ASSERT_TRUE(JsonToFlex(*json, &fbb));
+  fbb.Finish();
+  const auto& buf = fbb.GetBuffer();
+
+  cobj_.SetJson(buf.data(), buf.size());
+  ASSERT_EQ(OBJ_JSON, cobj_.ObjType());
+  EXPECT_EQ(kEncodingJsonFlat, cobj_.JsonEncoding());
+  EXPECT_EQ(nullptr, cobj_.GetJson());
+  EXPECT_GE(cobj_.MallocUsed(), buf.size());
+  EXPECT_EQ(*json, JsonFromFlat(cobj_.GetFlatJson(), CompactObj::memory_resource()));
+
+  // Switching between the encodings releases the previous one.
+  cobj_.SetJson(std::move(*json));
+  EXPECT_EQ(kEncodingJsonCons, cobj_.JsonEncoding());
+  ASSERT_TRUE(cobj_.GetJson() != nullptr);
+  EXPECT_TRUE(cobj_.GetJson()->contains("b"));
+  cobj_.SetJson(buf.data(), buf.size());
+  EXPECT_EQ(kEncodingJsonFlat, cobj_.JsonEncoding());
+  cobj_.SetString("foo");
+  EXPECT_EQ(OBJ_STRING, cobj_.ObjType());
+}
+
 TEST_F(CompactObjectTest, JsonTypeWithPathTest) {
   std::string_view books_json =
       R"({"books":[{
@@ -3,6 +3,10 @@
 //
 #pragma once
 
+#include <absl/types/span.h>
+
+#include <algorithm>
+#include <array>
 #include <vector>
 
 #include "base/pmr/memory_resource.h"
@@ -61,6 +65,9 @@ class DashTable : public detail::DashTableBase {
   static constexpr size_t kSegCapacity = SegmentType::capacity();
   static constexpr bool kUseVersion = Policy::kUseVersion;
 
+  // Number of keys whose buckets FindMany prefetches before resolving them.
+  static constexpr unsigned kPrefetchGroup = 8;
+
   // if IsSingleBucket is true - iterates only over a single bucket.
   template <bool IsConst, bool IsSingleBucket = false> class Iterator;
 
@@ -160,6 +167,24 @@ class DashTable : public detail::DashTableBase {
   template <typename U> const_iterator Find(U&& key) const;
   template <typename U> iterator Find(U&& key);
 
+  // Same as Find but with key_hash = DoHash(key) precomputed by the caller.
+  template <typename U> iterator Find(U&& key, uint64_t key_hash);
+
+  // Returns the first entry among those whose key may hash to key_hash, i.e. the entries with
+  // its fingerprint in its home, neighbour and stash buckets, for which pred(key) is true.
+  // Allows looking up entries by a hash saved earlier without having their key.
+  template <typename Pred> iterator FindFirst(uint64_t key_hash, Pred&& pred);
+
+  // Prefetches the bucket of key_hash. Lookups of many keys can hash and prefetch a group of
+  // them before resolving them with Find(key, key_hash), so that their cache misses overlap.
+  void Prefetch(uint64_t key_hash) const {
+    segment_[SegmentId(key_hash)]->Prefetch(key_hash);
+  }
+
+  // Finds keys[i] and stores the result in res[i]. Prefetches the buckets of every
+  // kPrefetchGroup keys before resolving them.
+  template <typename U> void FindMany(absl::Span<const U> keys, absl::Span<iterator> res);
+
   // it must be valid.
   void Erase(iterator it);
 
@@ -299,6 +324,29 @@ class DashTable : public detail::DashTableBase {
     return stash_unloaded_;
   }
 
+  // Enables splitting ahead of time: inserts that spill into the stash of a segment filled above
+  // `utilization` leave a hint, and SplitAheadStep splits the hinted segments off the insert path.
+  // A segment that fills up before its hint is handled still splits inline. 0 disables hints.
+  void SetSplitAheadUtilization(double utilization) {
+    split_ahead_size_ = utilization * SegmentType::capacity();
+    num_split_hints_ = 0;
+  }
+
+  bool HasSplitHints() const {
+    return num_split_hints_ > 0;
+  }
+
+  // Splits at most max_splits hinted segments that are still filled above the threshold,
+  // doubling the directory if needed. Before a segment is split, calls cb(bucket_iterator) for
+  // each of its non-empty buckets with version below ver_threshold, like CVCUponInsert does for
+  // a full segment. Returns the number of splits.
+  // A split is not incremental, it moves up to SegmentType::capacity() entries at once. Doubling
+  // the directory copies all of it, so it is done at most once per call and before any split.
+  // Hence a call costs at most max_splits segment splits and one doubling of the directory, the
+  // same work that an insert into a full segment does inline.
+  template <typename EvictionPolicy, typename Cb>
+  unsigned SplitAheadStep(unsigned max_splits, EvictionPolicy& ev, uint64_t ver_threshold, Cb&& cb);
+
  private:
   enum class InsertMode {
     kInsertIfNotFound,
@@ -311,6 +359,9 @@ class DashTable : public detail::DashTableBase {
   void IncreaseDepth(unsigned new_depth);
   void Split(uint32_t seg_id);
 
+  // Remembers the segment of key_hash for SplitAheadStep if it is filled above the threshold.
+  void RecordSplitHint(uint32_t seg_id, uint64_t key_hash);
+
   // Segment directory contains multiple segment pointers, some of them pointing to
   // the same object. IterateDistinct goes over all distinct segments in the table.
   template <typename Cb> void IterateDistinct(Cb&& cb);
@@ -324,6 +375,12 @@ class DashTable : public detail::DashTableBase {
 
   uint64_t garbage_collected_ = 0;
   uint64_t stash_unloaded_ = 0;
+
+  // Hashes of keys whose segments should be split ahead of time, see SetSplitAheadUtilization.
+  static constexpr unsigned kMaxSplitHints = 16;
+  size_t split_ahead_size_ = 0;
+  unsigned num_split_hints_ = 0;
+  std::array<uint64_t, kMaxSplitHints> split_hints_;
 };  // DashTable
 
 template <typename _Key, typename _Value, typename Policy>
@@ -593,6 +650,7 @@ void DashTable<_Key, _Value, Policy>::Clear() {
 
   IterateDistinct(cb);
   size_ = 0;
+  num_split_hints_ = 0;
 
   // Consider the following case: table with 8 segments overall, 4 distinct.
   // S1, S1, S1, S1, S2, S3, S4, S4
@@ -700,6 +758,53 @@ auto DashTable<_Key, _Value, Policy>::Find(U&& key) -> iterator {
   return iterator{};
 }
 
+template <typename _Key, typename _Value, typename Policy>
+template <typename U>
+auto DashTable<_Key, _Value, Policy>::Find(U&& key, uint64_t key_hash) -> iterator {
+  uint32_t segid = SegmentId(key_hash);
+  const auto* target = segment_[segid];
+
+  auto seg_it = target->FindIt(key, key_hash, EqPred());
+  if (seg_it.found()) {
+    return iterator{this, segid, seg_it.index, seg_it.slot};
+  }
+  return iterator{};
+}
+
+template <typename _Key, typename _Value, typename Policy>
+template <typename Pred>
+auto DashTable<_Key, _Value, Policy>::FindFirst(uint64_t key_hash, Pred&& pred) -> iterator {
+  uint32_t segid = SegmentId(key_hash);
+  const auto* target = segment_[segid];
+
+  auto cf = [&](const Key_t& slot_key, std::nullptr_t) { return pred(slot_key); };
+  auto seg_it = target->FindIt(nullptr, key_hash, cf);
+  if (seg_it.found()) {
+    return iterator{this, segid, seg_it.index, seg_it.slot};
+  }
+  return iterator{};
+}
+
+template <typename _Key, typename _Value, typename Policy>
+template <typename U>
+void DashTable<_Key, _Value, Policy>::FindMany(absl::Span<const U> keys,
+                                               absl::Span<iterator> res) {
+  assert(keys.size() == res.size());
+  uint64_t hashes[kPrefetchGroup];
+
+  for (size_t start = 0; start < keys.size(); start += kPrefetchGroup) {
+    size_t len = std::min<size_t>(kPrefetchGroup, keys.size() - start);
+    for (size_t i = 0; i < len; ++i) {
+      hashes[i] = DoHash(keys[start + i]);
+      Prefetch(hashes[i]);
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+      res[start + i] = Find(keys[start + i], hashes[i]);
+    }
+  }
+}
+
 template <typename _Key, typename _Value, typename Policy>
 size_t DashTable<_Key, _Value, Policy>::Erase(const Key_t& key) {
   uint64_t key_hash = DoHash(key);
@@ -772,6 +877,8 @@ auto DashTable<_Key, _Value, Policy>::InsertInternal(U&& key, V&& value, Evictio
 
     if (res) {  // success
       ++size_;
+      if (split_ahead_size_ && it.index >= kLogicalBucketNum)
+        RecordSplitHint(target_seg_id, key_hash);
       return std::make_pair(iterator{this, target_seg_id, it.index, it.slot}, true);
     }
 
@@ -856,6 +963,65 @@ auto DashTable<_Key, _Value, Policy>::InsertInternal(U&& key, V&& value, Evictio
   return std::make_pair(iterator{}, false);
 }
 
+template <typename _Key, typename _Value, typename Policy>
+void DashTable<_Key, _Value, Policy>::RecordSplitHint(uint32_t seg_id, uint64_t key_hash) {
+  if (num_split_hints_ == kMaxSplitHints)
+    return;
+
+  // Consecutive inserts into the same segment would hint it repeatedly.
+  if (num_split_hints_ > 0 && SegmentId(split_hints_[num_split_hints_ - 1]) == seg_id)
+    return;
+
+  if (segment_[seg_id]->size() >= split_ahead_size_)
+    split_hints_[num_split_hints_++] = key_hash;
+}
+
+template <typename _Key, typename _Value, typename Policy>
+template <typename EvictionPolicy, typename Cb>
+unsigned DashTable<_Key, _Value, Policy>::SplitAheadStep(unsigned max_splits, EvictionPolicy& ev,
+                                                         uint64_t ver_threshold, Cb&& cb) {
+  unsigned splits = 0;
+  while (num_split_hints_ > 0 && splits < max_splits) {
+    uint64_t key_hash = split_hints_[--num_split_hints_];
+    uint32_t seg_id = SegmentId(key_hash);
+    SegmentType* target = segment_[seg_id];
+
+    // The segment could have been split or emptied since it was hinted.
+    if (target->size() < split_ahead_size_)
+      continue;
+
+    if (!ev.CanGrow(*this)) {
+      num_split_hints_ = 0;
+      break;
+    }
+
+    bool increase_depth = target->local_depth() == global_depth_;
+    if (increase_depth && splits > 0) {
+      ++num_split_hints_;  // Keep the hint for the next call.
+      break;
+    }
+
+    // Split reshuffles the entries of the whole segment.
+    if constexpr (kUseVersion) {
+      for (uint8_t i = 0; i < kPhysicalBucketNum; ++i) {
+        if (target->GetVersion(i) < ver_threshold && !target->GetBucket(i).IsEmpty()) {
+          cb(bucket_iterator{this, seg_id, i});
+        }
+      }
+    }
+
+    if (increase_depth) {
+      IncreaseDepth(global_depth_ + 1);
+      seg_id = SegmentId(key_hash);
+    }
+
+    ev.RecordSplit(target);
+    Split(seg_id);
+    ++splits;
+  }
+  return splits;
+}
+
 template <typename _Key, typename _Value, typename Policy>
 void DashTable<_Key, _Value, Policy>::IncreaseDepth(unsigned new_depth) {
   assert(!segment_.empty());
@@ -23,6 +23,10 @@ using namespace std;
 ABSL_FLAG(uint32_t, n, 100000, "num items");
 ABSL_FLAG(string, type, "dash", "");
 ABSL_FLAG(bool, sds, false, "If true, uses sds as primary key");
+ABSL_FLAG(bool, find, false,
+          "If true, measures lookups of the inserted items and of the same number of missing ones");
+ABSL_FLAG(uint32_t, find_batch, 0,
+          "If positive, --find looks up keys in batches of this size using FindMany");
 
 namespace dfly {
 
@@ -138,6 +142,45 @@ void BenchDash(uint64_t num) {
   }
 }
 
+void BenchDashFind(uint64_t num) {
+  for (uint64_t i = 0; i < num; ++i) {
+    udt.Insert(i, 0);
+  }
+
+  // Misses probe the neighbour and the stash buckets as well.
+  uint64_t found = 0;
+  uint32_t batch = GetFlag(FLAGS_find_batch);
+  if (batch == 0) {
+    for (uint64_t i = 0; i < num * 2; ++i) {
+      time_t start = GetNow();
+      found += !udt.Find(i).is_done();
+      LFENCE;
+
+      time_t end = GetNow();
+      Sample(start, end, &hist);
+    }
+  } else {
+    // Samples the average latency per key of every batch.
+    vector<uint64_t> keys(batch);
+    vector<Dash64::iterator> res(batch);
+    for (uint64_t i = 0; i < num * 2; i += batch) {
+      size_t len = min<uint64_t>(batch, num * 2 - i);
+      for (size_t j = 0; j < len; ++j)
+        keys[j] = i + j;
+
+      time_t start = GetNow();
+      udt.FindMany(absl::Span<const uint64_t>(keys.data(), len), absl::MakeSpan(res.data(), len));
+      LFENCE;
+      time_t end = GetNow();
+      Sample(start, start + (end - start) / len, &hist);
+
+      for (size_t j = 0; j < len; ++j)
+        found += !res[j].is_done();
+    }
+  }
+  CHECK_EQ(found, num);
+}
+
 inline sds Prefix() {
   return sdsnew("xxxxxxxxxxxxxxxxxxxxxxx");
 }
@@ -208,6 +251,8 @@ int main(int argc, char* argv[]) {
   if (table_type == "dash") {
     if (is_sds) {
       BenchDashSds(num);
+    } else if (GetFlag(FLAGS_find)) {
+      BenchDashFind(num);
     } else {
       BenchDash(num);
     }
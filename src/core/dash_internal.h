@@ -208,6 +208,9 @@ template <unsigned NUM_SLOTS, unsigned NUM_STASH_FPS> class BucketBase {
 
  protected:
   uint32_t CompareFP(uint8_t fp) const;
+
+  // Returns the mask of stash fps equal to fp, regardless of whether they are busy.
+  uint32_t CompareStashFP(uint8_t fp) const;
   bool ShiftRight();
 
   // Returns true if stash_pos was stored, false overwise
@@ -427,6 +430,11 @@ template <typename _Key, typename _Value, typename Policy = DefaultSegmentPolicy
 
   size_t SlowSize() const;
 
+  // Number of entries, maintained on insertion and deletion unlike SlowSize().
+  size_t size() const {
+    return size_;
+  }
+
   static constexpr size_t capacity() {
     return kMaxSize;
   }
@@ -511,6 +519,11 @@ template <typename _Key, typename _Value, typename Policy = DefaultSegmentPolicy
 
   template <typename U, typename Pred> Iterator FindIt(U&& key, Hash_t key_hash, Pred&& cf) const;
 
+  // Prefetches the home bucket of key_hash, which FindIt accesses first.
+  void Prefetch(Hash_t key_hash) const {
+    __builtin_prefetch(&bucket_[BucketIndex(key_hash)]);
+  }
+
   // Returns valid iterator if succeeded or invalid if not (it's full).
   // Requires: key should be not present in the segment.
   // if spread is true, tries to spread the load between neighbour and home buckets,
@@ -605,7 +618,8 @@ template <typename _Key, typename _Value, typename Policy = DefaultSegmentPolicy
   Iterator TryMoveFromStash(unsigned stash_id, unsigned stash_slot_id, Hash_t key_hash);
 
   Bucket bucket_[kTotalBuckets];
-  size_t local_depth_;
+  uint32_t local_depth_;
+  uint32_t size_ = 0;
 
  public:
   static constexpr size_t kBucketSz = sizeof(Bucket);
@@ -968,23 +982,38 @@ template <unsigned NUM_SLOTS, unsigned NUM_OVR> bool BucketBase<NUM_SLOTS, NUM_O
   return res;
 }
 
+template <unsigned NUM_SLOTS, unsigned NUM_OVR>
+uint32_t BucketBase<NUM_SLOTS, NUM_OVR>::CompareStashFP(uint8_t fp) const {
+  // All the stash fps fit into a single word, so we compare them at once (SWAR).
+  uint32_t stash = 0;
+  memcpy(&stash, stash_arr_.data(), kStashFpLen);
+  stash = absl::little_endian::ToHost32(stash);
+
+  // Bytes equal to fp become zero. Then set the msb of every zero byte, without the false
+  // positives of the cheaper (x - 0x01..) & ~x & 0x80.. trick.
+  uint32_t x = stash ^ (0x01010101u * fp);
+  uint32_t zero_msb = ~(((x & 0x7F7F7F7Fu) + 0x7F7F7F7Fu) | x) & 0x80808080u;
+
+  // Gathers bits 7, 15, 23, 31 into bits 21-24 and shifts them down to bits 0-3.
+  return (((zero_msb >> 7) * 0x00204081u) >> 21) & 0xF;
+}
+
 template <unsigned NUM_SLOTS, unsigned NUM_OVR>
 template <typename F>
 auto BucketBase<NUM_SLOTS, NUM_OVR>::IterateStash(uint8_t fp, bool is_probe, F&& func) const
     -> ::std::pair<unsigned, SlotId> {
   unsigned om = is_probe ? stash_probe_mask_ : ~stash_probe_mask_;
-  unsigned ob = stash_busy_;
-
-  for (unsigned i = 0; i < kStashFpLen; ++i) {
-    if ((ob & 1) && (stash_arr_[i] == fp) && (om & 1)) {
-      unsigned pos = (stash_pos_ >> (i * 2)) & 3;
-      auto sid = func(i, pos);
-      if (sid != BucketBase::kNanSlot) {
-        return std::pair<unsigned, SlotId>(pos, sid);
-      }
+  unsigned mask = CompareStashFP(fp) & stash_busy_ & om & ((1u << kStashFpLen) - 1);
+
+  while (mask) {
+    unsigned i = __builtin_ctz(mask);
+    mask &= mask - 1;
+
+    unsigned pos = (stash_pos_ >> (i * 2)) & 3;
+    auto sid = func(i, pos);
+    if (sid != BucketBase::kNanSlot) {
+      return std::pair<unsigned, SlotId>(pos, sid);
     }
-    ob >>= 1;
-    om >>= 1;
   }
   return std::pair<unsigned, SlotId>(0, BucketBase::kNanSlot);
 }
@@ -1024,18 +1053,15 @@ template <typename Key, typename Value, typename Policy>
 template <typename U, typename Pred>
 auto Segment<Key, Value, Policy>::Bucket::FindByFp(uint8_t fp_hash, bool probe, U&& k,
                                                    Pred&& pred) const -> SlotId {
+  // A single SIMD compare yields the slots whose fingerprint matches, so we visit only them.
   unsigned mask = this->Find(fp_hash, probe);
-  if (!mask)
-    return kNanSlot;
-
-  unsigned delta = __builtin_ctz(mask);
-  mask >>= delta;
-  for (unsigned i = delta; i < NUM_SLOTS; ++i) {
-    if ((mask & 1) && pred(key[i], k)) {
+  while (mask) {
+    unsigned i = __builtin_ctz(mask);
+    if (pred(key[i], k)) {
       return i;
     }
-    mask >>= 1;
-  };
+    mask &= mask - 1;
+  }
 
   return kNanSlot;
 }
@@ -1191,6 +1217,7 @@ template <typename Key, typename Value, typename Policy> void Segment<Key, Value
   for (unsigned i = 0; i < kTotalBuckets; ++i) {
     bucket_[i].Clear();
   }
+  size_ = 0;
 }
 
 template <typename Key, typename Value, typename Policy>
@@ -1204,6 +1231,7 @@ void Segment<Key, Value, Policy>::Delete(const Iterator& it, Hash_t key_hash) {
   }
 
   b.Delete(it.slot);
+  --size_;
 }
 
 // Split items from the left segment to the right during the growth phase.
@@ -1232,6 +1260,7 @@ void Segment<Key, Value, Policy>::Split(HFunc&& hfn, Segment* dest_right) {
         return;  // keep this key in the source
 
       invalid_mask |= (1u << slot);
+      --size_;
 
       Iterator it = dest_right->InsertUniq(std::forward<Key_t>(bucket->key[slot]),
                                            std::forward<Value_t>(bucket->value[slot]), hash, false);
@@ -1288,6 +1317,7 @@ void Segment<Key, Value, Policy>::Split(HFunc&& hfn, Segment* dest_right) {
       }
 
       invalid_mask |= (1u << slot);
+      --size_;
       auto it = dest_right->InsertUniq(std::forward<Key_t>(bucket->key[slot]),
                                        std::forward<Value_t>(bucket->value[slot]), hash, false);
       (void)it;
@@ -1401,12 +1431,14 @@ auto Segment<Key, Value, Policy>::InsertUniq(U&& key, V&& value, Hash_t key_hash
   int slot = insert_first->FindEmptySlot();
   if (slot >= 0) {
     insert_first->Insert(slot, std::forward<U>(key), std::forward<V>(value), meta_hash, probe);
+    ++size_;
 
     return Iterator{uint8_t(insert_first - bucket_), uint8_t(slot)};
   } else if (!spread) {
     int slot = neighbor.FindEmptySlot();
     if (slot >= 0) {
       neighbor.Insert(slot, std::forward<U>(key), std::forward<V>(value), meta_hash, true);
+      ++size_;
       return Iterator{nid, uint8_t(slot)};
     }
   }
@@ -1414,6 +1446,7 @@ auto Segment<Key, Value, Policy>::InsertUniq(U&& key, V&& value, Hash_t key_hash
   int displace_index = MoveToOther(true, nid, NextBid(nid));
   if (displace_index >= 0) {
     neighbor.Insert(displace_index, std::forward<U>(key), std::forward<V>(value), meta_hash, true);
+    ++size_;
     return Iterator{nid, uint8_t(displace_index)};
   }
 
@@ -1421,6 +1454,7 @@ auto Segment<Key, Value, Policy>::InsertUniq(U&& key, V&& value, Hash_t key_hash
   displace_index = MoveToOther(false, bid, prev_idx);
   if (displace_index >= 0) {
     target.Insert(displace_index, std::forward<U>(key), std::forward<V>(value), meta_hash, false);
+    ++size_;
     return Iterator{bid, uint8_t(displace_index)};
   }
 
@@ -1431,6 +1465,7 @@ auto Segment<Key, Value, Policy>::InsertUniq(U&& key, V&& value, Hash_t key_hash
                                        std::forward<V>(value), meta_hash, false);
     if (stash_slot >= 0) {
       target.SetStashPtr(stash_pos, meta_hash, &neighbor);
+      ++size_;
       return Iterator{uint8_t(kRegularBucketCnt + stash_pos), uint8_t(stash_slot)};
     }
   }
@@ -198,6 +198,41 @@ TEST_F(DashTest, SlotBitmap) {
   EXPECT_EQ(2, slot.GetProbe(true));
 }
 
+TEST_F(DashTest, BucketFp) {
+  using Bucket = detail::BucketBase<14, 4>;
+  Bucket bucket{}, next{};
+  bucket.SetHash(0, 7, false);
+  bucket.SetHash(3, 7, true);
+  bucket.SetHash(13, 7, false);
+  bucket.SetHash(5, 0, false);
+  EXPECT_EQ((1u << 0) | (1u << 13), bucket.Find(7, false));
+  EXPECT_EQ(1u << 3, bucket.Find(7, true));
+  EXPECT_EQ(1u << 5, bucket.Find(0, false));
+  EXPECT_EQ(0u, bucket.Find(8, false));
+
+  // Fps 0x80 and 0x7F differ only in the high bit and must not match each other.
+  const uint8_t fps[] = {0x80, 0x7F, 0x80, 0};
+  for (unsigned i = 0; i < 4; ++i) {
+    bucket.SetStashPtr(i, fps[i], &next);
+  }
+  bucket.SetStashPtr(1, 0x80, &next);  // goes to the neighbour as a probing fp
+
+  auto stash_positions = [](const Bucket& b, uint8_t fp, bool probe) {
+    vector<unsigned> res;
+    b.IterateStash(fp, probe, [&](unsigned, unsigned pos) -> Bucket::SlotId {
+      res.push_back(pos);
+      return Bucket::kNanSlot;
+    });
+    return res;
+  };
+  EXPECT_EQ(vector<unsigned>({0, 2}), stash_positions(bucket, 0x80, false));
+  EXPECT_EQ(vector<unsigned>({1}), stash_positions(bucket, 0x7F, false));
+  EXPECT_EQ(vector<unsigned>({3}), stash_positions(bucket, 0, false));
+  EXPECT_EQ(vector<unsigned>{}, stash_positions(bucket, 0xFF, false));
+  EXPECT_EQ(vector<unsigned>({1}), stash_positions(next, 0x80, true));
+  EXPECT_EQ(vector<unsigned>{}, stash_positions(next, 0x80, false));
+}
+
 TEST_F(DashTest, Basic) {
   Segment::Key_t key = 0;
   Segment::Value_t val = 0;
@@ -330,6 +365,8 @@ TEST_F(DashTest, Split) {
 
   ASSERT_EQ(segment_.SlowSize(), sum[0]);
   EXPECT_EQ(s2.SlowSize(), sum[1]);
+  EXPECT_EQ(segment_.SlowSize(), segment_.size());
+  EXPECT_EQ(s2.SlowSize(), s2.size());
   EXPECT_EQ(keys.size(), sum[0] + sum[1]);
   EXPECT_EQ(4 * Segment::kNumSlots, keys.size());
 }
@@ -342,6 +379,7 @@ TEST_F(DashTest, Merge) {
   ASSERT_EQ(segment_.SlowSize() + s2.SlowSize(), keys.size());
   segment_.MoveFrom(&UInt64Policy::HashFn, &s2);
   EXPECT_EQ(segment_.SlowSize(), keys.size());
+  EXPECT_EQ(segment_.size(), keys.size());
 }
 
 TEST_F(DashTest, BumpUp) {
@@ -522,6 +560,31 @@ TEST_F(DashTest, Insert) {
   ASSERT_TRUE(dt_.Find(some_val).is_done());
 }
 
+TEST_F(DashTest, FindMany) {
+  constexpr size_t kNumItems = 1000;
+  for (size_t i = 0; i < kNumItems; ++i) {
+    dt_.Insert(i, i * 2);
+  }
+
+  // Mixes present and missing keys, more of them than fit into a single prefetch group.
+  vector<uint64_t> keys;
+  for (size_t i = 0; i < kNumItems * 2; i += 3) {
+    keys.push_back(i);
+  }
+  vector<Dash64::iterator> res(keys.size());
+  dt_.FindMany(absl::Span<const uint64_t>(keys), absl::MakeSpan(res));
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (keys[i] < kNumItems) {
+      ASSERT_FALSE(res[i].is_done()) << keys[i];
+      EXPECT_EQ(keys[i], res[i]->first);
+      EXPECT_EQ(keys[i] * 2, res[i]->second);
+    } else {
+      EXPECT_TRUE(res[i].is_done()) << keys[i];
+    }
+  }
+}
+
 TEST_F(DashTest, Traverse) {
   constexpr auto kNumItems = 50;
   for (size_t i = 0; i < kNumItems; ++i) {
@@ -759,6 +822,47 @@ TEST_F(DashTest, CVCUponInsert) {
   dt.CVCUponInsert(1, i, cb);
 }
 
+TEST_F(DashTest, SplitAhead) {
+  struct CountingPolicy : public VersionDT::DefaultEvictionPolicy {
+    void RecordSplit(VersionDT::Segment_t*) {
+      ++splits;
+    }
+    unsigned splits = 0;
+  };
+
+  VersionDT dt;
+  dt.SetSplitAheadUtilization(0.8);
+  CountingPolicy inline_ev, ahead_ev;
+  unsigned bucket_cbs = 0;
+  auto cb = [&](VersionDT::bucket_iterator bit) {
+    ASSERT_LT(bit.GetVersion(), 2u);
+    bit.SetVersion(2);
+    ++bucket_cbs;
+  };
+
+  constexpr int kNum = 20000;
+  for (int i = 0; i < kNum; ++i) {
+    auto it = dt.Insert(i, i, inline_ev).first;
+    it.SetVersion(1);
+    if (i % 64 == 0) {
+      // The directory is doubled at most once per step.
+      size_t dir_size = dt.GetSegmentCount();
+      dt.SplitAheadStep(4, ahead_ev, 2, cb);
+      ASSERT_LE(dt.GetSegmentCount(), dir_size * 2);
+    }
+  }
+
+  // Hinted segments are split before they fill up, mostly sparing the inserts from splitting.
+  EXPECT_GT(ahead_ev.splits, inline_ev.splits);
+  EXPECT_GT(bucket_cbs, 0u);
+  EXPECT_EQ(kNum, dt.size());
+  for (int i = 0; i < kNum; ++i) {
+    auto it = dt.Find(i);
+    ASSERT_FALSE(it.is_done()) << i;
+    EXPECT_EQ(i, it->second);
+  }
+}
+
 struct A {
   int a = 0;
   unsigned moved = 0;
@@ -4,6 +4,7 @@
 
 #include "core/dense_set.h"
 
+#include <absl/container/flat_hash_set.h>
 #include <absl/numeric/bits.h>
 
 #include <cstddef>
@@ -25,8 +26,25 @@ constexpr size_t kMinSizeShift = 2;
 constexpr size_t kMinSize = 1 << kMinSizeShift;
 constexpr bool kAllowDisplacements = true;
 
+// Buckets moved to the grown bucket vector on every insertion while rehashing.
+constexpr size_t kRehashBucketsPerInsert = 4;
+
+namespace {
+
+// The sets of the thread that are rehashing, see DenseSet::RehashStepAll().
+absl::flat_hash_set<DenseSet*>& RehashingSets() {
+  static thread_local absl::flat_hash_set<DenseSet*> sets;
+  return sets;
+}
+
+}  // namespace
+
 DenseSet::IteratorBase::IteratorBase(const DenseSet* owner, bool is_end)
     : owner_(const_cast<DenseSet*>(owner)), curr_entry_(nullptr) {
+  // Iteration covers entries_ only.
+  if (!is_end)
+    owner_->FinishRehash();
+
   curr_list_ = is_end ? owner_->entries_.end() : owner_->entries_.begin();
 
   // Even if `is_end` is `false`, the list can be empty.
@@ -73,7 +91,7 @@ void DenseSet::IteratorBase::Advance() {
   DCHECK(!curr_entry_->IsEmpty());
 }
 
-DenseSet::DenseSet(MemoryResource* mr) : entries_(mr) {
+DenseSet::DenseSet(MemoryResource* mr) : entries_(mr), old_entries_(mr) {
 }
 
 DenseSet::~DenseSet() {
@@ -82,14 +100,16 @@ DenseSet::~DenseSet() {
   CHECK(entries_.empty());
 }
 
-size_t DenseSet::PushFront(DenseSet::ChainVectorIterator it, void* data, bool has_ttl) {
+size_t DenseSet::PushFront(DenseSet::ChainVectorIterator it, void* data, bool has_ttl,
+                           uint8_t fp) {
   // if this is an empty list assign the value to the empty placeholder pointer
   if (it->IsEmpty()) {
     it->SetObject(data);
   } else {
     // otherwise make a new link and connect it to the front of the list
-    it->SetLink(NewLink(data, *it));
+    it->SetLink(NewLink(data, *it, fp));
   }
+  it->SetFingerprint(fp);
 
   if (has_ttl) {
     it->SetTtl(true);
@@ -104,6 +124,7 @@ void DenseSet::PushFront(DenseSet::ChainVectorIterator it, DenseSet::DensePtr pt
 
   if (it->IsEmpty()) {
     it->SetObject(ptr.GetObject());
+    it->SetFingerprint(ptr.GetFingerprint());
     if (ptr.HasTtl()) {
       it->SetTtl(true);
       expiration_used_ = true;
@@ -120,7 +141,8 @@ void DenseSet::PushFront(DenseSet::ChainVectorIterator it, DenseSet::DensePtr pt
     DCHECK(ptr.IsObject());
 
     // allocate a new link if needed and copy the pointer to the new link
-    it->SetLink(NewLink(ptr.Raw(), *it));
+    it->SetLink(NewLink(ptr.Raw(), *it, ptr.GetFingerprint()));
+    it->SetFingerprint(ptr.GetFingerprint());
     if (ptr.HasTtl()) {
       it->SetTtl(true);
       expiration_used_ = true;
@@ -167,6 +189,15 @@ void* DenseSet::PopDataFront(DenseSet::ChainVectorIterator it) {
 }
 
 void DenseSet::ClearInternal() {
+  for (auto it = old_entries_.begin(); it != old_entries_.end(); ++it) {
+    while (!it->IsEmpty()) {
+      bool has_ttl = it->HasTtl();
+      ObjDelete(PopDataFront(it), has_ttl);
+    }
+  }
+  rehash_pos_ = 0;
+  RehashStep(0);  // releases old_entries_.
+
   for (auto it = entries_.begin(); it != entries_.end(); ++it) {
     while (!it->IsEmpty()) {
       bool has_ttl = it->HasTtl();
@@ -189,8 +220,8 @@ void DenseSet::ClearInternal() {
   expiration_used_ = false;
 }
 
-bool DenseSet::Equal(DensePtr dptr, const void* ptr, uint32_t cookie) const {
-  if (dptr.IsEmpty()) {
+bool DenseSet::Equal(DensePtr dptr, const void* ptr, uint32_t cookie, uint8_t fp) const {
+  if (dptr.IsEmpty() || dptr.GetFingerprint() != fp) {
     return false;
   }
 
@@ -252,6 +283,7 @@ auto DenseSet::FindEmptyAround(uint32_t bid) -> ChainVectorIterator {
 }
 
 void DenseSet::Reserve(size_t sz) {
+  FinishRehash();
   sz = std::max<size_t>(sz, kMinSize);
 
   sz = absl::bit_ceil(sz);
@@ -345,7 +377,7 @@ auto DenseSet::AddOrFindDense(void* ptr, bool has_ttl) -> DensePtr* {
     entries_.resize(kMinSize);
     uint32_t bucket_id = BucketId(hc);
     auto e = entries_.begin() + bucket_id;
-    obj_malloc_used_ += PushFront(e, ptr, has_ttl);
+    obj_malloc_used_ += PushFront(e, ptr, has_ttl, Fingerprint(hc));
     ++size_;
     ++num_used_buckets_;
 
@@ -353,8 +385,7 @@ auto DenseSet::AddOrFindDense(void* ptr, bool has_ttl) -> DensePtr* {
   }
 
   // if the value is already in the set exit early
-  uint32_t bucket_id = BucketId(hc);
-  DensePtr* dptr = Find(ptr, bucket_id, 0).second;
+  DensePtr* dptr = Find(ptr, hc, 0).second;
   if (dptr != nullptr) {
     return dptr;
   }
@@ -374,12 +405,14 @@ void DenseSet::AddUnique(void* obj, bool has_ttl, uint64_t hashcode) {
 
   DCHECK_LT(bucket_id, entries_.size());
 
+  RehashStep(kRehashBucketsPerInsert);
+
   // Try insert into flat surface first. Also handle the grow case
   // if utilization is too high.
   for (unsigned j = 0; j < 2; ++j) {
     ChainVectorIterator list = FindEmptyAround(bucket_id);
     if (list != entries_.end()) {
-      obj_malloc_used_ += PushFront(list, obj, has_ttl);
+      obj_malloc_used_ += PushFront(list, obj, has_ttl, Fingerprint(hashcode));
       if (std::distance(entries_.begin(), list) != bucket_id) {
         list->SetDisplaced(std::distance(entries_.begin() + bucket_id, list));
       }
@@ -392,11 +425,7 @@ void DenseSet::AddUnique(void* obj, bool has_ttl, uint64_t hashcode) {
       break;
     }
 
-    size_t prev_size = entries_.size();
-    entries_.resize(prev_size * 2);
-    ++capacity_log_;
-
-    Grow(prev_size);
+    StartRehash();
     bucket_id = BucketId(hashcode);
   }
 
@@ -413,11 +442,19 @@ void DenseSet::AddUnique(void* obj, bool has_ttl, uint64_t hashcode) {
    */
 
   DensePtr to_insert(obj);
+  to_insert.SetFingerprint(Fingerprint(hashcode));
   if (has_ttl) {
     to_insert.SetTtl(true);
     expiration_used_ = true;
   }
 
+  InsertHome(to_insert, bucket_id);
+  obj_malloc_used_ += ObjectAllocSize(obj);
+
+  ++size_;
+}
+
+void DenseSet::InsertHome(DensePtr to_insert, uint32_t bucket_id) {
   while (!entries_[bucket_id].IsEmpty() && entries_[bucket_id].IsDisplaced()) {
     DensePtr unlinked = PopPtrFront(entries_.begin() + bucket_id);
 
@@ -429,20 +466,94 @@ void DenseSet::AddUnique(void* obj, bool has_ttl, uint64_t hashcode) {
   DCHECK_EQ(BucketId(to_insert.GetObject(), 0), bucket_id);
   ChainVectorIterator list = entries_.begin() + bucket_id;
   PushFront(list, to_insert);
-  obj_malloc_used_ += ObjectAllocSize(obj);
   DCHECK(!entries_[bucket_id].IsDisplaced());
+}
 
-  ++size_;
+void DenseSet::StartRehash() {
+  FinishRehash();
+
+  old_entries_.swap(entries_);
+  entries_.resize(old_entries_.size() * 2);
+  ++capacity_log_;
+  rehash_pos_ = old_entries_.size();
+  RehashingSets().insert(this);
+}
+
+void DenseSet::DetachFromThread() {
+  RehashingSets().erase(this);
 }
 
-auto DenseSet::Find2(const void* ptr, uint32_t bid, uint32_t cookie)
+void DenseSet::AttachToThread() {
+  if (IsRehashing())
+    RehashingSets().insert(this);
+}
+
+size_t DenseSet::RehashStep(size_t max_buckets) {
+  size_t moved = 0;
+  for (; moved < max_buckets && rehash_pos_ > 0; ++moved) {
+    RehashBucket(--rehash_pos_);
+  }
+
+  if (rehash_pos_ == 0 && IsRehashing()) {
+    decltype(old_entries_)(old_entries_.get_allocator()).swap(old_entries_);
+    RehashingSets().erase(this);
+  }
+  return moved;
+}
+
+void DenseSet::RehashAround(uint32_t old_bid) {
+  // Objects of an old bucket may be displaced to its neighbours.
+  RehashBucket(old_bid);
+  if (old_bid > 0)
+    RehashBucket(old_bid - 1);
+  if (old_bid + 1 < old_entries_.size())
+    RehashBucket(old_bid + 1);
+}
+
+bool DenseSet::RehashBucket(uint32_t old_bid) {
+  auto it = old_entries_.begin() + old_bid;
+  bool moved = false;
+  while (!it->IsEmpty()) {
+    if (ExpireIfNeeded(nullptr, &*it) && it->IsEmpty())
+      break;
+
+    DensePtr dptr = PopPtrFront(it);
+    dptr.ClearDisplaced();
+    InsertHome(dptr, BucketId(dptr.GetObject(), 0));
+    moved = true;
+  }
+  return moved;
+}
+
+size_t DenseSet::RehashStepAll(size_t max_buckets) {
+  auto& rehashing = RehashingSets();
+  if (rehashing.empty())
+    return 0;
+
+  // RehashStep removes the sets that are done.
+  vector<DenseSet*> sets(rehashing.begin(), rehashing.end());
+  size_t moved = 0;
+  for (DenseSet* ds : sets) {
+    if (moved >= max_buckets)
+      break;
+    moved += ds->RehashStep(max_buckets - moved);
+  }
+  return moved;
+}
+
+auto DenseSet::Find2(const void* ptr, uint64_t hash, uint32_t cookie)
     -> tuple<size_t, DensePtr*, DensePtr*> {
+  if (IsRehashing())
+    RehashHome(hash);
+
+  uint32_t bid = BucketId(hash);
+  uint8_t fp = Fingerprint(hash);
   DCHECK_LT(bid, entries_.size());
 
   DensePtr* curr = &entries_[bid];
   ExpireIfNeeded(nullptr, curr);
 
-  if (Equal(*curr, ptr, cookie)) {
+  if (Equal(*curr, ptr, cookie, fp)) {
     return {bid, nullptr, curr};
   }
 
@@ -451,7 +562,7 @@ auto DenseSet::Find2(const void* ptr, uint32_t bid, uint32_t cookie)
     curr = &entries_[bid - 1];
     ExpireIfNeeded(nullptr, curr);
 
-    if (Equal(*curr, ptr, cookie)) {
+    if (Equal(*curr, ptr, cookie, fp)) {
       return {bid - 1, nullptr, curr};
     }
   }
@@ -460,7 +571,7 @@ auto DenseSet::Find2(const void* ptr, uint32_t bid, uint32_t cookie)
     curr = &entries_[bid + 1];
     ExpireIfNeeded(nullptr, curr);
 
-    if (Equal(*curr, ptr, cookie)) {
+    if (Equal(*curr, ptr, cookie, fp)) {
       return {bid + 1, nullptr, curr};
     }
   }
@@ -471,7 +582,7 @@ auto DenseSet::Find2(const void* ptr, uint32_t bid, uint32_t cookie)
   while (curr != nullptr) {
     ExpireIfNeeded(prev, curr);
 
-    if (Equal(*curr, ptr, cookie)) {
+    if (Equal(*curr, ptr, cookie, fp)) {
       return {bid, prev, curr};
     }
     prev = curr;
@@ -516,6 +627,13 @@ void DenseSet::Delete(DensePtr* prev, DensePtr* ptr) {
 }
 
 void* DenseSet::PopInternal() {
+  // Make sure entries_ has an object to pop, if any is left in old_entries_.
+  for (uint32_t bid = 0; bid < rehash_pos_; ++bid) {
+    if (RehashBucket(bid))
+      break;
+  }
+  RehashStep(kRehashBucketsPerInsert);
+
   ChainVectorIterator bucket_iter = entries_.begin();
 
   // find the first non-empty chain
@@ -586,12 +704,19 @@ uint32_t DenseSet::Scan(uint32_t cursor, const ItemCb& cb) const {
 
   uint32_t entries_idx = cursor >> (32 - capacity_log_);
 
-  auto& entries = const_cast<DenseSet*>(this)->entries_;
+  DenseSet* mself = const_cast<DenseSet*>(this);
+  auto& entries = mself->entries_;
 
   // First find the bucket to scan, skip empty buckets.
   // A bucket is empty if the current index is empty and the data is not displaced
-  // to the right or to the left.
-  while (entries_idx < entries_.size() && NoItemBelongsBucket(entries_idx)) {
+  // to the right or to the left. While growing, the objects of the bucket may still be in
+  // old_entries_, so they are moved first. Objects only move to buckets of the same cursor prefix,
+  // thus the buckets before the cursor are not affected.
+  while (entries_idx < entries_.size()) {
+    if (IsRehashing())
+      mself->RehashAround(entries_idx >> 1);
+    if (!NoItemBelongsBucket(entries_idx))
+      break;
     ++entries_idx;
   }
 
@@ -647,13 +772,14 @@ uint32_t DenseSet::Scan(uint32_t cursor, const ItemCb& cb) const {
   return entries_idx << (32 - capacity_log_);
 }
 
-auto DenseSet::NewLink(void* data, DensePtr next) -> DenseLinkKey* {
+auto DenseSet::NewLink(void* data, DensePtr next, uint8_t fp) -> DenseLinkKey* {
   LinkAllocator la(mr());
   DenseLinkKey* lk = la.allocate(1);
   la.construct(lk);
 
   lk->next = next;
   lk->SetObject(data);
+  lk->SetFingerprint(fp);
   ++num_links_;
 
   return lk;
@@ -36,6 +36,15 @@ namespace dfly {
 // 75% utilization: N*1.33*8 + 0.12N*16 = 13N or ~22 bytes savings per record.
 // with potential replacements of hset/zset data structures.
 // static_assert(sizeof(dictEntry) == 24);
+//
+// When the table grows, the entries are moved to the new bucket vector incrementally: a few buckets
+// on every insertion, the home buckets of every looked up object and a bounded number of buckets
+// per call of RehashStepAll(). Scans move the buckets they visit, iterations complete the move
+// first.
+//
+// Every pointer to an object also keeps a 7-bit fingerprint of the object hash in its unused
+// high bits. Lookups compare fingerprints first, so most collisions and negative lookups are
+// resolved without touching the object memory.
 
 class DenseSet {
   struct DenseLinkKey;
@@ -47,8 +56,14 @@ class DenseSet {
   static constexpr size_t kDisplaceBit = 1ULL << 53;
   static constexpr size_t kDisplaceDirectionBit = 1ULL << 54;
   static constexpr size_t kTtlBit = 1ULL << 55;
+  static constexpr unsigned kFingerprintShift = 56;
+  static constexpr size_t kFingerprintMask = 127ULL << kFingerprintShift;
   static constexpr size_t kTagMask = 4095ULL << 51;  // we reserve 12 high bits.
 
+  static uint8_t Fingerprint(uint64_t hash) {
+    return hash & 127;
+  }
+
   class DensePtr {
    public:
     explicit DensePtr(void* p = nullptr) : ptr_(p) {
@@ -89,6 +104,14 @@ class DenseSet {
       return (uptr() & kDisplaceBit) == kDisplaceBit;
     }
 
+    uint8_t GetFingerprint() const {
+      return (uptr() & kFingerprintMask) >> kFingerprintShift;
+    }
+
+    void SetFingerprint(uint8_t fp) {
+      ptr_ = (void*)((uptr() & ~kFingerprintMask) | (uint64_t(fp) << kFingerprintShift));
+    }
+
     void SetLink(DenseLinkKey* lk) {
       ptr_ = (void*)(uintptr_t(lk) | kLinkBit);
     }
@@ -236,9 +259,31 @@ class DenseSet {
   }
 
   size_t SetMallocUsed() const {
-    return entries_.capacity() * sizeof(DensePtr) + num_links_ * sizeof(DenseLinkKey);
+    return (entries_.capacity() + old_entries_.capacity()) * sizeof(DensePtr) +
+           num_links_ * sizeof(DenseLinkKey);
+  }
+
+  // Whether the set still has entries in the bucket vector it had before growing.
+  bool IsRehashing() const {
+    return !old_entries_.empty();
+  }
+
+  // Moves up to max_buckets buckets of the sets of the calling thread that are growing.
+  // Returns the number of moved buckets.
+  static size_t RehashStepAll(size_t max_buckets);
+
+  // Completes the growth of the set.
+  void FinishRehash() {
+    if (IsRehashing())
+      RehashStep(SIZE_MAX);
   }
 
+  // Growing sets are tracked by the thread that owns them, see RehashStepAll(). A set handed over
+  // to another thread must be detached on the old thread before, and attached on the new thread
+  // after the hand-over.
+  void DetachFromThread();
+  void AttachToThread();
+
   using ItemCb = std::function<void(const void*)>;
 
   uint32_t Scan(uint32_t cursor, const ItemCb& cb) const;
@@ -268,7 +313,7 @@ class DenseSet {
   void CollectExpired();
 
   bool EraseInternal(void* obj, uint32_t cookie) {
-    auto [prev, found] = Find(obj, BucketId(obj, cookie), cookie);
+    auto [prev, found] = Find(obj, Hash(obj, cookie), cookie);
     if (found) {
       Delete(prev, found);
       return true;
@@ -282,7 +327,7 @@ class DenseSet {
     if (Empty())
       return IteratorBase{};
 
-    auto [bid, _, curr] = Find2(ptr, BucketId(ptr, cookie), cookie);
+    auto [bid, _, curr] = Find2(ptr, Hash(ptr, cookie), cookie);
     if (curr) {
       return IteratorBase(this, entries_.begin() + bid, curr);
     }
@@ -322,7 +367,8 @@ class DenseSet {
   DenseSet(const DenseSet&) = delete;
   DenseSet& operator=(DenseSet&) = delete;
 
-  bool Equal(DensePtr dptr, const void* ptr, uint32_t cookie) const;
+  // fp is the fingerprint of ptr.
+  bool Equal(DensePtr dptr, const void* ptr, uint32_t cookie, uint8_t fp) const;
 
   MemoryResource* mr() {
     return entries_.get_allocator().resource();
@@ -345,8 +391,29 @@ class DenseSet {
   bool NoItemBelongsBucket(uint32_t bid) const;
   void Grow(size_t prev_size);
 
+  // ============ Incremental rehash between old_entries_ and entries_ ==================
+  // Moves the entries to a bucket vector twice as large, incrementally.
+  void StartRehash();
+
+  // Moves up to max_buckets buckets of old_entries_, returns the number of moved buckets.
+  size_t RehashStep(size_t max_buckets);
+
+  // Moves the old buckets that may hold objects with the given hash.
+  void RehashHome(uint64_t hash) {
+    RehashAround(hash >> (64 - capacity_log_ + 1));
+  }
+
+  // Moves the old bucket old_bid and its neighbours, which may hold its displaced objects.
+  void RehashAround(uint32_t old_bid);
+
+  // Returns whether any object was moved.
+  bool RehashBucket(uint32_t old_bid);
+
+  // Pushes the pointer to its home bucket bid, and moves displaced entries found there to theirs.
+  void InsertHome(DensePtr to_insert, uint32_t bid);
+
   // ============ Pseudo Linked List Functions for interacting with Chains ==================
-  size_t PushFront(ChainVectorIterator, void* obj, bool has_ttl);
+  size_t PushFront(ChainVectorIterator, void* obj, bool has_ttl, uint8_t fp);
   void PushFront(ChainVectorIterator, DensePtr);
 
   void* PopDataFront(ChainVectorIterator);
@@ -359,15 +426,15 @@ class DenseSet {
   // ============ Pseudo Linked List in DenseSet end ==================
 
   // returns (prev, item) pair. If item is root, then prev is null.
-  std::pair<DensePtr*, DensePtr*> Find(const void* ptr, uint32_t bid, uint32_t cookie) {
-    auto [_, p, c] = Find2(ptr, bid, cookie);
+  std::pair<DensePtr*, DensePtr*> Find(const void* ptr, uint64_t hash, uint32_t cookie) {
+    auto [_, p, c] = Find2(ptr, hash, cookie);
     return {p, c};
   }
 
   // returns bid and (prev, item) pair. If item is root, then prev is null.
-  std::tuple<size_t, DensePtr*, DensePtr*> Find2(const void* ptr, uint32_t bid, uint32_t cookie);
+  std::tuple<size_t, DensePtr*, DensePtr*> Find2(const void* ptr, uint64_t hash, uint32_t cookie);
 
-  DenseLinkKey* NewLink(void* data, DensePtr next);
+  DenseLinkKey* NewLink(void* data, DensePtr next, uint8_t fp);
 
   inline void FreeLink(DenseLinkKey* plink) {
     // deallocate the link if it is no longer a link as it is now in an empty list
@@ -391,6 +458,11 @@ class DenseSet {
 
   std::vector<DensePtr, DensePtrAllocator> entries_;
 
+  // The bucket vector before growing, while it is being rehashed into entries_.
+  // Buckets are moved from the end and are empty once moved.
+  std::vector<DensePtr, DensePtrAllocator> old_entries_;
+  uint32_t rehash_pos_ = 0;  // buckets of old_entries_ below this position were not visited yet.
+
   mutable size_t obj_malloc_used_ = 0;
   mutable uint32_t size_ = 0;              // number of elements in the set.
   mutable uint32_t num_links_ = 0;         // number of links in the set.
@@ -406,8 +478,7 @@ inline void* DenseSet::FindInternal(const void* obj, uint64_t hashcode, uint32_t
   if (entries_.empty())
     return nullptr;
 
-  uint32_t bid = BucketId(hashcode);
-  DensePtr* ptr = const_cast<DenseSet*>(this)->Find(obj, bid, cookie).second;
+  DensePtr* ptr = const_cast<DenseSet*>(this)->Find(obj, hashcode, cookie).second;
   return ptr ? ptr->GetObject() : nullptr;
 }
 
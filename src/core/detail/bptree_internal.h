@@ -122,6 +122,13 @@ template <typename T> class BPTreeNode {
     num_items_ = 1;
   }
 
+  // Copies count sorted keys into an empty node.
+  void InitKeys(const T* keys, unsigned count) {
+    assert(num_items_ == 0 && count <= MaxItems());
+    memcpy(Layout::KeyPtr(0, this), keys, sizeof(KeyT) * count);
+    num_items_ = count;
+  }
+
   KeyT Key(unsigned index) const {
     KeyT res;
     memcpy(&res, Layout::KeyPtr(index, this), sizeof(KeyT));
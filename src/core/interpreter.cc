@@ -6,12 +6,14 @@
 
 #include <absl/base/casts.h>
 #include <absl/container/fixed_array.h>
+#include <absl/strings/ascii.h>
 #include <absl/strings/str_cat.h>
 #include <absl/time/clock.h>
 #include <mimalloc.h>
 #include <openssl/evp.h>
 #include <xxhash.h>
 
+#include <algorithm>
 #include <cstring>
 #include <optional>
 #include <regex>
@@ -54,6 +56,14 @@ int EVPDigest(const void* data, size_t datalen, unsigned char* md, size_t* mdlen
  * with a single "err" field set to the error string. Note that this
  * table is never a valid reply by proper commands, since the returned
  * tables are otherwise always indexed by integers, never by strings. */
+// Fills the name of the global that holds the script or library function with the given id.
+void GlobalFuncName(string_view sha, bool library, char* dest) {
+  dest[0] = library ? 'l' : 'f';
+  dest[1] = '_';
+  memcpy(dest + 2, sha.data(), 40);
+  dest[42] = '\0';
+}
+
 void PushError(lua_State* lua, string_view error, bool trace = true) {
   lua_Debug dbg;
 
@@ -470,23 +480,221 @@ int RedisLogCommand(lua_State* lua) {
   return 0;
 }
 
-// See https://www.lua.org/manual/5.3/manual.html#lua_Alloc
-void* mimalloc_glue(void* ud, void* ptr, size_t osize, size_t nsize) {
-  (void)ud;
-  if (nsize == 0) {
-    mi_free_size(ptr, osize);
-    return nullptr;
-  } else if (ptr == nullptr) {
-    return mi_malloc(nsize);
+// Appends chunks of lua_dump output to the string passed as ud.
+int StringWriter(lua_State* lua, const void* p, size_t sz, void* ud) {
+  static_cast<string*>(ud)->append(static_cast<const char*>(p), sz);
+  return 0;
+}
+
+// Runs the callback of a library function with KEYS and ARGV as its arguments.
+int CallLibraryFunction(lua_State* lua) {
+  lua_pushvalue(lua, lua_upvalueindex(1));
+  lua_getglobal(lua, "KEYS");
+  lua_getglobal(lua, "ARGV");
+  lua_call(lua, 2, 1);
+  return 1;
+}
+
+// Lua arenas serve allocations of up to kArenaMaxSmall bytes from pages of kArenaPageSize bytes,
+// each page holding objects of a single size class. The pages are small, since every class in use
+// pins at least one page and a thread may hold many interpreters.
+constexpr size_t kArenaPageSize = 1 << 12;
+constexpr size_t kArenaAlign = 16;
+constexpr size_t kArenaMaxSmall = 256;
+constexpr unsigned kArenaNumClasses = kArenaMaxSmall / kArenaAlign;
+
+thread_local size_t tl_lua_committed = 0;
+
+}  // namespace
+
+// Most of the lua objects - strings, tables, closures and upvalues - are small, and heavy scripts
+// create and collect lots of them. The arena serves them from per-size-class free lists of its
+// own pages, so they are not spread across the thread heap and we can account for the memory of
+// every lua state. Larger allocations like table arrays and long strings go to mimalloc directly.
+struct Interpreter::Arena {
+  struct alignas(kArenaAlign) Page {
+    Page* prev = nullptr;  // pages of the same class with free objects.
+    Page* next = nullptr;
+    void* free_list = nullptr;
+    char* bump = nullptr;  // the first object that was never allocated.
+    uint32_t live = 0;
+    uint8_t cls = 0;
+    bool linked = false;
+
+    char* end() {
+      return reinterpret_cast<char*>(this) + kArenaPageSize;
+    }
+  };
+
+  static_assert(sizeof(Page) % kArenaAlign == 0);
+
+  ~Arena();
+
+  // See https://www.lua.org/manual/5.4/manual.html#lua_Alloc
+  static void* Glue(void* ud, void* ptr, size_t osize, size_t nsize);
+
+  void* Allocate(size_t size);
+  void Free(void* ptr, size_t size);
+
+  static unsigned ClassOf(size_t size) {
+    return (size - 1) / kArenaAlign;
+  }
+
+  static Page* PageOf(void* ptr) {
+    return reinterpret_cast<Page*>(reinterpret_cast<uintptr_t>(ptr) & ~(kArenaPageSize - 1));
+  }
+
+  void Link(Page* page);
+  void Unlink(Page* page);
+
+  Page* avail[kArenaNumClasses] = {};
+  size_t used = 0;       // bytes requested by lua.
+  size_t committed = 0;  // bytes of pages and large allocations.
+};
+
+Interpreter::Arena::~Arena() {
+  // lua_close has freed all the objects, so only the last empty page of every class is left.
+  DCHECK_EQ(used, 0u);
+  for (Page* page : avail) {
+    while (page) {
+      Page* next = page->next;
+      DCHECK_EQ(page->live, 0u);
+      mi_free(page);
+      committed -= kArenaPageSize;
+      tl_lua_committed -= kArenaPageSize;
+      page = next;
+    }
+  }
+}
+
+void Interpreter::Arena::Link(Page* page) {
+  Page*& head = avail[page->cls];
+  page->prev = nullptr;
+  page->next = head;
+  if (head)
+    head->prev = page;
+  head = page;
+  page->linked = true;
+}
+
+void Interpreter::Arena::Unlink(Page* page) {
+  if (page->prev)
+    page->prev->next = page->next;
+  else
+    avail[page->cls] = page->next;
+  if (page->next)
+    page->next->prev = page->prev;
+  page->prev = page->next = nullptr;
+  page->linked = false;
+}
+
+void* Interpreter::Arena::Allocate(size_t size) {
+  if (size > kArenaMaxSmall) {
+    void* res = mi_malloc(size);
+    if (res) {
+      used += size;
+      committed += size;
+      tl_lua_committed += size;
+    }
+    return res;
+  }
+
+  unsigned cls = ClassOf(size);
+  size_t obj_size = (cls + 1) * kArenaAlign;
+  Page* page = avail[cls];
+  if (page == nullptr) {
+    void* mem = mi_malloc_aligned(kArenaPageSize, kArenaPageSize);
+    if (mem == nullptr)
+      return nullptr;
+
+    page = new (mem) Page;
+    page->cls = cls;
+    page->bump = reinterpret_cast<char*>(page + 1);
+    committed += kArenaPageSize;
+    tl_lua_committed += kArenaPageSize;
+    Link(page);
+  }
+
+  void* res;
+  if (page->free_list) {
+    res = page->free_list;
+    page->free_list = *static_cast<void**>(res);
   } else {
-    return mi_realloc(ptr, nsize);
+    res = page->bump;
+    page->bump += obj_size;
   }
+  page->live++;
+  used += size;
+
+  if (page->free_list == nullptr && page->bump + obj_size > page->end())
+    Unlink(page);
+
+  return res;
 }
 
-}  // namespace
+void Interpreter::Arena::Free(void* ptr, size_t size) {
+  used -= size;
+  if (size > kArenaMaxSmall) {
+    mi_free_size(ptr, size);
+    committed -= size;
+    tl_lua_committed -= size;
+    return;
+  }
+
+  Page* page = PageOf(ptr);
+  DCHECK_EQ(page->cls, ClassOf(size));
+  *static_cast<void**>(ptr) = page->free_list;
+  page->free_list = ptr;
+  page->live--;
+
+  if (!page->linked) {
+    Link(page);
+  } else if (page->live == 0 && (page->prev || page->next)) {
+    // Keep a single empty page per class to avoid thrashing, release the rest.
+    Unlink(page);
+    mi_free(page);
+    committed -= kArenaPageSize;
+    tl_lua_committed -= kArenaPageSize;
+  }
+}
+
+void* Interpreter::Arena::Glue(void* ud, void* ptr, size_t osize, size_t nsize) {
+  Arena* arena = static_cast<Arena*>(ud);
+
+  // When ptr is null, osize holds the type of the new object rather than a size.
+  if (ptr == nullptr)
+    return nsize ? arena->Allocate(nsize) : nullptr;
+
+  if (nsize == 0) {
+    arena->Free(ptr, osize);
+    return nullptr;
+  }
+
+  if (osize > kArenaMaxSmall && nsize > kArenaMaxSmall) {
+    void* res = mi_realloc(ptr, nsize);
+    if (res) {
+      arena->used += nsize - osize;
+      arena->committed += nsize - osize;
+      tl_lua_committed += nsize - osize;
+    }
+    return res;
+  }
+
+  if (osize <= kArenaMaxSmall && nsize <= kArenaMaxSmall && ClassOf(osize) == ClassOf(nsize)) {
+    arena->used += nsize - osize;
+    return ptr;
+  }
+
+  void* res = arena->Allocate(nsize);
+  if (res) {
+    memcpy(res, ptr, std::min(osize, nsize));
+    arena->Free(ptr, osize);
+  }
+  return res;
+}
 
-Interpreter::Interpreter() {
-  lua_ = lua_newstate(mimalloc_glue, nullptr);
+Interpreter::Interpreter() : arena_(make_unique<Arena>()) {
+  lua_ = lua_newstate(&Arena::Glue, arena_.get());
   InitLua(lua_);
   void** ptr = static_cast<void**>(lua_getextraspace(lua_));
   *ptr = this;
@@ -532,6 +740,11 @@ Interpreter::Interpreter() {
   lua_pushcfunction(lua_, RedisAPCallCommand);
   lua_settable(lua_, -3);
 
+  /* redis.register_function */
+  lua_pushstring(lua_, "register_function");
+  lua_pushcfunction(lua_, RedisRegisterFunction);
+  lua_settable(lua_, -3);
+
   lua_pushstring(lua_, "sha1hex");
   lua_pushcfunction(lua_, RedisSha1Command);
   lua_settable(lua_, -3);
@@ -565,6 +778,17 @@ Interpreter::~Interpreter() {
   lua_close(lua_);
 }
 
+Interpreter::Interpreter(Interpreter&&) = default;
+Interpreter& Interpreter::operator=(Interpreter&&) = default;
+
+size_t Interpreter::MemoryUsage() const {
+  return arena_->used;
+}
+
+size_t Interpreter::UsedThreadLocal() {
+  return tl_lua_committed;
+}
+
 void Interpreter::FuncSha1(string_view body, char* fp) {
   uint8_t digest[EVP_MAX_MD_SIZE];
   EVPDigest(body.data(), body.size(), digest, NULL);
@@ -572,7 +796,12 @@ void Interpreter::FuncSha1(string_view body, char* fp) {
   ToHex(digest, fp);
 }
 
-auto Interpreter::AddFunction(string_view sha, string_view body, string* result) -> AddResult {
+void Interpreter::FunctionSha1(string_view name, char* fp) {
+  FuncSha1(absl::StrCat("function:", name), fp);
+}
+
+auto Interpreter::AddFunction(string_view sha, string_view body, string* result,
+                              string* bytecode) -> AddResult {
   char funcname[43];
   funcname[0] = 'f';
   funcname[1] = '_';
@@ -583,23 +812,65 @@ auto Interpreter::AddFunction(string_view sha, string_view body, string* result)
   int type = lua_getglobal(lua_, funcname);
   lua_pop(lua_, 1);
 
-  if (type == LUA_TNIL && !AddInternal(funcname, body, result))
+  if (type == LUA_TNIL && !AddInternal(funcname, body, result, bytecode))
     return COMPILE_ERR;
 
   return type == LUA_TNIL ? ADD_OK : ALREADY_EXISTS;
 }
 
-bool Interpreter::Exists(string_view sha) const {
+auto Interpreter::AddPrecompiled(string_view sha, string_view bytecode, string* error)
+    -> AddResult {
+  if (Exists(sha))
+    return ALREADY_EXISTS;
+
+  // Only binary chunks are accepted, they were produced by AddFunction() of this process.
+  int res = luaL_loadbufferx(lua_, bytecode.data(), bytecode.size(), "@user_script", "b");
+  if (res == 0) {
+    res = lua_pcall(lua_, 0, 0, 0);  // run func definition code
+  }
+
+  if (res) {
+    error->assign(lua_tostring(lua_, -1));
+    lua_pop(lua_, 1);  // Remove the error.
+    return COMPILE_ERR;
+  }
+
+  DCHECK(Exists(sha));
+  return ADD_OK;
+}
+
+auto Interpreter::AddLibrary(string_view body, vector<FunctionInfo>* functions, string* error)
+    -> AddResult {
+  functions->clear();
+  library_functions_ = functions;
+  int res = luaL_loadbuffer(lua_, body.data(), body.size(), "@user_function");
+  if (res == 0) {
+    res = lua_pcall(lua_, 0, 0, 0);  // run the library code that registers the functions
+  }
+  library_functions_ = nullptr;
+
+  if (res) {
+    error->assign(lua_tostring(lua_, -1));
+    lua_pop(lua_, 1);  // Remove the error.
+    return COMPILE_ERR;
+  }
+
+  if (functions->empty()) {
+    error->assign("No functions registered");
+    return COMPILE_ERR;
+  }
+
+  return ADD_OK;
+}
+
+bool Interpreter::Exists(string_view sha, bool library) const {
   DCHECK(lua_);
 
   if (sha.size() != 40)
     return false;
 
   char fname[43];
-  fname[0] = 'f';
-  fname[1] = '_';
-  fname[42] = '\0';
-  memcpy(fname + 2, sha.data(), 40);
+  GlobalFuncName(sha, library, fname);
 
   int type = lua_getglobal(lua_, fname);
   lua_pop(lua_, 1);
@@ -607,17 +878,14 @@ bool Interpreter::Exists(string_view sha) const {
   return type == LUA_TFUNCTION;
 }
 
-auto Interpreter::RunFunction(string_view sha, std::string* error) -> RunResult {
+auto Interpreter::RunFunction(string_view sha, std::string* error, bool library) -> RunResult {
   DVLOG(2) << "RunFunction " << sha << " " << lua_gettop(lua_);
 
   DCHECK_EQ(40u, sha.size());
 
   lua_getglobal(lua_, "__redis__err__handler");
   char fname[43];
-  fname[0] = 'f';
-  fname[1] = '_';
-  memcpy(fname + 2, sha.data(), 40);
-  fname[42] = '\0';
+  GlobalFuncName(sha, library, fname);
 
   int type = lua_getglobal(lua_, fname);
   if (type != LUA_TFUNCTION) {
@@ -727,11 +995,18 @@ bool Interpreter::IsResultSafe() const {
   return res;
 }
 
-bool Interpreter::AddInternal(const char* f_id, string_view body, string* error) {
+bool Interpreter::AddInternal(const char* f_id, string_view body, string* error,
+                              string* bytecode) {
   string script = absl::StrCat("function ", f_id, "() \n");
   absl::StrAppend(&script, body, "\nend");
 
   int res = luaL_loadbuffer(lua_, script.data(), script.size(), "@user_script");
+  if (res == 0 && bytecode) {
+    // Keep the debug info so that errors report the same lines as with the source.
+    bytecode->clear();
+    lua_dump(lua_, StringWriter, bytecode, 0);
+  }
+
   if (res == 0) {
     res = lua_pcall(lua_, 0, 0, 0);  // run func definition code
   }
@@ -872,6 +1147,11 @@ int Interpreter::RedisGenericCommand(bool raise_error, bool async, ObjectExplore
     return 1;
   }
 
+  if (library_functions_) {
+    PushError(lua_, "redis.call can not be used while loading a function library");
+    return raise_error ? RaiseError(lua_) : 1;
+  }
+
   if (!redis_func_) {
     PushError(lua_, "internal error - redis function not defined");
     return raise_error ? RaiseError(lua_) : 1;
@@ -1013,6 +1293,76 @@ int Interpreter::RedisAPCallCommand(lua_State* lua) {
   return reinterpret_cast<Interpreter*>(*ptr)->RedisGenericCommand(false, true);
 }
 
+int Interpreter::RedisRegisterFunction(lua_State* lua) {
+  void** ptr = static_cast<void**>(lua_getextraspace(lua));
+  const char* error = reinterpret_cast<Interpreter*>(*ptr)->RegisterFunction();
+  return error ? luaL_error(lua, "%s", error) : 0;
+}
+
+const char* Interpreter::RegisterFunction() {
+  if (!library_functions_)
+    return "redis.register_function can only be called on FUNCTION LOAD command";
+
+  FunctionInfo info;
+
+  // Named arguments: redis.register_function{function_name=..., callback=..., flags={...}}
+  if (lua_gettop(lua_) == 1 && lua_istable(lua_, 1)) {
+    lua_getfield(lua_, 1, "flags");
+    if (lua_istable(lua_, -1)) {
+      for (lua_Integer i = 1; lua_rawgeti(lua_, -1, i) != LUA_TNIL; ++i) {
+        if (lua_type(lua_, -1) != LUA_TSTRING)
+          return "unknown flag given";
+        info.flags.emplace_back(lua_tostring(lua_, -1));
+        lua_pop(lua_, 1);
+      }
+      lua_pop(lua_, 1);  // Remove the nil.
+    } else if (!lua_isnil(lua_, -1)) {
+      return "flags argument to redis.register_function must be a table representing function "
+             "flags";
+    }
+    lua_pop(lua_, 1);
+
+    lua_getfield(lua_, 1, "function_name");
+    lua_getfield(lua_, 1, "callback");
+    lua_remove(lua_, 1);
+  }
+
+  if (lua_gettop(lua_) != 2 || lua_type(lua_, 1) != LUA_TSTRING ||
+      lua_type(lua_, 2) != LUA_TFUNCTION) {
+    return "wrong arguments to redis.register_function, expected a name and a callback";
+  }
+
+  size_t len = 0;
+  const char* name = lua_tolstring(lua_, 1, &len);
+  info.name.assign(name, len);
+
+  auto valid_char = [](char c) { return absl::ascii_isalnum(c) || c == '_'; };
+  if (info.name.empty() || !all_of(info.name.begin(), info.name.end(), valid_char))
+    return "Function names can only contain letters, numbers, or underscores(_) and must be at "
+           "least one character long";
+
+  for (const FunctionInfo& other : *library_functions_) {
+    if (other.name == info.name)
+      return "Function already exists in the library";
+  }
+
+  char sha[41];
+  FunctionSha1(info.name, sha);
+  char fname[43];
+  GlobalFuncName({sha, 40}, true, fname);
+
+  // Store the closure directly in the globals table, bypassing the strict mode guard.
+  lua_pushcclosure(lua_, CallLibraryFunction, 1);  // captures the callback
+  lua_pushglobaltable(lua_);
+  lua_pushstring(lua_, fname);
+  lua_pushvalue(lua_, -3);
+  lua_rawset(lua_, -3);
+  lua_pop(lua_, 2);
+
+  library_functions_->push_back(std::move(info));
+  return nullptr;
+}
+
 Interpreter* InterpreterManager::Get() {
   // Grow if none is available and we have unused capacity left.
   if (available_.empty() && storage_.size() < storage_.capacity()) {
@@ -5,8 +5,10 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 #include "core/core_types.h"
 #include "util/fibers/synchronization.h"
@@ -59,8 +61,8 @@ class Interpreter {
   Interpreter(const Interpreter&) = delete;
   void operator=(const Interpreter&) = delete;
 
-  Interpreter(Interpreter&&) = default;
-  Interpreter& operator=(Interpreter&&) = default;
+  Interpreter(Interpreter&&);
+  Interpreter& operator=(Interpreter&&);
 
   // Note: We leak the state for now.
   // Production code should not access this method.
@@ -75,9 +77,29 @@ class Interpreter {
   };
 
   // Add function with sha and body to interpreter.
-  AddResult AddFunction(std::string_view sha, std::string_view body, std::string* error);
+  // If bytecode is set and the function is compiled, it is filled with the precompiled chunk
+  // that can be loaded by other interpreters with AddPrecompiled().
+  AddResult AddFunction(std::string_view sha, std::string_view body, std::string* error,
+                        std::string* bytecode = nullptr);
+
+  // Add function with sha from the bytecode produced by AddFunction(), skipping the compilation.
+  AddResult AddPrecompiled(std::string_view sha, std::string_view bytecode, std::string* error);
+
+  // Function registered by a library with redis.register_function.
+  struct FunctionInfo {
+    std::string name;
+    std::vector<std::string> flags;
+  };
+
+  // Runs the code of a function library, which registers its functions with
+  // redis.register_function. Every function is added under the id from FunctionSha1() and runs
+  // with RunFunction(id, err, true) like a script, receiving KEYS and ARGV as its arguments.
+  // Library functions are kept apart from scripts, so they can not be run as scripts.
+  AddResult AddLibrary(std::string_view body, std::vector<FunctionInfo>* functions,
+                       std::string* error);
 
-  bool Exists(std::string_view sha) const;
+  // `library` selects the functions added by AddLibrary() instead of scripts.
+  bool Exists(std::string_view sha, bool library = false) const;
 
   enum RunResult {
     RUN_OK = 0,
@@ -90,7 +112,7 @@ class Interpreter {
   // Runs already added function sha returned by a successful call to AddFunction().
   // Returns: true if the call succeeded, otherwise fills error and returns false.
   // sha must be 40 char length.
-  RunResult RunFunction(std::string_view sha, std::string* err);
+  RunResult RunFunction(std::string_view sha, std::string* err, bool library = false);
 
   // Checks whether the result is safe to serialize.
   // Should fit 2 conditions:
@@ -106,8 +128,18 @@ class Interpreter {
   // fp[40] will be set to '\0'.
   static void FuncSha1(std::string_view body, char* fp);
 
+  // Id of the library function with the given name, same format as FuncSha1.
+  static void FunctionSha1(std::string_view name, char* fp);
+
   static std::optional<std::string> DetectPossibleAsyncCalls(std::string_view body);
 
+  // Bytes currently allocated by the lua state of this interpreter.
+  size_t MemoryUsage() const;
+
+  // Bytes reserved by the lua allocators of all the interpreters of this thread,
+  // including the unused space of their pages.
+  static size_t UsedThreadLocal();
+
   template <typename U> void SetRedisFunc(U&& u) {
     redis_func_ = std::forward<U>(u);
   }
@@ -118,18 +150,30 @@ class Interpreter {
  private:
   // Returns true if function was successfully added,
   // otherwise returns false and sets the error.
-  bool AddInternal(const char* f_id, std::string_view body, std::string* error);
+  bool AddInternal(const char* f_id, std::string_view body, std::string* error,
+                   std::string* bytecode);
   bool IsTableSafe() const;
 
+  // Returns an error if the arguments of redis.register_function are not valid.
+  const char* RegisterFunction();
+
   static int RedisCallCommand(lua_State* lua);
   static int RedisPCallCommand(lua_State* lua);
   static int RedisACallCommand(lua_State* lua);
   static int RedisAPCallCommand(lua_State* lua);
+  static int RedisRegisterFunction(lua_State* lua);
 
+  // Allocator of the lua state, see lua_newstate.
+  struct Arena;
+
+  std::unique_ptr<Arena> arena_;
   lua_State* lua_;
   unsigned cmd_depth_ = 0;
   RedisFunc redis_func_;
   std::string buffer_;
+
+  // Functions registered by the library that is being loaded by AddLibrary().
+  std::vector<FunctionInfo>* library_functions_ = nullptr;
 };
 
 // Manages an internal interpreter pool. This allows multiple connections residing on the same
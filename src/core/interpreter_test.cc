@@ -225,6 +225,107 @@ TEST_F(InterpreterTest, Add) {
   EXPECT_TRUE(intptr_.Exists(sha1));
 }
 
+TEST_F(InterpreterTest, Precompiled) {
+  const char* script = "return 'hello' .. 42";
+  char sha_buf[64];
+  Interpreter::FuncSha1(script, sha_buf);
+  string_view sha{sha_buf, std::strlen(sha_buf)};
+
+  string err, bytecode;
+  EXPECT_EQ(Interpreter::ADD_OK, intptr_.AddFunction(sha, script, &err, &bytecode));
+  EXPECT_FALSE(bytecode.empty());
+  EXPECT_EQ(0, lua_gettop(lua()));
+
+  Interpreter other;
+  EXPECT_EQ(Interpreter::ADD_OK, other.AddPrecompiled(sha, bytecode, &err));
+  EXPECT_EQ(Interpreter::ALREADY_EXISTS, other.AddPrecompiled(sha, bytecode, &err));
+  EXPECT_EQ(0, lua_gettop(other.lua()));
+
+  ASSERT_EQ(Interpreter::RUN_OK, other.RunFunction(sha, &err));
+  TestSerializer ser;
+  other.SerializeResult(&ser);
+  EXPECT_EQ("str(hello42) ", ser.res);
+
+  // Source code is not a valid precompiled chunk.
+  Interpreter third;
+  EXPECT_EQ(Interpreter::COMPILE_ERR, third.AddPrecompiled(sha, script, &err));
+  EXPECT_FALSE(third.Exists(sha));
+}
+
+TEST_F(InterpreterTest, Memory) {
+  size_t used = intptr_.MemoryUsage();
+  size_t committed = Interpreter::UsedThreadLocal();
+  EXPECT_GT(used, 0u);
+  EXPECT_GE(committed, used);
+
+  RunInline("t = {} for i = 1, 10000 do t[i] = {i, tostring(i)} end", "code");
+  size_t peak = Interpreter::UsedThreadLocal();
+  EXPECT_GT(intptr_.MemoryUsage(), used + 10000 * 64);
+  EXPECT_GE(peak, intptr_.MemoryUsage());
+
+  // The objects are returned to the arena once they are collected.
+  RunInline("t = nil collectgarbage()", "code");
+  EXPECT_LT(intptr_.MemoryUsage(), used + (1 << 16));
+  EXPECT_LT(Interpreter::UsedThreadLocal(), peak);
+
+  // A fresh interpreter commits little more than it uses, and all its memory is released when it
+  // is destroyed.
+  committed = Interpreter::UsedThreadLocal();
+  {
+    Interpreter other;
+    size_t fresh = Interpreter::UsedThreadLocal() - committed;
+    EXPECT_GT(fresh, 0u);
+    EXPECT_LT(fresh, 256 * 1024);
+  }
+  EXPECT_EQ(committed, Interpreter::UsedThreadLocal());
+}
+
+TEST_F(InterpreterTest, Library) {
+  const char* kLib = R"(
+    local function add(keys, args)
+      return tonumber(args[1]) + #keys
+    end
+    redis.register_function('add', add)
+    redis.register_function{function_name='ro', callback=function() return 'ro' end,
+                            flags={'no-writes'}}
+  )";
+
+  vector<Interpreter::FunctionInfo> functions;
+  ASSERT_EQ(Interpreter::ADD_OK, intptr_.AddLibrary(kLib, &functions, &error_)) << error_;
+  ASSERT_EQ(2u, functions.size());
+  EXPECT_EQ("add", functions[0].name);
+  EXPECT_TRUE(functions[0].flags.empty());
+  EXPECT_EQ("ro", functions[1].name);
+  EXPECT_THAT(functions[1].flags, testing::ElementsAre("no-writes"));
+
+  char sha[41];
+  Interpreter::FunctionSha1("add", sha);
+  EXPECT_TRUE(intptr_.Exists(sha, true));
+  EXPECT_FALSE(intptr_.Exists(sha));  // not a script
+  SetGlobalArray("KEYS", {"a", "b"});
+  SetGlobalArray("ARGV", {"40"});
+  EXPECT_EQ(Interpreter::NOT_EXISTS, intptr_.RunFunction(sha, &error_));
+  ASSERT_EQ(Interpreter::RUN_OK, intptr_.RunFunction(sha, &error_, true));
+  intptr_.SerializeResult(&ser_);
+  EXPECT_EQ("i(42) ", ser_.res);
+  intptr_.ResetStack();
+
+  EXPECT_EQ(Interpreter::COMPILE_ERR, intptr_.AddLibrary("return 1", &functions, &error_));
+  EXPECT_EQ("No functions registered", error_);
+
+  const char* kBadName = "redis.register_function('a-b', function() end)";
+  EXPECT_EQ(Interpreter::COMPILE_ERR, intptr_.AddLibrary(kBadName, &functions, &error_));
+  EXPECT_THAT(error_, testing::HasSubstr("Function names can only contain"));
+
+  const char* kCall = "redis.call('GET', 'x')";
+  EXPECT_EQ(Interpreter::COMPILE_ERR, intptr_.AddLibrary(kCall, &functions, &error_));
+  EXPECT_THAT(error_, testing::HasSubstr("can not be used while loading"));
+
+  // Functions can not be registered by scripts.
+  EXPECT_FALSE(Execute("redis.register_function('f', function() end)"));
+  EXPECT_THAT(error_, testing::HasSubstr("can only be called on FUNCTION LOAD"));
+}
+
 // Test cases taken from scripting.tcl
 TEST_F(InterpreterTest, Execute) {
   ASSERT_TRUE(Execute("return 42"));
@@ -4,6 +4,8 @@
 
 #include "core/json/json_object.h"
 
+#include <flatbuffers/flexbuffers.h>
+
 #include "base/logging.h"
 
 using namespace jsoncons;
@@ -30,4 +32,107 @@ optional<JsonType> JsonFromString(string_view input, PMR_NS::memory_resource* mr
   return nullopt;
 }
 
+bool JsonToFlex(const JsonType& src, flexbuffers::Builder* fbb) {
+  switch (src.type()) {
+    case json_type::null_value:
+      fbb->Null();
+      return true;
+    case json_type::bool_value:
+      fbb->Bool(src.as_bool());
+      return true;
+    case json_type::int64_value:
+      fbb->Int(src.as<int64_t>());
+      return true;
+    case json_type::uint64_value:
+      fbb->UInt(src.as<uint64_t>());
+      return true;
+    case json_type::double_value:
+      fbb->Double(src.as_double());
+      return true;
+    case json_type::string_value: {
+      // Big numbers are kept as tagged strings, which flexbuffers can not tell from strings.
+      if (src.tag() != semantic_tag::none)
+        return false;
+      auto str = src.as_string_view();
+      fbb->String(str.data(), str.size());
+      return true;
+    }
+    case json_type::array_value: {
+      size_t start = fbb->StartVector();
+      for (const auto& item : src.array_range()) {
+        if (!JsonToFlex(item, fbb))
+          return false;
+      }
+      fbb->EndVector(start, false, false);
+      return true;
+    }
+    case json_type::object_value: {
+      size_t start = fbb->StartMap();
+      for (const auto& member : src.object_range()) {
+        // Keys of flexbuffer maps are null terminated and compared as C strings.
+        string_view key = member.key();
+        if (key.find('\0') != string_view::npos)
+          return false;
+        fbb->Key(key.data(), key.size());
+        if (!JsonToFlex(member.value(), fbb))
+          return false;
+      }
+      fbb->EndMap(start);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+JsonType JsonFromFlex(const flexbuffers::Reference& src, PMR_NS::memory_resource* mr) {
+  std::pmr::polymorphic_allocator<char> alloc{mr};
+
+  switch (src.GetType()) {
+    case flexbuffers::FBT_BOOL:
+      return JsonType(src.AsBool());
+    case flexbuffers::FBT_INT:
+    case flexbuffers::FBT_INDIRECT_INT:
+      return JsonType(src.AsInt64());
+    case flexbuffers::FBT_UINT:
+    case flexbuffers::FBT_INDIRECT_UINT:
+      return JsonType(src.AsUInt64());
+    case flexbuffers::FBT_FLOAT:
+    case flexbuffers::FBT_INDIRECT_FLOAT:
+      return JsonType(src.AsDouble());
+    case flexbuffers::FBT_STRING: {
+      auto str = src.AsString();
+      return JsonType(str.c_str(), str.length(), semantic_tag::none, alloc);
+    }
+    case flexbuffers::FBT_MAP: {
+      auto map = src.AsMap();
+      auto keys = map.Keys();
+      auto values = map.Values();
+      JsonType res(json_object_arg, semantic_tag::none, alloc);
+      res.reserve(map.size());
+      for (size_t i = 0; i < map.size(); ++i) {
+        res.try_emplace(string_view{keys[i].AsKey()}, JsonFromFlex(values[i], mr));
+      }
+      return res;
+    }
+    case flexbuffers::FBT_VECTOR: {
+      auto vec = src.AsVector();
+      JsonType res(json_array_arg, semantic_tag::none, alloc);
+      res.reserve(vec.size());
+      for (size_t i = 0; i < vec.size(); ++i) {
+        res.push_back(JsonFromFlex(vec[i], mr));
+      }
+      return res;
+    }
+    default:
+      DCHECK(src.IsNull()) << "Unexpected flexbuffer type " << src.GetType();
+      return JsonType::null();
+  }
+}
+
+JsonType JsonFromFlat(string_view flat, PMR_NS::memory_resource* mr) {
+  auto* buf = reinterpret_cast<const uint8_t*>(flat.data());
+  return JsonFromFlex(flexbuffers::GetRoot(buf, flat.size()), mr);
+}
+
 }  // namespace dfly
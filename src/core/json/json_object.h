@@ -12,6 +12,11 @@
 
 #include "base/pmr/memory_resource.h"
 
+namespace flexbuffers {
+class Builder;
+class Reference;
+}  // namespace flexbuffers
+
 namespace dfly {
 
 // This is temporary, there is an issue right now with jsoncons about using jsonpath
@@ -22,6 +27,16 @@ using JsonType = jsoncons::pmr::json;
 // Build a json object from string. If the string is not legal json, will return nullopt
 std::optional<JsonType> JsonFromString(std::string_view input, PMR_NS::memory_resource* mr);
 
+// Encodes a json object into a flexbuffer, the flat json encoding. Returns false if the object
+// can not be represented in it, for example if it has keys with null characters or big numbers.
+bool JsonToFlex(const JsonType& src, flexbuffers::Builder* fbb);
+
+// Decodes a json object from a value of a flexbuffer that was built with JsonToFlex.
+JsonType JsonFromFlex(const flexbuffers::Reference& src, PMR_NS::memory_resource* mr);
+
+// Same as above for the root of a flexbuffer.
+JsonType JsonFromFlat(std::string_view flat, PMR_NS::memory_resource* mr);
+
 inline auto MakeJsonPathExpr(std::string_view path, std::error_code& ec)
     -> jsoncons::jsonpath::jsonpath_expression<JsonType> {
   return jsoncons::jsonpath::make_expression<JsonType, std::allocator<char>>(
@@ -2,12 +2,15 @@
 // See LICENSE for licensing terms.
 //
 
+#include <flatbuffers/flexbuffers.h>
+
 #include <jsoncons/json.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath.hpp>
 #include <memory_resource>
 
 #include "base/gtest.h"
 #include "base/logging.h"
+#include "core/json/json_object.h"
 
 namespace dfly {
 using namespace jsoncons;
@@ -171,4 +174,33 @@ TEST_F(JsonTest, JsonWithPolymorhicAllocator) {
   EXPECT_EQ("Im Westen nichts Neues", j1["store"]["book"][1]["title"].as_string());
   EXPECT_EQ(10.00, j1["store"]["book"][1]["price"].as_double());
 }
+
+TEST_F(JsonTest, Flat) {
+  auto* mr = std::pmr::get_default_resource();
+  std::string data =
+      R"({"a":1,"b":-2,"c":18446744073709551615,"d":1.5,"e":"str","f":null,"g":true,)"
+      R"("h":[1,"x",[],{}],"nested":{"z":[{"y":false}]}})";
+  auto src = JsonFromString(data, mr);
+  ASSERT_TRUE(src);
+
+  flexbuffers::Builder fbb;
+  ASSERT_TRUE(JsonToFlex(*src, &fbb));
+  fbb.Finish();
+  const auto& buf = fbb.GetBuffer();
+  std::string_view flat{reinterpret_cast<const char*>(buf.data()), buf.size()};
+
+  JsonType res = JsonFromFlat(flat, mr);
+  EXPECT_EQ(*src, res);
+  EXPECT_EQ(src->to_string(), res.to_string());
+
+  auto root = flexbuffers::GetRoot(buf);
+  EXPECT_EQ("str", root.AsMap()["e"].AsString().str());
+  EXPECT_EQ(R"([{"y":false}])", JsonFromFlex(root.AsMap()["nested"].AsMap()["z"], mr).to_string());
+
+  // Keys of flexbuffers can not hold null characters.
+  src = JsonFromString(R"({"a\u0000b":1})", mr);
+  ASSERT_TRUE(src);
+  flexbuffers::Builder fbb2;
+  EXPECT_FALSE(JsonToFlex(*src, &fbb2));
+}
 }  // namespace dfly
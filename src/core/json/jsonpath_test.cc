@@ -8,6 +8,7 @@
 #include "base/logging.h"
 #include "core/json/driver.h"
 #include "core/json/lexer_impl.h"
+#include "core/json/path.h"
 
 namespace dfly::json {
 
@@ -286,6 +287,45 @@ TEST_F(JsonPathTest, Wildcard) {
   ASSERT_THAT(arr, ElementsAre(1, 2, 3));
 }
 
+TEST_F(JsonPathTest, SimplePath) {
+  JsonType json = ValidJson(R"({"a": {"b": [1, {"c": 2}], "d": 3}})");
+
+  ASSERT_EQ(0, Parse("$.a.b[1].c"));
+  Path path = driver_.TakePath();
+  ASSERT_TRUE(IsSimplePath(path));
+
+  vector<int> arr;
+  EvaluatePath(path, json, [&](optional<string_view> key, const JsonType& val) {
+    EXPECT_EQ("c", key);
+    arr.push_back(val.as<int>());
+  });
+  ASSERT_THAT(arr, ElementsAre(2));
+
+  ASSERT_EQ(0, Parse("$.a.b[0]"));
+  path = driver_.TakePath();
+  arr.clear();
+  EvaluatePath(path, json, [&](optional<string_view> key, const JsonType& val) {
+    EXPECT_FALSE(key);
+    arr.push_back(val.as<int>());
+  });
+  ASSERT_THAT(arr, ElementsAre(1));
+
+  // Mismatching types, missing keys and out of range indices match nothing.
+  for (string_view expr : {"$.a.d.c", "$.a.e", "$.a.b[2]", "$.a[0]", "$.a.b[0].c"}) {
+    ASSERT_EQ(0, Parse(string(expr)));
+    path = driver_.TakePath();
+    ASSERT_TRUE(IsSimplePath(path));
+    EvaluatePath(path, json, [&](optional<string_view>, const JsonType&) {
+      ADD_FAILURE() << "Unexpected match for " << expr;
+    });
+  }
+
+  ASSERT_EQ(0, Parse("$.a.b[*]"));
+  EXPECT_FALSE(IsSimplePath(driver_.TakePath()));
+  ASSERT_EQ(0, Parse("$..c"));
+  EXPECT_FALSE(IsSimplePath(driver_.TakePath()));
+}
+
 TEST_F(JsonPathTest, Mutate) {
   JsonType json = ValidJson(R"([1, 2, 3, 5, 6])");
   ASSERT_EQ(0, Parse("$[*]"));
@@ -326,4 +366,58 @@ TEST_F(JsonPathTest, Mutate) {
   ASSERT_EQ(R"({"a":[42],"inner":{"a":{"bool":false}}})", json.to_string());
 }
 
+// Parsing and evaluation are measured separately, since commands can reuse parsed paths.
+// The argument chooses a simple path, a wildcard path or a descent path.
+const char* kBenchPaths[] = {"$.a.b[1].c", "$.a.b[*].c", "$..c"};
+
+const char kBenchJson[] = R"({"a": {"b": [{"c": 1}, {"c": 2}, {"c": 3}], "d": {"c": 4}}})";
+
+static void BM_ParsePath(benchmark::State& state) {
+  string_view path = kBenchPaths[state.range(0)];
+  while (state.KeepRunning()) {
+    auto res = ParsePath(path);
+    CHECK(res);
+    benchmark::DoNotOptimize(res);
+  }
+}
+BENCHMARK(BM_ParsePath)->DenseRange(0, 2);
+
+static void BM_ParseJsonconsPath(benchmark::State& state) {
+  string_view path = kBenchPaths[state.range(0)];
+  while (state.KeepRunning()) {
+    error_code ec;
+    auto expr = MakeJsonPathExpr(path, ec);
+    CHECK(!ec);
+    benchmark::DoNotOptimize(expr);
+  }
+}
+BENCHMARK(BM_ParseJsonconsPath)->DenseRange(0, 2);
+
+static void BM_EvaluatePath(benchmark::State& state) {
+  JsonType json = ValidJson(kBenchJson);
+  auto path = ParsePath(kBenchPaths[state.range(0)]);
+  CHECK(path);
+
+  unsigned matches = 0;
+  while (state.KeepRunning()) {
+    EvaluatePath(*path, json, [&](optional<string_view>, const JsonType&) { ++matches; });
+  }
+  benchmark::DoNotOptimize(matches);
+}
+BENCHMARK(BM_EvaluatePath)->DenseRange(0, 2);
+
+static void BM_EvaluateJsonconsPath(benchmark::State& state) {
+  JsonType json = ValidJson(kBenchJson);
+  error_code ec;
+  auto expr = MakeJsonPathExpr(kBenchPaths[state.range(0)], ec);
+  CHECK(!ec);
+
+  unsigned matches = 0;
+  while (state.KeepRunning()) {
+    expr.evaluate(json, [&](const string_view&, const JsonType&) { ++matches; });
+  }
+  benchmark::DoNotOptimize(matches);
+}
+BENCHMARK(BM_EvaluateJsonconsPath)->DenseRange(0, 2);
+
 }  // namespace dfly::json
@@ -7,6 +7,8 @@
 #include <absl/strings/str_cat.h>
 #include <absl/types/span.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "core/json/jsonpath_grammar.hh"
 #include "src/core/json/driver.h"
@@ -224,6 +226,29 @@ template <bool IsConst> auto DfsItem<IsConst>::Init(const PathSegment& segment)
   return make_unexpected(MISMATCH);
 }
 
+// Follows a simple path without the DFS stack, see IsSimplePath().
+void EvaluateSimplePath(const Path& path, const JsonType& json, const PathCallback& callback) {
+  const JsonType* node = &json;
+  optional<string_view> key;
+  for (const PathSegment& segment : path) {
+    if (segment.type() == SegmentType::IDENTIFIER) {
+      if (!node->is_object())
+        return;
+      auto it = node->find(segment.identifier());
+      if (it == node->object_range().end())
+        return;
+      key = it->key();
+      node = &it->value();
+    } else {
+      if (!node->is_array() || segment.index() >= node->size())
+        return;
+      key = nullopt;
+      node = &node->at(segment.index());
+    }
+  }
+  callback(key, *node);
+}
+
 inline bool IsRecursive(jsoncons::json_type type) {
   return type == jsoncons::json_type::object_value || type == jsoncons::json_type::array_value;
 }
@@ -431,12 +456,23 @@ JsonType PathSegment::GetResult() const {
   return func->GetResult();
 }
 
+bool IsSimplePath(const Path& path) {
+  return all_of(path.begin(), path.end(), [](const PathSegment& segment) {
+    return segment.type() == SegmentType::IDENTIFIER || segment.type() == SegmentType::INDEX;
+  });
+}
+
 void EvaluatePath(const Path& path, const JsonType& json, PathCallback callback) {
   if (path.empty()) {  // root node
     callback(nullopt, json);
     return;
   }
 
+  if (IsSimplePath(path)) {
+    EvaluateSimplePath(path, json, callback);
+    return;
+  }
+
   if (path.front().type() != SegmentType::FUNCTION) {
     Dfs().Traverse(path, json, std::move(callback));
     return;
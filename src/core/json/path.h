@@ -94,6 +94,10 @@ using PathCallback = absl::FunctionRef<void(std::optional<std::string_view>, con
 // Returns true if the entry should be deleted, false otherwise.
 using MutateCallback = absl::FunctionRef<bool(std::optional<std::string_view>, JsonType*)>;
 
+// Returns true if the path consists of object keys and array indices only. Such paths match
+// at most one value and are evaluated without allocations.
+bool IsSimplePath(const Path& path);
+
 void EvaluatePath(const Path& path, const JsonType& json, PathCallback callback);
 void MutatePath(const Path& path, MutateCallback callback, JsonType* json);
 nonstd::expected<Path, std::string> ParsePath(std::string_view path);
@@ -4,6 +4,9 @@
 
 #include "core/sorted_map.h"
 
+#include <absl/strings/numbers.h>
+
+#include <algorithm>
 #include <cmath>
 
 extern "C" {
@@ -306,6 +309,27 @@ bool SortedMap::DfImpl::Insert(double score, sds ele) {
   return true;
 }
 
+bool SortedMap::DfImpl::BulkAdd(double score, string_view member) {
+  DCHECK_EQ(0u, score_tree->Size());
+  DCHECK(!isnan(score));  // Would break the ordering FinishBulkLoad sorts by.
+
+  return score_map->AddOrUpdate(member, score).second;
+}
+
+void SortedMap::DfImpl::FinishBulkLoad() {
+  DCHECK_EQ(0u, score_tree->Size());
+
+  vector<ScoreSds> items;
+  items.reserve(score_map->UpperBoundSize());
+  for (auto it = score_map->begin(); it != score_map->end(); ++it) {
+    items.push_back(it->first);
+  }
+
+  ScoreSdsPolicy::KeyCompareTo cmp;
+  sort(items.begin(), items.end(), [&cmp](ScoreSds a, ScoreSds b) { return cmp(a, b) < 0; });
+  score_tree->FromSorted(items.data(), items.size());
+}
+
 optional<unsigned> SortedMap::DfImpl::GetRank(sds ele, bool reverse) const {
   ScoreSds obj = score_map->FindObj(ele);
   if (obj == nullptr)
@@ -740,7 +764,6 @@ SortedMap* SortedMap::FromListPack(PMR_NS::memory_resource* res, const uint8_t*
   unsigned char* vstr;
   unsigned int vlen;
   long long vlong;
-  sds ele;
 
   void* ptr = res->allocate(sizeof(SortedMap), alignof(SortedMap));
   SortedMap* zs = new (ptr) SortedMap{res};
@@ -754,14 +777,16 @@ SortedMap* SortedMap::FromListPack(PMR_NS::memory_resource* res, const uint8_t*
   while (eptr != NULL) {
     double score = zzlGetScore(sptr);
     vstr = lpGetValue(eptr, &vlen, &vlong);
-    if (vstr == NULL)
-      ele = sdsfromlonglong(vlong);
-    else
-      ele = sdsnewlen((char*)vstr, vlen);
-
-    CHECK(zs->Insert(score, ele));
+    if (vstr == NULL) {
+      char buf[32];
+      char* next = absl::numbers_internal::FastIntToBuffer(vlong, buf);
+      CHECK(zs->BulkAdd(score, string_view{buf, size_t(next - buf)}));
+    } else {
+      CHECK(zs->BulkAdd(score, string_view{(char*)vstr, vlen}));
+    }
     zzlNext(zl, &eptr, &sptr);
   }
+  zs->FinishBulkLoad();
 
   return zs;
 }
@@ -71,6 +71,20 @@ class SortedMap {
     return std::visit(Overload{[&](auto& impl) { return impl.Insert(score, member); }}, impl_);
   }
 
+  // Bulk-loading of an empty map: BulkAdd() only indexes the member by name, and
+  // FinishBulkLoad() then builds the score tree bottom-up from all the indexed members.
+  // This is cheaper than Insert() per member and packs the tree nodes fully.
+  // The map may not be accessed otherwise until FinishBulkLoad() is called.
+  // BulkAdd returns false if the member already exists, in which case its score is replaced.
+  // The score must not be NaN.
+  bool BulkAdd(double score, std::string_view member) {
+    return std::visit(Overload{[&](auto& impl) { return impl.BulkAdd(score, member); }}, impl_);
+  }
+
+  void FinishBulkLoad() {
+    std::visit(Overload{[](auto& impl) { impl.FinishBulkLoad(); }}, impl_);
+  }
+
   uint8_t* ToListPack() const {
     return std::visit(Overload{[](const auto& impl) { return impl.ToListPack(); }}, impl_);
   }
@@ -137,6 +151,11 @@ class SortedMap {
     return std::visit(Overload{[&](const auto& impl) { return impl.LexCount(range); }}, impl_);
   }
 
+  // The set that indexes the members by name.
+  DenseSet* members() {
+    return std::get<DfImpl>(impl_).score_map;
+  }
+
   // Runs cb for each element in the range [start_rank, start_rank + len).
   // Stops iteration if cb returns false. Returns false in this case.
   bool Iterate(unsigned start_rank, unsigned len, bool reverse,
@@ -171,6 +190,9 @@ class SortedMap {
 
     bool Delete(sds ele);
 
+    bool BulkAdd(double score, std::string_view member);
+    void FinishBulkLoad();
+
     size_t Size() const {
       return score_map->UpperBoundSize();
     }
@@ -4,6 +4,7 @@
 
 #include "core/sorted_map.h"
 
+#include <absl/strings/str_cat.h>
 #include <gmock/gmock.h>
 #include <mimalloc.h>
 
@@ -76,6 +77,33 @@ TEST_F(SortedMapTest, Scan) {
   EXPECT_EQ(972, cnt);
 }
 
+TEST_F(SortedMapTest, BulkLoad) {
+  for (unsigned i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(sm_.BulkAdd(i % 10, absl::StrCat("a", i)));
+  }
+  EXPECT_FALSE(sm_.BulkAdd(2000, "a5"));
+  sm_.FinishBulkLoad();
+  EXPECT_EQ(1000, sm_.Size());
+
+  vector<string> vec;
+  sm_.Iterate(0, 3, false, [&](sds ele, double score) {
+    vec.emplace_back(ele, sdslen(ele));
+    return true;
+  });
+  EXPECT_THAT(vec, ElementsAre("a0", "a10", "a100"));
+
+  sds s = sdsnew("a5");
+  EXPECT_EQ(2000, sm_.GetScore(s));
+  EXPECT_EQ(0, sm_.GetRank(s, true));
+  EXPECT_TRUE(sm_.Delete(s));
+  sdsfree(s);
+
+  EXPECT_TRUE(sm_.Insert(-1, sdsnew("b")));
+  s = sdsnew("b");
+  EXPECT_EQ(0, sm_.GetRank(s, false));
+  sdsfree(s);
+}
+
 TEST_F(SortedMapTest, InsertPop) {
   for (unsigned i = 0; i < 256; ++i) {
     sds s = sdsempty();
@@ -4,6 +4,7 @@
 
 #include "core/string_set.h"
 
+#include <absl/container/flat_hash_set.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
 #include <gtest/gtest.h>
@@ -448,6 +449,101 @@ TEST_F(StringSetTest, Reserve) {
   }
 }
 
+TEST_F(StringSetTest, IncrementalGrow) {
+  constexpr size_t kNum = 10000;
+  size_t rehashing = 0;
+  for (size_t i = 0; i < kNum; ++i) {
+    ASSERT_TRUE(ss_->Add(StrCat("member", i)));
+    rehashing += ss_->IsRehashing();
+  }
+  EXPECT_GT(rehashing, 0u);
+
+  // Growth is completed by the lookups of the members and by RehashStepAll.
+  for (size_t i = 0; i < kNum; i += 2) {
+    ASSERT_TRUE(ss_->Contains(StrCat("member", i)));
+    ASSERT_FALSE(ss_->Contains(StrCat("absent", i)));
+  }
+  for (size_t i = 1; i < kNum; i += 4) {
+    ASSERT_TRUE(ss_->Erase(StrCat("member", i)));
+  }
+  while (ss_->IsRehashing()) {
+    ASSERT_GT(DenseSet::RehashStepAll(16), 0u);
+  }
+  EXPECT_EQ(0u, DenseSet::RehashStepAll(16));
+
+  size_t count = 0;
+  for (sds s : *ss_) {
+    ASSERT_TRUE(absl::StartsWith(string_view{s, sdslen(s)}, "member"));
+    ++count;
+  }
+  EXPECT_EQ(kNum - kNum / 4, count);
+}
+
+TEST_F(StringSetTest, ScanAndPopWhileGrowing) {
+  size_t num = 0;
+  do {
+    ASSERT_TRUE(ss_->Add(StrCat("member", num++)));
+  } while (num < 1000 || !ss_->IsRehashing());
+
+  // Scans move the buckets they visit only.
+  absl::flat_hash_set<string> scanned;
+  uint32_t cursor = ss_->Scan(0, [&](const sds ptr) { scanned.emplace(ptr, sdslen(ptr)); });
+  EXPECT_TRUE(ss_->IsRehashing());
+  while (cursor != 0) {
+    cursor = ss_->Scan(cursor, [&](const sds ptr) { scanned.emplace(ptr, sdslen(ptr)); });
+  }
+  EXPECT_EQ(num, scanned.size());
+
+  while (ss_->IsRehashing())
+    DenseSet::RehashStepAll(16);
+
+  ASSERT_TRUE(ss_->Add("extra"));
+  while (!ss_->IsRehashing())
+    ASSERT_TRUE(ss_->Add(StrCat("member", num++)));
+
+  size_t popped = 0;
+  while (ss_->Pop())
+    ++popped;
+  EXPECT_EQ(num + 1, popped);
+  EXPECT_EQ(0u, ss_->UpperBoundSize());
+}
+
+// Counts the member comparisons done by lookups.
+class CountingStringSet : public StringSet {
+ public:
+  using StringSet::StringSet;
+
+  mutable unsigned num_equal = 0;
+
+ protected:
+  bool ObjEqual(const void* left, const void* right, uint32_t right_cookie) const override {
+    ++num_equal;
+    return StringSet::ObjEqual(left, right, right_cookie);
+  }
+};
+
+TEST_F(StringSetTest, Fingerprints) {
+  CountingStringSet ss(&alloc_);
+  for (size_t i = 0; i < 10000; ++i) {
+    ss.Add(StrCat("member", i));
+  }
+
+  ss.num_equal = 0;
+  for (size_t i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(ss.Contains(StrCat("member", i)));
+  }
+  // Only the matching member is compared in most cases.
+  EXPECT_LT(ss.num_equal, 10500u);
+
+  ss.num_equal = 0;
+  for (size_t i = 0; i < 10000; ++i) {
+    ASSERT_FALSE(ss.Contains(StrCat("absent", i)));
+  }
+  EXPECT_LT(ss.num_equal, 1000u);
+
+  ss.Clear();
+}
+
 TEST_F(StringSetTest, IterateEmpty) {
   for (const auto& s : *ss_) {
     // We're iterating to make sure there is no crash. However, if we got here, it's a bug
@@ -75,6 +75,8 @@ typedef struct streamCG {
     rax *consumers;         /* A radix tree representing the consumers by name
                                and their associated representation in the form
                                of streamConsumer structures. */
+    struct streamNACK *idle_head; /* The PEL entries are also linked in the order */
+    struct streamNACK *idle_tail; /* of their delivery time, from the oldest one. */
 } streamCG;
 
 /* A specific consumer in a consumer group.  */
@@ -98,6 +100,9 @@ typedef struct streamNACK {
     uint64_t delivery_count;    /* Number of times this message was delivered.*/
     streamConsumer *consumer;   /* The consumer this message was delivered to
                                    in the last delivery. */
+    streamID id;                /* The ID of the message. */
+    struct streamNACK *idle_prev, *idle_next; /* Links in the delivery time list
+                                                 of the group. */
 } streamNACK;
 
 
@@ -158,6 +163,9 @@ void streamDecodeID(void *buf, streamID *id);
 int streamCompareID(streamID *a, streamID *b);
 int streamEntryExists(stream *s, streamID *id);
 void streamFreeNACK(streamNACK *na);
+void streamLinkNACK(streamCG *cg, streamNACK *nack);
+void streamUnlinkNACK(streamCG *cg, streamNACK *nack);
+void streamSetDeliveryTime(streamCG *cg, streamNACK *nack, mstime_t delivery_time);
 int streamIncrID(streamID *id);
 int streamDecrID(streamID *id);
 
@@ -1039,6 +1039,8 @@ streamNACK *streamCreateNACK(streamConsumer *consumer) {
     nack->delivery_time = mstime();
     nack->delivery_count = 1;
     nack->consumer = consumer;
+    nack->id.ms = nack->id.seq = 0;
+    nack->idle_prev = nack->idle_next = NULL;
     return nack;
 }
 
@@ -1047,6 +1049,50 @@ void streamFreeNACK(streamNACK *na) {
     zfree(na);
 }
 
+/* Link a NACK into the delivery time list of the group. Messages are
+ * usually delivered at the current time, close to the tail, while XCLAIM
+ * with IDLE or TIME back-dates them, usually close to the head. So the
+ * position is searched from both ends at once, in steps proportional to
+ * its distance from the nearer end. */
+void streamLinkNACK(streamCG *cg, streamNACK *nack) {
+    streamNACK *prev = cg->idle_tail, *next = cg->idle_head;
+    while (1) {
+        /* The last NACK delivered not later than this one. */
+        if (!prev || prev->delivery_time <= nack->delivery_time) break;
+        /* The first NACK delivered later than this one. */
+        if (next->delivery_time > nack->delivery_time) {
+            prev = next->idle_prev;
+            break;
+        }
+        prev = prev->idle_prev;
+        next = next->idle_next;
+    }
+
+    nack->idle_prev = prev;
+    nack->idle_next = prev ? prev->idle_next : cg->idle_head;
+    if (nack->idle_next) nack->idle_next->idle_prev = nack;
+    else cg->idle_tail = nack;
+    if (prev) prev->idle_next = nack;
+    else cg->idle_head = nack;
+}
+
+/* Unlink a NACK from the delivery time list of the group. Must be called
+ * before the NACK is removed from the group PEL. */
+void streamUnlinkNACK(streamCG *cg, streamNACK *nack) {
+    if (nack->idle_prev) nack->idle_prev->idle_next = nack->idle_next;
+    else cg->idle_head = nack->idle_next;
+    if (nack->idle_next) nack->idle_next->idle_prev = nack->idle_prev;
+    else cg->idle_tail = nack->idle_prev;
+    nack->idle_prev = nack->idle_next = NULL;
+}
+
+/* Set the delivery time of a NACK, keeping the delivery time list ordered. */
+void streamSetDeliveryTime(streamCG *cg, streamNACK *nack, mstime_t delivery_time) {
+    streamUnlinkNACK(cg, nack);
+    nack->delivery_time = delivery_time;
+    streamLinkNACK(cg, nack);
+}
+
 /* Free a consumer and associated data structures. Note that this function
  * will not reassign the pending messages associated with this consumer
  * nor will delete them from the stream, so when this function is called
@@ -1073,6 +1119,7 @@ streamCG *streamCreateCG(stream *s, const char *name, size_t namelen, streamID *
     cg->consumers = raxNew();
     cg->last_id = *id;
     cg->entries_read = entries_read;
+    cg->idle_head = cg->idle_tail = NULL;
     raxInsert(s->cgroups,(unsigned char*)name,namelen,cg,NULL);
     return cg;
 }
@@ -1135,6 +1182,7 @@ void streamDelConsumer(streamCG *cg, streamConsumer *consumer) {
     while(raxNext(&ri)) {
         streamNACK *nack = ri.data;
         raxRemove(cg->pel,ri.key,ri.key_len,NULL);
+        streamUnlinkNACK(cg,nack);
         streamFreeNACK(nack);
     }
     raxStop(&ri);
@@ -4,6 +4,7 @@
 
 #include "server/cluster/cluster_family.h"
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -23,8 +24,12 @@
 #include "server/main_service.h"
 #include "server/server_family.h"
 #include "server/server_state.h"
+#include "strings/human_readable.h"
 
 ABSL_FLAG(std::string, cluster_announce_ip, "", "ip that cluster commands announce to the client");
+ABSL_FLAG(uint32_t, cluster_migration_streams, 1,
+          "Number of concurrent streams, each over its own connection, that every shard uses to "
+          "send the slots of an outgoing migration.");
 
 ABSL_DECLARE_FLAG(int32_t, port);
 
@@ -639,6 +644,29 @@ static std::string_view state_to_str(MigrationState state) {
   return "UNDEFINED_STATE"sv;
 }
 
+// Appends the progress of an outgoing migration in full sync to its state, e.g.
+// "FULL_SYNC keys=1000/5000 rate=10.00MiB/s eta=4s"
+static std::string outgoing_state_to_str(const OutgoingMigration& migration) {
+  MigrationState state = migration.GetState();
+  std::string res{state_to_str(state)};
+  if (state != MigrationState::C_FULL_SYNC)
+    return res;
+
+  auto progress = migration.GetProgress();
+  double elapsed_sec = std::max<uint64_t>(progress.elapsed_usec, 1) / 1e6;
+  double keys_rate = progress.keys_sent / elapsed_sec;
+  int64_t bytes_rate = progress.bytes_sent / elapsed_sec;
+  absl::StrAppend(&res, " keys=", progress.keys_sent, "/", progress.keys_total,
+                  " rate=", strings::HumanReadableNumBytes(bytes_rate), "/s eta=");
+  if (progress.keys_sent >= progress.keys_total)
+    absl::StrAppend(&res, "0s");
+  else if (keys_rate > 0)
+    absl::StrAppend(&res, uint64_t((progress.keys_total - progress.keys_sent) / keys_rate), "s");
+  else
+    absl::StrAppend(&res, "unknown");
+  return res;
+}
+
 void ClusterFamily::DflyClusterSlotMigrationStatus(CmdArgList args, ConnectionContext* cntx) {
   CmdArgParser parser(args);
   auto* rb = static_cast<RedisReplyBuilder*>(cntx->reply_builder());
@@ -658,23 +686,23 @@ void ClusterFamily::DflyClusterSlotMigrationStatus(CmdArgList args, ConnectionCo
     // find outgoing slot migration
     for (const auto& [_, info] : outgoing_migration_jobs_) {
       if (info->GetHostIp() == host_ip && info->GetPort() == port)
-        return rb->SendSimpleString(state_to_str(info->GetState()));
+        return rb->SendSimpleString(outgoing_state_to_str(*info));
     }
   } else if (auto arr_size = incoming_migrations_jobs_.size() + outgoing_migration_jobs_.size();
              arr_size != 0) {
     rb->StartArray(arr_size);
     const auto& send_answer = [rb](std::string_view direction, std::string_view host, uint16_t port,
-                                   auto state) {
-      auto str = absl::StrCat(direction, " ", host, ":", port, " ", state_to_str(state));
+                                   std::string_view state) {
+      auto str = absl::StrCat(direction, " ", host, ":", port, " ", state);
       rb->SendSimpleString(str);
     };
     lock_guard lk(migration_mu_);
     for (const auto& m : incoming_migrations_jobs_) {
       const auto& info = m->GetInfo();
-      send_answer("in", info.host, info.port, m->GetState());
+      send_answer("in", info.host, info.port, state_to_str(m->GetState()));
     }
     for (const auto& [_, info] : outgoing_migration_jobs_) {
-      send_answer("out", info->GetHostIp(), info->GetPort(), info->GetState());
+      send_answer("out", info->GetHostIp(), info->GetPort(), outgoing_state_to_str(*info));
     }
     return;
   }
@@ -793,18 +821,27 @@ void ClusterFamily::MigrationConf(CmdArgList args, ConnectionContext* cntx) {
     }
   }
 
-  auto sync_id = CreateOutgoingMigration(cntx, port, std::move(slots));
+  size_t slots_num = 0;
+  for (const auto& range : slots)
+    slots_num += range.end - range.start + 1;
+  uint32_t streams_num = std::clamp<size_t>(absl::GetFlag(FLAGS_cluster_migration_streams), 1,
+                                            std::max<size_t>(slots_num, 1));
+
+  auto sync_id = CreateOutgoingMigration(cntx, port, streams_num, std::move(slots));
 
   cntx->conn()->SetName("slot_migration_ctrl");
   auto* rb = static_cast<RedisReplyBuilder*>(cntx->reply_builder());
-  rb->StartArray(2);
+  // The number of streams per shard is sent only if the target needs to open several of them.
+  rb->StartArray(streams_num > 1 ? 3 : 2);
   rb->SendLong(sync_id);
   rb->SendLong(shard_set->size());
+  if (streams_num > 1)
+    rb->SendLong(streams_num);
   return;
 }
 
 uint32_t ClusterFamily::CreateOutgoingMigration(ConnectionContext* cntx, uint16_t port,
-                                                SlotRanges slots) {
+                                                uint32_t streams_num, SlotRanges slots) {
   std::lock_guard lk(migration_mu_);
   auto sync_id = next_sync_id_++;
   auto err_handler = [](const GenericError& err) {
@@ -813,9 +850,9 @@ uint32_t ClusterFamily::CreateOutgoingMigration(ConnectionContext* cntx, uint16_
     // Todo add error processing, stop migration process
     // fb2::Fiber("stop_Migration", &ClusterFamily::StopMigration, this, sync_id).Detach();
   };
-  auto info =
-      make_shared<OutgoingMigration>(shard_set->size(), cntx->conn()->RemoteEndpointAddress(), port,
-                                     std::move(slots), err_handler);
+  auto info = make_shared<OutgoingMigration>(shard_set->size(), streams_num,
+                                            cntx->conn()->RemoteEndpointAddress(), port,
+                                            std::move(slots), err_handler);
   auto [it, inserted] = outgoing_migration_jobs_.emplace(sync_id, std::move(info));
   CHECK(inserted);
   return sync_id;
@@ -824,12 +861,14 @@ uint32_t ClusterFamily::CreateOutgoingMigration(ConnectionContext* cntx, uint16_
 void ClusterFamily::DflyMigrateFlow(CmdArgList args, ConnectionContext* cntx) {
   CmdArgParser parser{args};
   auto [sync_id, shard_id] = parser.Next<uint32_t, uint32_t>();
+  uint32_t stream_id = parser.HasNext() ? parser.Next<uint32_t>() : 0;
 
   if (auto err = parser.Error(); err) {
     return cntx->SendError(err->MakeReply());
   }
 
-  VLOG(1) << "Create flow sync_id: " << sync_id << " shard_id: " << shard_id;
+  VLOG(1) << "Create flow sync_id: " << sync_id << " shard_id: " << shard_id
+          << " stream_id: " << stream_id;
 
   cntx->conn()->SetName(absl::StrCat("migration_flow_", sync_id));
 
@@ -837,6 +876,9 @@ void ClusterFamily::DflyMigrateFlow(CmdArgList args, ConnectionContext* cntx) {
   if (!info)
     return cntx->SendError(kIdNotFound);
 
+  if (shard_id >= shard_set->size() || stream_id >= info->GetStreamsNum())
+    return cntx->SendError(kSyntaxErr);
+
   cntx->conn()->Migrate(shard_set->pool()->at(shard_id));
   server_family_->journal()->StartInThread();
 
@@ -845,20 +887,22 @@ void ClusterFamily::DflyMigrateFlow(CmdArgList args, ConnectionContext* cntx) {
   EngineShard* shard = EngineShard::tlocal();
   DCHECK(shard->shard_id() == shard_id);
 
-  info->StartFlow(&shard->db_slice(), sync_id, server_family_->journal(), cntx->conn()->socket());
+  info->StartFlow(&shard->db_slice(), sync_id, stream_id, server_family_->journal(),
+                  cntx->conn()->socket());
 }
 
 void ClusterFamily::DflyMigrateFullSyncCut(CmdArgList args, ConnectionContext* cntx) {
   CHECK(cntx->slot_migration_id != 0);
   CmdArgParser parser{args};
-  auto [sync_id, shard_id] = parser.Next<uint32_t, uint32_t>();
+  // flow_id is the shard id of the source if it uses a single stream per shard.
+  auto [sync_id, flow_id] = parser.Next<uint32_t, uint32_t>();
 
   if (auto err = parser.Error(); err) {
     return cntx->SendError(err->MakeReply());
   }
 
   VLOG(1) << "Full sync cut "
-          << " sync_id: " << sync_id << " shard_id: " << shard_id << " shard";
+          << " sync_id: " << sync_id << " flow_id: " << flow_id;
 
   std::lock_guard lck(migration_mu_);
   auto migration_it = std::find_if(
@@ -870,7 +914,7 @@ void ClusterFamily::DflyMigrateFullSyncCut(CmdArgList args, ConnectionContext* c
     return cntx->SendError(kIdNotFound);
   }
 
-  (*migration_it)->SetStableSyncForFlow(shard_id);
+  (*migration_it)->SetStableSyncForFlow(flow_id);
   if ((*migration_it)->GetState() == MigrationState::C_STABLE_SYNC) {
     LOG(INFO) << "STABLE-SYNC state is set for sync_id " << sync_id;
   }
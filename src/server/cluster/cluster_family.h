@@ -66,7 +66,7 @@ class ClusterFamily {
   void MigrationConf(CmdArgList args, ConnectionContext* cntx);
 
   // DFLYMIGRATE FLOW initiate second step in slots migration procedure
-  // this request should be done for every shard on the target node
+  // this request should be done for every shard and stream on the target node
   // this method assocciate connection and shard that will be the data
   // source for migration
   void DflyMigrateFlow(CmdArgList args, ConnectionContext* cntx);
@@ -81,7 +81,8 @@ class ClusterFamily {
   void RemoveFinishedIncomingMigrations();
 
   // store info about migration and create unique session id
-  uint32_t CreateOutgoingMigration(ConnectionContext* cntx, uint16_t port, SlotRanges slots);
+  uint32_t CreateOutgoingMigration(ConnectionContext* cntx, uint16_t port, uint32_t streams_num,
+                                   SlotRanges slots);
 
   std::shared_ptr<OutgoingMigration> GetOutgoingMigration(uint32_t sync_id);
 
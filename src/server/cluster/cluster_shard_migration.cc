@@ -22,8 +22,14 @@ using namespace util;
 using absl::GetFlag;
 
 ClusterShardMigration::ClusterShardMigration(ServerContext server_context, uint32_t local_sync_id,
-                                             uint32_t shard_id, uint32_t sync_id, Service* service)
-    : ProtocolClient(server_context), source_shard_id_(shard_id), sync_id_(sync_id) {
+                                             uint32_t shard_id, uint32_t stream_id,
+                                             bool send_stream_id, uint32_t sync_id,
+                                             Service* service)
+    : ProtocolClient(server_context),
+      source_shard_id_(shard_id),
+      stream_id_(stream_id),
+      send_stream_id_(send_stream_id),
+      sync_id_(sync_id) {
   executor_ = std::make_unique<JournalExecutor>(service);
   executor_->connection_context()->slot_migration_id = local_sync_id;
 }
@@ -39,6 +45,8 @@ std::error_code ClusterShardMigration::StartSyncFlow(Context* cntx) {
   ResetParser(/*server_mode=*/false);
 
   std::string cmd = absl::StrCat("DFLYMIGRATE FLOW ", sync_id_, " ", source_shard_id_);
+  if (send_stream_id_)
+    absl::StrAppend(&cmd, " ", stream_id_);
   VLOG(1) << "cmd: " << cmd;
 
   RETURN_ON_ERR(SendCommand(cmd));
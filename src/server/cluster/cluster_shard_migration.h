@@ -17,8 +17,11 @@ class MultiShardExecution;
 // It is created per shard on the target node to initiate FLOW step.
 class ClusterShardMigration : public ProtocolClient {
  public:
+  // stream_id selects one of the flows of the source shard, it is sent to the source only if
+  // send_stream_id is set, for compatibility with sources that use a single flow per shard.
   ClusterShardMigration(ServerContext server_context, uint32_t local_sync_id, uint32_t shard_id,
-                        uint32_t sync_id, Service* service);
+                        uint32_t stream_id, bool send_stream_id, uint32_t sync_id,
+                        Service* service);
   ~ClusterShardMigration();
 
   std::error_code StartSyncFlow(Context* cntx);
@@ -45,6 +48,8 @@ class ClusterShardMigration : public ProtocolClient {
 
  private:
   uint32_t source_shard_id_;
+  uint32_t stream_id_;
+  bool send_stream_id_;
   uint32_t sync_id_;
   std::optional<base::IoBuf> leftover_buf_;
   std::unique_ptr<JournalExecutor> executor_;
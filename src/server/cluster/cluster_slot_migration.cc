@@ -95,12 +95,20 @@ error_code ClusterSlotMigration::Greet() {
   }
   VLOG(1) << "Migration command: " << cmd;
   RETURN_ON_ERR(SendCommandAndReadResponse(cmd));
-  // Response is: sync_id, num_shards
+  // Response is: sync_id, num_shards[, num_streams]
   if (!CheckRespFirstTypes({RespExpr::INT64, RespExpr::INT64}))
     return make_error_code(errc::bad_message);
 
   sync_id_ = get<int64_t>(LastResponseArgs()[0].u);
   source_shards_num_ = get<int64_t>(LastResponseArgs()[1].u);
+  streams_num_ = 1;
+  if (LastResponseArgs().size() > 2) {
+    if (!CheckRespFirstTypes({RespExpr::INT64, RespExpr::INT64, RespExpr::INT64}))
+      return make_error_code(errc::bad_message);
+    streams_num_ = get<int64_t>(LastResponseArgs()[2].u);
+    if (streams_num_ == 0)
+      return make_error_code(errc::bad_message);
+  }
 
   return error_code{};
 }
@@ -158,10 +166,14 @@ void ClusterSlotMigration::MainMigrationFb() {
 }
 
 std::error_code ClusterSlotMigration::InitiateSlotsMigration() {
-  shard_flows_.resize(source_shards_num_);
-  for (unsigned i = 0; i < source_shards_num_; ++i) {
-    shard_flows_[i].reset(
-        new ClusterShardMigration(server(), local_sync_id_, i, sync_id_, &service_));
+  // Every source shard sends its slots over streams_num_ flows, indexed by
+  // shard_id * streams_num_ + stream_id.
+  const uint32_t flows_num = source_shards_num_ * streams_num_;
+  shard_flows_.resize(flows_num);
+  for (unsigned i = 0; i < flows_num; ++i) {
+    shard_flows_[i].reset(new ClusterShardMigration(server(), local_sync_id_, i / streams_num_,
+                                                    i % streams_num_, streams_num_ > 1, sync_id_,
+                                                    &service_));
   }
 
   absl::Cleanup cleanup = [this]() {
@@ -184,7 +196,7 @@ std::error_code ClusterSlotMigration::InitiateSlotsMigration() {
   RETURN_ON_ERR(cntx_.SwitchErrorHandler(std::move(err_handler)));
 
   std::atomic_uint32_t synced_shards = 0;
-  auto partition = Partition(source_shards_num_);
+  auto partition = Partition(flows_num);
   auto shard_cb = [&](unsigned index, auto*) {
     for (auto id : partition[index]) {
       auto ec = shard_flows_[id]->StartSyncFlow(&cntx_);
@@ -200,8 +212,8 @@ std::error_code ClusterSlotMigration::InitiateSlotsMigration() {
   lock_guard lk{flows_op_mu_};
   shard_set->pool()->AwaitFiberOnAll(std::move(shard_cb));
 
-  VLOG(1) << synced_shards << " from " << source_shards_num_ << " shards were set flow";
-  if (synced_shards != source_shards_num_) {
+  VLOG(1) << synced_shards << " from " << flows_num << " flows were set";
+  if (synced_shards != flows_num) {
     cntx_.ReportError(std::make_error_code(errc::state_not_recoverable),
                       "incorrect shards num, only for tests");
   }
@@ -54,7 +54,7 @@ class ClusterSlotMigration : private ProtocolClient {
   // Send DFLYMIGRATE CONF to the source and get info about migration process
   std::error_code Greet();
   void MainMigrationFb();
-  // Creates flows, one per shard on the source node and manage migration process
+  // Creates flows, streams_num_ per shard on the source node and manage migration process
   std::error_code InitiateSlotsMigration();
 
   // may be called after we finish all flows
@@ -67,6 +67,7 @@ class ClusterSlotMigration : private ProtocolClient {
   std::vector<std::unique_ptr<ClusterShardMigration>> shard_flows_;
   SlotRanges slots_;
   uint32_t source_shards_num_ = 0;
+  uint32_t streams_num_ = 1;  // number of flows per source shard
   uint32_t sync_id_ = 0;
   uint32_t local_sync_id_ = 0;
   MigrationState state_ = MigrationState::C_NO_STATE;
@@ -4,20 +4,61 @@
 
 #include "server/cluster/outgoing_slot_migration.h"
 
+#include <absl/flags/flag.h>
+
+#include <algorithm>
 #include <atomic>
 
 #include "server/db_slice.h"
 #include "server/journal/streamer.h"
+#include "util/fibers/proactor_base.h"
+
+ABSL_FLAG(uint32_t, cluster_migration_max_bandwidth_mb, 0,
+          "Maximum rate in MB/s at which an outgoing slot migration sends data, shared by all "
+          "its streams. 0 means unlimited.");
 
 using namespace std;
 namespace dfly {
 
+namespace {
+
+// Data up to this duration at the capped rate may be sent in a burst without delay.
+constexpr uint64_t kMaxBurstNs = 50'000'000;
+
+}  // namespace
+
+// Accounts the data written by a stream and applies the bandwidth cap of the migration.
+class OutgoingMigration::ThrottledSink : public io::Sink {
+ public:
+  ThrottledSink(OutgoingMigration* migration, io::Sink* dest)
+      : migration_{migration}, dest_{dest} {
+  }
+
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) override {
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < len; ++i)
+      bytes += v[i].iov_len;
+
+    migration_->Throttle(bytes);
+    return dest_->WriteSome(v, len);
+  }
+
+ private:
+  OutgoingMigration* migration_;
+  io::Sink* dest_;
+};
+
 class OutgoingMigration::SliceSlotMigration {
  public:
-  SliceSlotMigration(DbSlice* slice, SlotSet slots, uint32_t sync_id, journal::Journal* journal,
-                     Context* cntx, io::Sink* dest)
-      : streamer_(slice, std::move(slots), sync_id, journal, cntx) {
-    streamer_.Start(dest);
+  SliceSlotMigration(OutgoingMigration* migration, DbSlice* slice, SlotSet slots, uint32_t sync_id,
+                     uint32_t flow_id, journal::Journal* journal, Context* cntx, io::Sink* dest)
+      : sink_(migration, dest), streamer_(slice, slots, sync_id, flow_id, journal, cntx) {
+    for (const auto& range : slots.ToSlotRanges()) {
+      for (size_t slot = range.start; slot <= range.end; ++slot)
+        keys_total_ += slice->GetSlotStats(slot).key_count;
+    }
+
+    streamer_.Start(&sink_);
     state_.store(MigrationState::C_FULL_SYNC, memory_order_relaxed);
   }
 
@@ -37,34 +78,62 @@ class OutgoingMigration::SliceSlotMigration {
                : state;
   }
 
+  size_t GetKeysTotal() const {
+    return keys_total_;
+  }
+
+  size_t GetKeysSent() const {
+    return streamer_.GetKeysWritten();
+  }
+
  private:
+  ThrottledSink sink_;
   RestoreStreamer streamer_;
+  size_t keys_total_ = 0;
   // Atomic only for simple read operation, writes - from the same thread, reads - from any thread
   atomic<MigrationState> state_ = MigrationState::C_CONNECTING;
 };
 
-OutgoingMigration::OutgoingMigration(std::uint32_t flows_num, std::string ip, uint16_t port,
-                                     SlotRanges slots, Context::ErrHandler err_handler)
-    : host_ip_(ip), port_(port), slots_(slots), cntx_(err_handler), slot_migrations_(flows_num) {
+OutgoingMigration::OutgoingMigration(std::uint32_t flows_num, std::uint32_t streams_num,
+                                     std::string ip, uint16_t port, SlotRanges slots,
+                                     Context::ErrHandler err_handler)
+    : host_ip_(ip),
+      port_(port),
+      slots_(slots),
+      streams_num_(streams_num),
+      cntx_(err_handler),
+      slot_migrations_(flows_num * streams_num),
+      stream_slots_(flows_num) {
+  DCHECK_GT(streams_num, 0u);
+  start_time_ns_ = util::ProactorBase::GetMonotonicTimeNs();
+  max_bandwidth_ = uint64_t(absl::GetFlag(FLAGS_cluster_migration_max_bandwidth_mb)) << 20;
 }
 
 OutgoingMigration::~OutgoingMigration() = default;
 
-void OutgoingMigration::StartFlow(DbSlice* slice, uint32_t sync_id, journal::Journal* journal,
-                                  io::Sink* dest) {
+void OutgoingMigration::StartFlow(DbSlice* slice, uint32_t sync_id, uint32_t stream_id,
+                                  journal::Journal* journal, io::Sink* dest) {
   const auto shard_id = slice->shard_id();
+  DCHECK_LT(stream_id, streams_num_);
 
   std::lock_guard lck(flows_mu_);
-  slot_migrations_[shard_id] =
-      std::make_unique<SliceSlotMigration>(slice, slots_, sync_id, journal, &cntx_, dest);
+  auto& shard_slots = stream_slots_[shard_id];
+  if (shard_slots.empty())
+    shard_slots = PartitionSlots(*slice);
+
+  uint32_t flow_id = shard_id * streams_num_ + stream_id;
+  slot_migrations_[flow_id] = std::make_unique<SliceSlotMigration>(
+      this, slice, shard_slots[stream_id], sync_id, flow_id, journal, &cntx_, dest);
 }
 
 void OutgoingMigration::Finalize(uint32_t shard_id) {
-  slot_migrations_[shard_id]->Finalize();
+  for (uint32_t i = 0; i < streams_num_; ++i)
+    slot_migrations_[shard_id * streams_num_ + i]->Finalize();
 }
 
 void OutgoingMigration::Cancel(uint32_t shard_id) {
-  slot_migrations_[shard_id]->Cancel();
+  for (uint32_t i = 0; i < streams_num_; ++i)
+    slot_migrations_[shard_id * streams_num_ + i]->Cancel();
 }
 
 MigrationState OutgoingMigration::GetState() const {
@@ -81,4 +150,67 @@ MigrationState OutgoingMigration::GetStateImpl() const {
   return min_state;
 }
 
+OutgoingMigration::Progress OutgoingMigration::GetProgress() const {
+  Progress res;
+  {
+    std::lock_guard lck(flows_mu_);
+    for (const auto& slot_migration : slot_migrations_) {
+      if (slot_migration) {
+        res.keys_total += slot_migration->GetKeysTotal();
+        res.keys_sent += slot_migration->GetKeysSent();
+      }
+    }
+  }
+  res.bytes_sent = bytes_sent_.load(memory_order_relaxed);
+  res.elapsed_usec = (util::ProactorBase::GetMonotonicTimeNs() - start_time_ns_) / 1000;
+  return res;
+}
+
+std::vector<SlotSet> OutgoingMigration::PartitionSlots(const DbSlice& slice) const {
+  vector<pair<uint64_t, SlotId>> slots;  // key count and slot id
+  uint64_t total_keys = 0;
+  for (const auto& range : slots_) {
+    for (size_t slot = range.start; slot <= range.end; ++slot) {
+      uint64_t key_count = slice.GetSlotStats(slot).key_count;
+      slots.emplace_back(key_count, slot);
+      total_keys += key_count;
+    }
+  }
+  sort(slots.begin(), slots.end());
+
+  std::vector<SlotSet> res(streams_num_);
+  uint64_t assigned_keys = 0;
+  size_t stream = 0;
+  for (const auto& [key_count, slot] : slots) {
+    // Move on to the next stream once the current one holds its share of the keys.
+    if (stream + 1 < streams_num_ && !res[stream].Empty() &&
+        assigned_keys >= total_keys * (stream + 1) / streams_num_) {
+      ++stream;
+    }
+    res[stream].Set(slot, true);
+    assigned_keys += key_count;
+  }
+  return res;
+}
+
+void OutgoingMigration::Throttle(size_t bytes) {
+  bytes_sent_.fetch_add(bytes, memory_order_relaxed);
+  if (max_bandwidth_ == 0)
+    return;
+
+  uint64_t now = util::ProactorBase::GetMonotonicTimeNs();
+  uint64_t cost_ns = bytes * 1'000'000'000ULL / max_bandwidth_;
+
+  // Advance the virtual time at which all the data sent so far is due at the capped rate.
+  uint64_t deadline = throttle_deadline_ns_.load(memory_order_relaxed);
+  uint64_t next_deadline;
+  do {
+    next_deadline = std::max(deadline, now) + cost_ns;
+  } while (!throttle_deadline_ns_.compare_exchange_weak(deadline, next_deadline,
+                                                        memory_order_relaxed));
+
+  if (next_deadline > now + kMaxBurstNs)
+    util::ThisFiber::SleepFor(chrono::nanoseconds(next_deadline - now - kMaxBurstNs));
+}
+
 }  // namespace dfly
@@ -3,6 +3,8 @@
 //
 #pragma once
 
+#include <atomic>
+
 #include "io/io.h"
 #include "server/cluster/cluster_config.h"
 #include "server/common.h"
@@ -18,18 +20,30 @@ class DbSlice;
 // Whole outgoing slots migration manager
 class OutgoingMigration {
  public:
+  struct Progress {
+    size_t keys_total = 0;  // keys in the migrated slots when their streams started
+    size_t keys_sent = 0;   // keys serialized so far
+    uint64_t bytes_sent = 0;
+    uint64_t elapsed_usec = 0;
+  };
+
   OutgoingMigration() = default;
   ~OutgoingMigration();
-  OutgoingMigration(std::uint32_t flows_num, std::string ip, uint16_t port, SlotRanges slots,
-                    Context::ErrHandler err_handler);
+  OutgoingMigration(std::uint32_t flows_num, std::uint32_t streams_num, std::string ip,
+                    uint16_t port, SlotRanges slots, Context::ErrHandler err_handler);
 
-  void StartFlow(DbSlice* slice, uint32_t sync_id, journal::Journal* journal, io::Sink* dest);
+  // Starts stream `stream_id` of the shard that owns slice. Every shard splits the migrated slots
+  // into streams_num streams that run concurrently over separate connections.
+  void StartFlow(DbSlice* slice, uint32_t sync_id, uint32_t stream_id, journal::Journal* journal,
+                 io::Sink* dest);
 
   void Finalize(uint32_t shard_id);
   void Cancel(uint32_t shard_id);
 
   MigrationState GetState() const;
 
+  Progress GetProgress() const;
+
   const std::string& GetHostIp() const {
     return host_ip_;
   };
@@ -42,18 +56,41 @@ class OutgoingMigration {
     return slots_;
   }
 
+  uint32_t GetStreamsNum() const {
+    return streams_num_;
+  }
+
  private:
   MigrationState GetStateImpl() const;
+
+  // Splits the migrated slots into streams with a similar number of keys of the shard.
+  // Slots are assigned in ascending order of their key count, so the smallest slots are
+  // grouped into the first streams.
+  std::vector<SlotSet> PartitionSlots(const DbSlice& slice) const;
+
+  // Delays the calling fiber to keep the rate of all the streams below the bandwidth cap.
+  void Throttle(size_t bytes);
+
   // SliceSlotMigration manages state and data transfering for the corresponding shard
   class SliceSlotMigration;
+  class ThrottledSink;
 
  private:
   std::string host_ip_;
   uint16_t port_;
   SlotRanges slots_;
+  uint32_t streams_num_ = 1;
   Context cntx_;
   mutable Mutex flows_mu_;
+  // Indexed by shard_id * streams_num_ + stream_id.
   std::vector<std::unique_ptr<SliceSlotMigration>> slot_migrations_ ABSL_GUARDED_BY(flows_mu_);
+  // Slots of every stream, computed once per shard when its first stream starts.
+  std::vector<std::vector<SlotSet>> stream_slots_ ABSL_GUARDED_BY(flows_mu_);
+
+  uint64_t start_time_ns_ = 0;
+  uint64_t max_bandwidth_ = 0;  // bytes per second, 0 for unlimited
+  std::atomic_uint64_t bytes_sent_ = 0;
+  std::atomic_uint64_t throttle_deadline_ns_ = 0;  // virtual time at which the sent data is due
 };
 
 }  // namespace dfly
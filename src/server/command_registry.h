@@ -52,8 +52,9 @@ enum CommandOpt : uint32_t {
 
 const char* OptName(CommandOpt fl);
 
+// EVAL and FCALL families run scripts.
 constexpr inline bool IsEvalKind(std::string_view name) {
-  return name.compare(0, 4, "EVAL") == 0;
+  return name.compare(0, 4, "EVAL") == 0 || name.compare(0, 5, "FCALL") == 0;
 }
 
 constexpr inline bool IsTransKind(std::string_view name) {
@@ -61,6 +62,7 @@ constexpr inline bool IsTransKind(std::string_view name) {
 }
 
 static_assert(IsEvalKind("EVAL") && IsEvalKind("EVALSHA"));
+static_assert(IsEvalKind("FCALL") && IsEvalKind("FCALL_RO"));
 static_assert(!IsEvalKind(""));
 
 };  // namespace CO
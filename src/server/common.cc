@@ -260,6 +260,27 @@ SearchStats& SearchStats::operator+=(const SearchStats& o) {
   return *this;
 }
 
+SnapshotStats& SnapshotStats::operator+=(const SnapshotStats& o) {
+  static_assert(sizeof(SnapshotStats) == 32);
+
+  ADD(keys_total);
+  ADD(keys_serialized);
+  ADD(throttled_cnt);
+  ADD(throttled_usec);
+
+  return *this;
+}
+
+JournalStreamStats& JournalStreamStats::operator+=(const JournalStreamStats& o) {
+  static_assert(sizeof(JournalStreamStats) == 24);
+
+  ADD(writes);
+  ADD(bytes_raw);
+  ADD(bytes_sent);
+
+  return *this;
+}
+
 #undef ADD
 
 OpResult<ScanOpts> ScanOpts::TryFrom(CmdArgList args) {
@@ -304,6 +325,24 @@ bool ScanOpts::Matches(std::string_view val_name) const {
   return stringmatchlen(pattern.data(), pattern.size(), val_name.data(), val_name.size(), 0) == 1;
 }
 
+bool ScanOpts::MayMatchPrefix(std::string_view prefix) const {
+  if (pattern.empty())
+    return true;
+
+  // Compare the literal head of the pattern, up to its first special character.
+  size_t len = std::min(pattern.size(), prefix.size());
+  for (size_t i = 0; i < len; ++i) {
+    char c = pattern[i];
+    if (c == '*' || c == '?' || c == '[' || c == '\\')
+      return true;
+    if (c != prefix[i])
+      return false;
+  }
+
+  // A fully literal pattern shorter than the prefix can not match the longer names.
+  return pattern.size() >= prefix.size();
+}
+
 GenericError::operator std::error_code() const {
   return ec_;
 }
@@ -151,6 +151,26 @@ struct SearchStats {
   SearchStats& operator+=(const SearchStats&);
 };
 
+struct SnapshotStats {
+  // Progress of the snapshots that are currently running.
+  size_t keys_total = 0;       // number of keys when the snapshots started
+  size_t keys_serialized = 0;  // keys serialized so far, both by iteration and on db change
+
+  // Cumulative throttling stats of the snapshot iteration fibers.
+  uint64_t throttled_cnt = 0;
+  uint64_t throttled_usec = 0;
+
+  SnapshotStats& operator+=(const SnapshotStats&);
+};
+
+struct JournalStreamStats {
+  uint64_t writes = 0;      // number of writes to the destination sockets
+  uint64_t bytes_raw = 0;   // size of the serialized journal entries
+  uint64_t bytes_sent = 0;  // size of the data written after compression
+
+  JournalStreamStats& operator+=(const JournalStreamStats&);
+};
+
 enum class GlobalState : uint8_t {
   ACTIVE,
   LOADING,
@@ -355,6 +375,10 @@ struct ScanOpts {
   unsigned bucket_id = UINT_MAX;
 
   bool Matches(std::string_view val_name) const;
+
+  // Returns false if no name that starts with prefix can match the pattern.
+  bool MayMatchPrefix(std::string_view prefix) const;
+
   static OpResult<ScanOpts> TryFrom(CmdArgList args);
 };
 
@@ -102,6 +102,7 @@ struct ConnectionState {
     size_t UsedMemory() const;
 
     absl::flat_hash_set<std::string_view> keys;  // declared keys
+    bool read_only = false;                      // write commands are rejected
 
     size_t async_cmds_heap_mem = 0;     // bytes used by async_cmds
     size_t async_cmds_heap_limit = 0;   // max bytes allowed for async_cmds
@@ -16,12 +16,24 @@
 #include "server/tiered_storage.h"
 #include "strings/human_readable.h"
 
-ABSL_FLAG(bool, enable_heartbeat_eviction, true,
-          "Enable eviction during heartbeat when memory is under pressure.");
+ABSL_FLAG(double, table_split_ahead_utilization, 0,
+          "If positive, segments of the main table filled above this ratio are split ahead of "
+          "time from the shard heartbeat, instead of when an insert finds them full. "
+          "0 disables it.");
 
-ABSL_FLAG(uint32_t, max_eviction_per_heartbeat, 100,
-          "The maximum number of key-value pairs that will be deleted in each eviction "
-          "when heartbeat based eviction is triggered under memory pressure.");
+ABSL_FLAG(uint32_t, compress_cold_strings_min_len, 0,
+          "If positive, string values of at least this length that were not accessed between two "
+          "passes of the shard heartbeat are kept LZ4 compressed in memory until the next write. "
+          "0 disables it.");
+
+ABSL_FLAG(bool, expiry_index, false,
+          "If true, keys with expiry are indexed by their expiry second, and the shard heartbeat "
+          "deletes the keys that expired instead of sampling the expire table.");
+
+ABSL_FLAG(bool, cache_admission_tinylfu, false,
+          "If true, in cache mode a new key evicts the least frequently accessed of the eviction "
+          "candidates, as estimated by a per-shard frequency sketch. Insertions are never "
+          "rejected, keys that were evicted for a less accessed one are only counted.");
 
 ABSL_FLAG(uint32_t, max_segment_to_consider, 4,
           "The maximum number of dashtable segments to scan in each eviction "
@@ -97,6 +109,10 @@ class PrimeEvictionPolicy {
     return checked_;
   }
 
+  unsigned rejected() const {
+    return rejected_;
+  }
+
  private:
   DbSlice* db_slice_;
   ssize_t mem_budget_;
@@ -105,6 +121,7 @@ class PrimeEvictionPolicy {
 
   unsigned evicted_ = 0;
   unsigned checked_ = 0;
+  unsigned rejected_ = 0;
 
   // unlike static constexpr can_evict, this parameter tells whether we can evict
   // items in runtime.
@@ -172,17 +189,43 @@ unsigned PrimeEvictionPolicy::Evict(const PrimeTable::HotspotBuckets& eb, PrimeT
     return 0;
 
   constexpr size_t kNumStashBuckets = ABSL_ARRAYSIZE(eb.probes.by_type.stash_buckets);
+  const FrequencySketch* sketch = db_slice_->admission_sketch();
+
+  auto last_slot = [&eb](unsigned i) {
+    auto it = eb.probes.by_type.stash_buckets[i];
+    it += (PrimeTable::kBucketWidth - 1);
+    return it;
+  };
 
   // choose "randomly" a stash bucket to evict an item.
-  auto bucket_it = eb.probes.by_type.stash_buckets[eb.key_hash % kNumStashBuckets];
-  auto last_slot_it = bucket_it;
-  last_slot_it += (PrimeTable::kBucketWidth - 1);
+  unsigned victim = eb.key_hash % kNumStashBuckets;
+  unsigned victim_freq = 0;
+  if (sketch) {
+    // With admission, the victim is the least frequently accessed of the stash candidates.
+    victim_freq = FrequencySketch::kMaxFrequency + 1;
+    for (unsigned i = 0; i < kNumStashBuckets; ++i) {
+      auto it = last_slot(i);
+      unsigned freq = it.is_done() ? 0 : sketch->Frequency(me->DoHash(it->first));
+      if (freq < victim_freq) {
+        victim = i;
+        victim_freq = freq;
+      }
+    }
+  }
+
+  auto bucket_it = eb.probes.by_type.stash_buckets[victim];
+  auto last_slot_it = last_slot(victim);
   if (!last_slot_it.is_done()) {
     // don't evict sticky items
     if (last_slot_it->first.IsSticky()) {
       return 0;
     }
 
+    // Cache mode must not fail writes, so a victim that is more popular than the new key is
+    // evicted as well, and only counted.
+    if (sketch && sketch->Frequency(eb.key_hash) < victim_freq)
+      ++rejected_;
+
     DbTable* table = db_slice_->GetDBTable(cntx_.db_index);
     auto& lt = table->trans_locks;
     string tmp;
@@ -226,19 +269,21 @@ DbStats& DbStats::operator+=(const DbStats& o) {
 }
 
 SliceEvents& SliceEvents::operator+=(const SliceEvents& o) {
-  static_assert(sizeof(SliceEvents) == 112, "You should update this function with new fields");
+  static_assert(sizeof(SliceEvents) == 128, "You should update this function with new fields");
 
   ADD(evicted_keys);
   ADD(hard_evictions);
   ADD(expired_keys);
   ADD(garbage_collected);
   ADD(stash_unloaded);
+  ADD(split_ahead);
   ADD(bumpups);
   ADD(garbage_checked);
   ADD(hits);
   ADD(misses);
   ADD(mutations);
   ADD(insertion_rejections);
+  ADD(admission_rejections);
   ADD(update);
   ADD(ram_hits);
   ADD(ram_misses);
@@ -257,6 +302,11 @@ DbSlice::DbSlice(uint32_t index, bool caching_mode, EngineShard* owner)
   CreateDb(0);
   expire_base_[0] = expire_base_[1] = 0;
   soft_budget_limit_ = (0.3 * max_memory_limit / shard_set->size());
+  use_expiry_index_ = GetFlag(FLAGS_expiry_index);
+  compress_cold_strings_ = GetFlag(FLAGS_compress_cold_strings_min_len) > 0;
+  if (GetFlag(FLAGS_cache_admission_tinylfu))
+    admission_sketch_ =
+        make_unique<FrequencySketch>(PrimeTable::kSegCapacity, owner->memory_resource());
 }
 
 DbSlice::~DbSlice() {
@@ -286,7 +336,22 @@ auto DbSlice::GetStats() const -> Stats {
     stats.expire_count = db_wrap.expire.size();
     stats.table_mem_usage = (db_wrap.prime.mem_usage() + db_wrap.expire.mem_usage());
   }
-  s.small_string_bytes = CompactObj::GetStats().small_string_bytes;
+  CompactObj::Stats co_stats = CompactObj::GetStats();
+  s.small_string_bytes = co_stats.small_string_bytes;
+  s.key_prefix_entries = co_stats.key_prefix_entries;
+  s.key_prefix_saved_bytes = co_stats.key_prefix_saved_bytes;
+  s.compressed_raw_bytes = co_stats.compressed_raw_bytes;
+  s.compressed_bytes = co_stats.compressed_bytes;
+
+  uint64_t now_ms = GetCurrentTimeMs();
+  for (const auto& db : db_arr_) {
+    if (!db)
+      continue;
+    s.expiry_index_entries += db->expiry_index.size();
+    s.expiry_index_bytes += db->expiry_index.MemUsage();
+    s.expiry_index_lag_ms = max(s.expiry_index_lag_ms, db->expiry_index.LagMs(now_ms));
+  }
+  s.admission_sketch_bytes = admission_sketch_ ? admission_sketch_->MemUsage() : 0;
 
   return s;
 }
@@ -438,6 +503,35 @@ OpResult<PrimeConstIterator> DbSlice::FindAndFetchReadOnly(const Context& cntx,
   return res.status();
 }
 
+void DbSlice::FindManyReadOnly(const Context& cntx, ArgSlice keys,
+                               std::optional<unsigned> req_obj_type, bool fetch,
+                               absl::Span<PrimeConstIterator> res) {
+  DCHECK_EQ(keys.size(), res.size());
+  if (!IsDbValid(cntx.db_index))
+    return;
+
+  // We resolve every group right after prefetching it and do not keep iterators of unresolved
+  // keys, because resolving a key may bump or expire items and move others.
+  constexpr size_t kGroup = PrimeTable::kPrefetchGroup;
+  uint64_t hashes[kGroup];
+  auto& prime = db_arr_[cntx.db_index]->prime;
+  auto load_mode = fetch ? LoadExternalMode::kLoad : LoadExternalMode::kDontLoad;
+
+  for (size_t start = 0; start < keys.size(); start += kGroup) {
+    size_t len = std::min(kGroup, keys.size() - start);
+    for (size_t i = 0; i < len; ++i) {
+      hashes[i] = prime.DoHash(keys[start + i]);
+      prime.Prefetch(hashes[i]);
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+      auto find_res = FindInternal(cntx, keys[start + i], hashes[i], req_obj_type,
+                                   UpdateStatsMode::kReadStats, load_mode);
+      res[start + i] = find_res ? PrimeConstIterator{find_res->it} : PrimeConstIterator{};
+    }
+  }
+}
+
 OpResult<DbSlice::ItAndExp> DbSlice::FindInternal(const Context& cntx, std::string_view key,
                                                   std::optional<unsigned> req_obj_type,
                                                   UpdateStatsMode stats_mode,
@@ -446,9 +540,22 @@ OpResult<DbSlice::ItAndExp> DbSlice::FindInternal(const Context& cntx, std::stri
     return OpStatus::KEY_NOTFOUND;
   }
 
+  uint64_t key_hash = db_arr_[cntx.db_index]->prime.DoHash(key);
+  return FindInternal(cntx, key, key_hash, req_obj_type, stats_mode, load_mode);
+}
+
+OpResult<DbSlice::ItAndExp> DbSlice::FindInternal(const Context& cntx, std::string_view key,
+                                                  uint64_t key_hash,
+                                                  std::optional<unsigned> req_obj_type,
+                                                  UpdateStatsMode stats_mode,
+                                                  LoadExternalMode load_mode) {
   DbSlice::ItAndExp res;
   auto& db = *db_arr_[cntx.db_index];
-  res.it = db.prime.Find(key);
+  res.it = db.prime.Find(key, key_hash);
+
+  // Misses count as well, so that a key that is requested again soon after a miss is admitted.
+  if (caching_mode_ && admission_sketch_)
+    admission_sketch_->Increment(key_hash);
 
   absl::Cleanup update_stats_on_miss = [&]() {
     switch (stats_mode) {
@@ -485,7 +592,12 @@ OpResult<DbSlice::ItAndExp> DbSlice::FindInternal(const Context& cntx, std::stri
       }
       events_.ram_hits++;
     }
-    res.it->first.SetTouched(true);
+  }
+  res.it->first.SetTouched(true);
+
+  if (compress_cold_strings_) {
+    // The value keeps its own TOUCHED bit, see CompressColdValuesStep.
+    res.it->second.SetTouched(true);
   }
 
   FiberAtomicGuard fg;
@@ -613,7 +725,8 @@ OpResult<DbSlice::AddOrFindResult> DbSlice::AddOrFindInternal(const Context& cnt
 
   // Fast-path if change_cb_ is empty so we Find or Add using
   // the insert operation: twice more efficient.
-  CompactObj co_key{key};
+  CompactObj co_key;
+  co_key.SetKey(key);
   PrimeIterator it;
 
   // I try/catch just for sake of having a convenient place to set a breakpoint.
@@ -622,8 +735,10 @@ OpResult<DbSlice::AddOrFindResult> DbSlice::AddOrFindInternal(const Context& cnt
   } catch (bad_alloc& e) {
     VLOG(2) << "AddOrFind2: bad alloc exception, budget: " << evp.mem_budget();
     events_.insertion_rejections++;
+    events_.admission_rejections += evp.rejected();
     return OpStatus::OUT_OF_MEMORY;
   }
+  events_.admission_rejections += evp.rejected();
 
   size_t evicted_obj_bytes = 0;
 
@@ -637,6 +752,10 @@ OpResult<DbSlice::AddOrFindResult> DbSlice::AddOrFindInternal(const Context& cnt
     // evicted_obj_bytes = EvictObjects(-evp.mem_budget(), it, &db);
   }
 
+  if (compress_cold_strings_)
+    it->second.SetTouched(true);  // New values are hot until the next pass over the table.
+  if (admission_sketch_ && db.prime.size() > admission_sketch_->capacity())
+    admission_sketch_->EnsureCapacity(db.prime.size() * 2);
   db.stats.inline_keys += it->first.IsInline();
   AccountObjectMemory(key, it->first.ObjType(), it->first.MallocUsed(), &db);  // Account for key
 
@@ -790,11 +909,23 @@ void DbSlice::AddExpire(DbIndex db_ind, PrimeIterator main_it, uint64_t at) {
   uint64_t delta = at - expire_base_[0];  // TODO: employ multigen expire updates.
   CHECK(db_arr_[db_ind]->expire.Insert(main_it->first.AsRef(), ExpirePeriod(delta)).second);
   main_it->second.SetExpire(true);
+  IndexExpiry(db_arr_[db_ind].get(), main_it->first, 0, at);
+}
+
+void DbSlice::SetExpireTime(DbIndex db_ind, PrimeIterator main_it, ExpireIterator exp_it,
+                            uint64_t at) {
+  DCHECK(main_it->second.HasExpire());
+  IndexExpiry(db_arr_[db_ind].get(), main_it->first, ExpireTime(exp_it), at);
+  exp_it->second = FromAbsoluteTime(at);
 }
 
 bool DbSlice::RemoveExpire(DbIndex db_ind, PrimeIterator main_it) {
   if (main_it->second.HasExpire()) {
-    CHECK_EQ(1u, db_arr_[db_ind]->expire.Erase(main_it->first));
+    DbTable* table = db_arr_[db_ind].get();
+    auto exp_it = table->expire.Find(main_it->first);
+    CHECK(IsValid(exp_it));
+    IndexExpiry(table, main_it->first, ExpireTime(exp_it), 0);
+    table->expire.Erase(exp_it);
     main_it->second.SetExpire(false);
     return true;
   }
@@ -890,7 +1021,7 @@ OpResult<int64_t> DbSlice::UpdateExpire(const Context& cntx, PrimeIterator prime
       return OpStatus::SKIPPED;
     }
 
-    expire_it->second = FromAbsoluteTime(abs_msec);
+    SetExpireTime(cntx.db_index, prime_it, expire_it, abs_msec);
     return abs_msec;
   } else {
     if (params.expire_options & ExpireFlags::EXPIRE_XX) {
@@ -924,9 +1055,11 @@ OpResult<DbSlice::AddOrFindResult> DbSlice::AddOrUpdateInternal(const Context& c
     it->second.SetExpire(true);
     uint64_t delta = expire_at_ms - expire_base_[0];
     if (IsValid(res.exp_it) && force_update) {
+      IndexExpiry(&db, it->first, ExpireTime(res.exp_it), expire_at_ms);
       res.exp_it->second = ExpirePeriod(delta);
     } else {
       res.exp_it = db.expire.InsertNew(it->first.AsRef(), ExpirePeriod(delta));
+      IndexExpiry(&db, it->first, 0, expire_at_ms);
     }
   }
 
@@ -1056,6 +1189,10 @@ void DbSlice::PostUpdate(DbIndex db_ind, PrimeIterator it, std::string_view key,
 
   ++events_.update;
 
+  // Writes may replace the value, which resets its TOUCHED bit.
+  if (compress_cold_strings_)
+    it->second.SetTouched(true);
+
   if (ClusterConfig::IsEnabled()) {
     db.slots_stats[ClusterConfig::KeySlot(key)].total_writes += 1;
   }
@@ -1196,6 +1333,42 @@ auto DbSlice::DeleteExpiredStep(const Context& cntx, unsigned count) -> DeleteEx
   return result;
 }
 
+auto DbSlice::DeleteExpiredIndexStep(const Context& cntx, unsigned limit) -> DeleteExpiredStats {
+  auto& db = *db_arr_[cntx.db_index];
+  DeleteExpiredStats result;
+
+  // Expiry is not allowed temporarily, keep the entries for later. Replicas delete the keys when
+  // the master replicates their expiry, and keep the entries in case they are promoted.
+  if (!expire_allowed_ || owner_->IsReplica())
+    return result;
+
+  vector<uint64_t> hashes;
+  db.expiry_index.PopDue(cntx.time_now_ms, limit, &hashes);
+
+  // Finds an entry with the hash that has expired. Stale entries of the index find nothing.
+  auto expired = [&](const PrimeKey& key) {
+    auto exp_it = db.expire.Find(key);
+    return IsValid(exp_it) && ExpireTime(exp_it) <= time_t(cntx.time_now_ms);
+  };
+
+  string tmp;
+  for (uint64_t hash : hashes) {
+    result.traversed++;
+    for (auto it = db.prime.FindFirst(hash, expired); IsValid(it);
+         it = db.prime.FindFirst(hash, expired)) {
+      if (!CheckLock(IntentLock::EXCLUSIVE, cntx.db_index, it->first.GetSlice(&tmp))) {
+        // Retry a second later. The entry is not removed with the key, but is found stale then.
+        db.expiry_index.Add(hash, cntx.time_now_ms);
+        break;
+      }
+      ExpireIfNeeded(cntx, it);
+      ++result.deleted;
+    }
+  }
+
+  return result;
+}
+
 int32_t DbSlice::GetNextSegmentForEviction(int32_t segment_id, DbIndex db_ind) const {
   // wraps around if we reached the end
   return db_arr_[db_ind]->prime.NextSeg((size_t)segment_id) %
@@ -1233,12 +1406,12 @@ void DbSlice::ScheduleForOffloadStep(DbIndex db_indx, size_t increase_goal_bytes
   }
 }
 
-void DbSlice::FreeMemWithEvictionStep(DbIndex db_ind, size_t increase_goal_bytes) {
+size_t DbSlice::FreeMemWithEvictionStep(DbIndex db_ind, size_t increase_goal_bytes,
+                                        size_t max_evictions) {
   DCHECK(!owner_->IsReplica());
-  if ((!caching_mode_) || !expire_allowed_ || !GetFlag(FLAGS_enable_heartbeat_eviction))
-    return;
+  if ((!caching_mode_) || !expire_allowed_)
+    return 0;
 
-  auto max_eviction_per_hb = GetFlag(FLAGS_max_eviction_per_heartbeat);
   auto max_segment_to_consider = GetFlag(FLAGS_max_segment_to_consider);
 
   auto time_start = absl::GetCurrentTimeNanos();
@@ -1289,7 +1462,7 @@ void DbSlice::FreeMemWithEvictionStep(DbIndex db_ind, size_t increase_goal_bytes
 
           used_memory_after = owner_->UsedMemory();
           // returns when whichever condition is met first
-          if ((evicted == max_eviction_per_hb) ||
+          if ((evicted == max_evictions) ||
               (used_memory_before - used_memory_after >= increase_goal_bytes))
             goto finish;
         }
@@ -1312,15 +1485,83 @@ finish:
   events_.evicted_keys += evicted;
   DVLOG(2) << "Memory usage before eviction: " << used_memory_before;
   DVLOG(2) << "Memory usage after eviction: " << used_memory_after;
-  DVLOG(2) << "Number of keys evicted / max eviction per hb: " << evicted << "/"
-           << max_eviction_per_hb;
+  DVLOG(2) << "Number of keys evicted / max evictions: " << evicted << "/" << max_evictions;
   DVLOG(2) << "Eviction time (us): " << (time_finish - time_start) / 1000;
+  return evicted;
 }
 
 void DbSlice::CreateDb(DbIndex db_ind) {
   auto& db = db_arr_[db_ind];
   if (!db) {
     db.reset(new DbTable{owner_->memory_resource(), db_ind});
+    db->prime.SetSplitAheadUtilization(GetFlag(FLAGS_table_split_ahead_utilization));
+  }
+}
+
+void DbSlice::SplitAheadStep(DbIndex db_ind) {
+  // Bounds the work done in a single heartbeat. In the worst case a step moves the entries of
+  // kMaxSplitsPerStep full segments and doubles the directory once, see DashTable::SplitAheadStep.
+  constexpr unsigned kMaxSplitsPerStep = 4;
+
+  auto& db = *db_arr_[db_ind];
+  if (!db.prime.HasSplitHints())
+    return;
+
+  // Same memory checks as in AddOrFindInternal.
+  bool apply_memory_limit =
+      !owner_->IsReplica() && !(ServerState::tlocal()->gstate() == GlobalState::LOADING);
+  PrimeEvictionPolicy evp{Context{db_ind, GetCurrentTimeMs()},
+                          (bool(caching_mode_) && !owner_->IsReplica()),
+                          memory_budget_,
+                          ssize_t(soft_budget_limit_),
+                          this,
+                          apply_memory_limit};
+
+  // Split moves the entries of the whole segment, so the buckets must be handed to the change
+  // callbacks first, as it is done for an insert into a full segment.
+  auto bucket_cb = [&](PrimeTable::bucket_iterator bit) {
+    for (const auto& ccb : change_cb_) {
+      ccb.second(db_ind, bit);
+    }
+  };
+  uint64_t ver_threshold = change_cb_.empty() ? 0 : change_cb_.back().first;
+
+  FiberAtomicGuard fg;
+  unsigned splits = db.prime.SplitAheadStep(kMaxSplitsPerStep, evp, ver_threshold, bucket_cb);
+  memory_budget_ = evp.mem_budget();
+  events_.split_ahead += splits;
+}
+
+void DbSlice::CompressColdValuesStep(DbIndex db_ind) {
+  // Bounds the work done in a single heartbeat.
+  constexpr unsigned kMaxBucketsPerStep = 64;
+  constexpr size_t kMaxBytesPerStep = 4_MB;
+
+  // Cold values are offloaded with tiered storage instead.
+  const size_t min_len = GetFlag(FLAGS_compress_cold_strings_min_len);
+  if (!compress_cold_strings_ || min_len == 0 || shard_owner()->tiered_storage())
+    return;
+
+  auto& db = *db_arr_[db_ind];
+  string tmp;
+  size_t compressed_bytes = 0;
+  auto cb = [&](PrimeIterator it) {
+    // Values that were read or written since the last pass are hot, see FindInternal. The bit is
+    // kept in the value, so that the bit of the key stays with the other users of key heat.
+    if (compressed_bytes < kMaxBytesPerStep && !it->second.WasTouched()) {
+      size_t orig_size = it->second.MallocUsed();
+      if (it->second.Compress(min_len)) {
+        compressed_bytes += it->second.Size();
+        int64_t delta = int64_t(it->second.MallocUsed()) - int64_t(orig_size);
+        AccountObjectMemory(it->first.GetSlice(&tmp), OBJ_STRING, delta, &db);
+      }
+    }
+    it->second.SetTouched(false);
+  };
+
+  FiberAtomicGuard fg;
+  for (unsigned i = 0; i < kMaxBucketsPerStep && compressed_bytes < kMaxBytesPerStep; ++i) {
+    db.compress_cursor = db.prime.TraverseBySegmentOrder(db.compress_cursor, cb);
   }
 }
 
@@ -1523,6 +1764,7 @@ void DbSlice::PerformDeletion(PrimeIterator del_it, ExpireIterator exp_it, DbTab
   std::string_view key = del_it->first.GetSlice(&tmp);
 
   if (!exp_it.is_done()) {
+    IndexExpiry(table, del_it->first, ExpireTime(exp_it), 0);
     table->expire.Erase(exp_it);
   }
 
@@ -9,6 +9,7 @@
 #include "facade/op_status.h"
 #include "server/common.h"
 #include "server/conn_context.h"
+#include "server/frequency_sketch.h"
 #include "server/table.h"
 
 namespace dfly {
@@ -44,7 +45,8 @@ struct SliceEvents {
   size_t garbage_checked = 0;
   size_t garbage_collected = 0;
   size_t stash_unloaded = 0;
-  size_t bumpups = 0;  // how many bump-upds we did.
+  size_t split_ahead = 0;  // segments split ahead of time, see SplitAheadStep.
+  size_t bumpups = 0;      // how many bump-upds we did.
 
   // hits/misses on keys
   size_t hits = 0;
@@ -58,6 +60,10 @@ struct SliceEvents {
   // how many insertions were rejected due to OOM.
   size_t insertion_rejections = 0;
 
+  // how many evicted keys were accessed more often than the key that replaced them, as estimated
+  // by the admission sketch. Such insertions are not rejected.
+  size_t admission_rejections = 0;
+
   // how many updates and insertions of keys between snapshot intervals
   size_t update = 0;
 
@@ -114,6 +120,14 @@ class DbSlice {
     std::vector<DbStats> db_stats;
     SliceEvents events;
     size_t small_string_bytes = 0;
+    size_t key_prefix_entries = 0;
+    size_t key_prefix_saved_bytes = 0;
+    size_t compressed_raw_bytes = 0;
+    size_t compressed_bytes = 0;
+    size_t expiry_index_entries = 0;
+    size_t expiry_index_bytes = 0;
+    uint64_t expiry_index_lag_ms = 0;  // of the most lagging db
+    size_t admission_sketch_bytes = 0;
   };
 
   using Context = DbContext;
@@ -216,6 +230,13 @@ class DbSlice {
   OpResult<PrimeConstIterator> FindAndFetchReadOnly(const Context& cntx, std::string_view key,
                                                     unsigned req_obj_type);
 
+  // Looks up every key like FindReadOnly(cntx, key, req_obj_type) and stores the iterator in
+  // res, leaving it done if the key is missing or has the wrong type. Groups of keys are hashed
+  // and their buckets prefetched before they are resolved, so that their cache misses overlap.
+  // If fetch is true, loads external values like FindAndFetchReadOnly.
+  void FindManyReadOnly(const Context& cntx, ArgSlice keys, std::optional<unsigned> req_obj_type,
+                        bool fetch, absl::Span<PrimeConstIterator> res);
+
   // Returns (iterator, args-index) if found, KEY_NOTFOUND otherwise.
   // If multiple keys are found, returns the first index in the ArgSlice.
   OpResult<std::pair<PrimeConstIterator, unsigned>> FindFirstReadOnly(const Context& cntx,
@@ -252,6 +273,9 @@ class DbSlice {
   // Adds expiry information.
   void AddExpire(DbIndex db_ind, PrimeIterator main_it, uint64_t at);
 
+  // Changes the expiry time of an entry that already has one.
+  void SetExpireTime(DbIndex db_ind, PrimeIterator main_it, ExpireIterator exp_it, uint64_t at);
+
   // Removes the corresponing expiry information if exists.
   // Returns true if expiry existed (and removed).
   bool RemoveExpire(DbIndex db_ind, PrimeIterator main_it);
@@ -367,9 +391,30 @@ class DbSlice {
 
   // Deletes some amount of possible expired items.
   DeleteExpiredStats DeleteExpiredStep(const Context& cntx, unsigned count);
-  void FreeMemWithEvictionStep(DbIndex db_indx, size_t increase_goal_bytes);
+
+  // With --expiry_index, deletes the keys whose expiry second has passed, looking up at most
+  // `limit` entries of the index. Used instead of DeleteExpiredStep.
+  DeleteExpiredStats DeleteExpiredIndexStep(const Context& cntx, unsigned limit);
+
+  bool UsesExpiryIndex() const {
+    return use_expiry_index_;
+  }
+
+  // In cache mode, evicts up to max_evictions keys or until increase_goal_bytes are freed,
+  // whichever comes first. Returns the number of evicted keys.
+  size_t FreeMemWithEvictionStep(DbIndex db_indx, size_t increase_goal_bytes,
+                                 size_t max_evictions);
+
+  // Splits the prime table segments that are close to full, if enabled by
+  // --table_split_ahead_utilization, so that inserts rarely pay for a split.
+  void SplitAheadStep(DbIndex db_ind);
+
   void ScheduleForOffloadStep(DbIndex db_indx, size_t increase_goal_bytes);
 
+  // Compresses a bounded number of string values that were not accessed since the previous pass,
+  // if enabled by --compress_cold_strings_min_len.
+  void CompressColdValuesStep(DbIndex db_ind);
+
   int32_t GetNextSegmentForEviction(int32_t segment_id, DbIndex db_ind) const;
 
   const DbTableArray& databases() const {
@@ -380,6 +425,16 @@ class DbSlice {
     caching_mode_ = 1;
   }
 
+  bool IsCacheMode() const {
+    return caching_mode_;
+  }
+
+  // Returns the access frequency sketch used to admit new keys in cache mode, or null if
+  // --cache_admission_tinylfu is disabled.
+  const FrequencySketch* admission_sketch() const {
+    return caching_mode_ ? admission_sketch_.get() : nullptr;
+  }
+
   // Test hook to inspect last locked keys.
   absl::flat_hash_set<std::string_view> TEST_GetLastLockedKeys() const {
     return uniq_keys_;
@@ -396,6 +451,10 @@ class DbSlice {
   // Resets the event counter for updates/insertions
   void ResetUpdateEvents();
 
+  const SliceEvents& events() const {
+    return events_;
+  }
+
   // Resets events_ member. Used by CONFIG RESETSTAT
   void ResetEvents();
 
@@ -449,6 +508,10 @@ class DbSlice {
   OpResult<ItAndExp> FindInternal(const Context& cntx, std::string_view key,
                                   std::optional<unsigned> req_obj_type, UpdateStatsMode stats_mode,
                                   LoadExternalMode load_mode);
+  // Same as above with key_hash = DoHash(key) precomputed by the caller.
+  OpResult<ItAndExp> FindInternal(const Context& cntx, std::string_view key, uint64_t key_hash,
+                                  std::optional<unsigned> req_obj_type, UpdateStatsMode stats_mode,
+                                  LoadExternalMode load_mode);
   OpResult<AddOrFindResult> AddOrFindInternal(const Context& cntx, std::string_view key,
                                               LoadExternalMode load_mode);
   OpResult<ItAndUpdater> FindMutableInternal(const Context& cntx, std::string_view key,
@@ -460,6 +523,19 @@ class DbSlice {
   }
   void RemoveFromTiered(PrimeIterator it, DbTable* table);
 
+  // Moves the key in the expiry index of the table, if it is enabled, from the expiry old_at to
+  // the expiry new_at. 0 stands for no expiry.
+  void IndexExpiry(DbTable* table, const PrimeKey& key, uint64_t old_at, uint64_t new_at) {
+    if (!use_expiry_index_ || old_at == new_at)
+      return;
+
+    uint64_t hash = key.HashCode();
+    if (old_at)
+      table->expiry_index.Remove(hash, old_at);
+    if (new_at)
+      table->expiry_index.Add(hash, new_at);
+  }
+
  private:
   ShardId shard_id_;
   uint8_t caching_mode_ : 1;
@@ -468,6 +544,11 @@ class DbSlice {
 
   time_t expire_base_[2];  // Used for expire logic, represents a real clock.
   bool expire_allowed_ = true;
+  bool use_expiry_index_ = false;
+  bool compress_cold_strings_ = false;  // Accesses mark values as hot, see CompressColdValuesStep.
+
+  // Counts key accesses by hash, see admission_sketch().
+  std::unique_ptr<FrequencySketch> admission_sketch_;
 
   uint64_t version_ = 1;  // Used to version entries in the PrimeTable.
   ssize_t memory_budget_ = SSIZE_MAX;
@@ -61,6 +61,7 @@ ABSL_DECLARE_FLAG(int32_t, port);
 ABSL_DECLARE_FLAG(uint32_t, memcached_port);
 ABSL_DECLARE_FLAG(uint16_t, admin_port);
 ABSL_DECLARE_FLAG(std::string, admin_bind);
+ABSL_DECLARE_FLAG(double, table_split_ahead_utilization);
 
 ABSL_FLAG(string, bind, "",
           "Bind address. If empty - binds on all interfaces. "
@@ -648,6 +649,12 @@ Usage: dragonfly [FLAGS]
     return 1;
   }
 
+  // 0 disables splitting ahead, 1 and above would never find a segment to split.
+  if (double util = GetFlag(FLAGS_table_split_ahead_utilization); !(util >= 0 && util < 1)) {
+    LOG(ERROR) << "table_split_ahead_utilization must be in (0, 1) or 0. Exiting...";
+    return 1;
+  }
+
   string pidfile_path = GetFlag(FLAGS_pidfile);
   if (!pidfile_path.empty()) {
     if (!CreatePidFile(pidfile_path)) {
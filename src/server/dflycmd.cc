@@ -3,6 +3,7 @@
 //
 #include "server/dflycmd.h"
 
+#include <absl/algorithm/container.h>
 #include <absl/random/random.h>
 #include <absl/strings/str_cat.h>
 #include <absl/strings/strip.h>
@@ -29,6 +30,7 @@
 #include "server/server_family.h"
 #include "server/server_state.h"
 #include "server/transaction.h"
+#include "server/version.h"
 using namespace std;
 
 ABSL_DECLARE_FLAG(string, dir);
@@ -117,7 +119,7 @@ void DflyCmd::Run(CmdArgList args, ConnectionContext* cntx) {
     return Thread(args, cntx);
   }
 
-  if (sub_cmd == "FLOW" && (args.size() == 4 || args.size() == 5)) {
+  if (sub_cmd == "FLOW" && (args.size() >= 4 && args.size() <= 6)) {
     return Flow(args, cntx);
   }
 
@@ -187,6 +189,17 @@ void DflyCmd::Flow(CmdArgList args, ConnectionContext* cntx) {
     }
   }
 
+  unsigned part_id = 0;
+  if (args.size() == 6) {
+    ToUpper(&args[4]);
+    if (ArgS(args, 4) != "PART")
+      return rb->SendError(kSyntaxErr);
+    if (!absl::SimpleAtoi(ArgS(args, 5), &part_id) || part_id == 0 ||
+        part_id >= kMaxFullSyncStreams) {
+      return rb->SendError(facade::kInvalidIntErr);
+    }
+  }
+
   VLOG(1) << "Got DFLY FLOW master_id: " << master_id << " sync_id: " << sync_id_str
           << " flow: " << flow_id_str << " seq: " << seqid.value_or(-1);
 
@@ -207,6 +220,29 @@ void DflyCmd::Flow(CmdArgList args, ConnectionContext* cntx) {
   if (replica_ptr->replica_state != SyncState::PREPARATION)
     return rb->SendError(kInvalidState);
 
+  auto& flow = replica_ptr->flows[flow_id];
+
+  if (part_id > 0) {
+    // Parts can be added only to a registered flow that does a full sync.
+    if (!flow.conn || flow.start_partial_sync_at.has_value())
+      return rb->SendError(kInvalidState);
+
+    // Closing a part connection cancels the replication similarly to the flow connection.
+    cntx->conn()->SetName(absl::StrCat("repl_flow_part_", sync_id));
+    cntx->conn_state.replication_info.repl_session_id = sync_id;
+
+    if (flow.part_conns.size() < part_id)
+      flow.part_conns.resize(part_id, nullptr);
+    flow.part_conns[part_id - 1] = cntx->conn();
+
+    cntx->conn()->Migrate(shard_set->pool()->at(flow_id));
+
+    rb->StartArray(2);
+    rb->SendSimpleString("FULL");
+    rb->SendSimpleString(flow.eof_token);
+    return;
+  }
+
   // Set meta info on connection.
   cntx->conn()->SetName(absl::StrCat("repl_flow_", sync_id));
   cntx->conn_state.replication_info.repl_session_id = sync_id;
@@ -215,7 +251,6 @@ void DflyCmd::Flow(CmdArgList args, ConnectionContext* cntx) {
   absl::InsecureBitGen gen;
   string eof_token = GetRandomHex(gen, 40);
 
-  auto& flow = replica_ptr->flows[flow_id];
   cntx->replication_flow = &flow;
   flow.conn = cntx->conn();
   flow.eof_token = eof_token;
@@ -463,6 +498,13 @@ OpStatus DflyCmd::StartFullSyncInThread(FlowInfo* flow, Context* cntx, EngineSha
       shard->shard_id() == 0 ? SaveMode::SINGLE_SHARD_WITH_SUMMARY : SaveMode::SINGLE_SHARD;
   flow->saver = std::make_unique<RdbSaver>(flow->conn->socket(), save_mode, false);
 
+  if (!flow->part_conns.empty() && !flow->start_partial_sync_at.has_value()) {
+    vector<io::Sink*> part_sinks;
+    for (facade::Connection* part_conn : flow->part_conns)
+      part_sinks.push_back(part_conn->socket());
+    flow->saver->SetPartSinks(std::move(part_sinks), flow->eof_token);
+  }
+
   flow->cleanup = [flow]() {
     flow->saver->Cancel();
     flow->TryShutdownSocket();
@@ -494,13 +536,24 @@ void DflyCmd::StopFullSyncInThread(FlowInfo* flow, EngineShard* shard) {
   // Reset cleanup and saver
   flow->cleanup = []() {};
   flow->saver.reset();
+
+  // The part connections carried full sync data only. They are detached from the replication
+  // session before they are closed, so that closing them does not cancel it.
+  for (facade::Connection* part_conn : flow->part_conns) {
+    auto* part_cntx = static_cast<ConnectionContext*>(part_conn->cntx());
+    part_cntx->conn_state.replication_info.repl_session_id = 0;
+    if (part_conn->socket()->IsOpen())
+      (void)part_conn->socket()->Shutdown(SHUT_RDWR);
+  }
+  flow->part_conns.clear();
 }
 
 OpStatus DflyCmd::StartStableSyncInThread(FlowInfo* flow, Context* cntx, EngineShard* shard) {
   // Create streamer for shard flows.
 
   if (shard != nullptr) {
-    flow->streamer.reset(new JournalStreamer(sf_->journal(), cntx));
+    bool allow_compression = flow->version >= DflyVersion::VER4;
+    flow->streamer.reset(new JournalStreamer(sf_->journal(), cntx, allow_compression));
     flow->streamer->Start(flow->conn->socket());
   }
 
@@ -754,7 +807,7 @@ bool DflyCmd::CheckReplicaStateOrReply(const ReplicaInfo& repl_info, SyncState e
   // Check all flows are connected.
   // This might happen if a flow abruptly disconnected before sending the SYNC request.
   for (const FlowInfo& flow : repl_info.flows) {
-    if (!flow.conn) {
+    if (!flow.conn || absl::c_linear_search(flow.part_conns, nullptr)) {
       rb->SendError(kInvalidState);
       return false;
     }
@@ -783,6 +836,11 @@ void FlowInfo::TryShutdownSocket() {
   if (conn->socket()->IsOpen()) {
     (void)conn->socket()->Shutdown(SHUT_RDWR);
   }
+
+  for (facade::Connection* part_conn : part_conns) {
+    if (part_conn && part_conn->socket()->IsOpen())
+      (void)part_conn->socket()->Shutdown(SHUT_RDWR);
+  }
 }
 
 FlowInfo::~FlowInfo() {
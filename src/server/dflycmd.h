@@ -38,6 +38,10 @@ struct FlowInfo {
 
   facade::Connection* conn = nullptr;
 
+  // Additional connections that carry a share of the full sync data of the flow.
+  // Registered with DFLY FLOW ... PART <part_id>, part_conns[i] holds part i + 1.
+  std::vector<facade::Connection*> part_conns;
+
   Fiber full_sync_fb;                         // Full sync fiber.
   std::unique_ptr<RdbSaver> saver;            // Saver for full sync phase.
   std::unique_ptr<JournalStreamer> streamer;  // Streamer for stable sync phase
@@ -160,6 +164,10 @@ class DflyCmd {
   // If seqid is given, it means the client wants to try partial sync.
   // If it is possible, return Ok and prepare for a partial sync, else
   // return error and ask the replica to execute FLOW again.
+  //
+  // FLOW <masterid> <syncid> <flowid> PART <partid>
+  // Register connection as an additional full sync stream of an already registered flow.
+  // The snapshot data of the flow is spread over the flow connection and all of its parts.
   void Flow(CmdArgList args, ConnectionContext* cntx);
 
   // SYNC <syncid>
@@ -25,6 +25,7 @@ extern "C" {
 ABSL_DECLARE_FLAG(float, mem_defrag_threshold);
 ABSL_DECLARE_FLAG(std::vector<std::string>, rename_command);
 ABSL_DECLARE_FLAG(double, oom_deny_ratio);
+ABSL_DECLARE_FLAG(bool, enable_heartbeat_eviction);
 
 namespace dfly {
 
@@ -443,6 +444,42 @@ TEST_F(DflyEngineTest, Bug207) {
   }
 }
 
+TEST_F(DflyEngineTest, TinyLfuAdmission) {
+  absl::FlagSaver fs;
+  SetTestFlag("cache_admission_tinylfu", "true");
+  ResetService();
+
+  max_memory_limit = 300000;
+  shard_set->TEST_EnableHeartBeat();
+  shard_set->TEST_EnableCacheMode();
+  absl::SetFlag(&FLAGS_oom_deny_ratio, 4);
+  absl::SetFlag(&FLAGS_enable_heartbeat_eviction, false);
+
+  constexpr unsigned kNumHot = 200;
+  for (unsigned i = 0; i < kNumHot; ++i) {
+    string key = StrCat("hot", i);
+    ASSERT_EQ("OK", Run({"set", key, "bar"}));
+    for (unsigned j = 0; j < 5; ++j)
+      Run({"get", key});
+  }
+
+  // A scan of keys that are written once must not flush the frequently read ones, and must not
+  // fail either.
+  for (unsigned i = 0; i < 10000; ++i) {
+    ASSERT_EQ("OK", Run({"set", StrCat("scan", i), "bar"}));
+  }
+
+  unsigned hot_left = 0;
+  for (unsigned i = 0; i < kNumHot; ++i) {
+    hot_left += Run({"exists", StrCat("hot", i)}).GetInt() == 1;
+  }
+
+  auto metrics = GetMetrics();
+  EXPECT_GT(metrics.events.evicted_keys, 0u);
+  EXPECT_GT(metrics.admission_sketch_bytes, 0u);
+  EXPECT_GT(hot_left, kNumHot * 9 / 10);
+}
+
 TEST_F(DflyEngineTest, StickyEviction) {
   shard_set->TEST_EnableHeartBeat();
   shard_set->TEST_EnableCacheMode();
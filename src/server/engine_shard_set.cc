@@ -11,10 +11,13 @@ extern "C" {
 }
 #include <sys/statvfs.h>
 
+#include <algorithm>
 #include <filesystem>
 
 #include "base/flags.h"
 #include "base/logging.h"
+#include "core/dense_set.h"
+#include "core/interpreter.h"
 #include "io/proc_reader.h"
 #include "server/blocking_controller.h"
 #include "server/search/doc_index.h"
@@ -37,6 +40,18 @@ ABSL_FLAG(dfly::MemoryBytesFlag, tiered_max_file_size, dfly::MemoryBytesFlag{},
           "0 - means the program will automatically determine its maximum file size. "
           "default: 0");
 
+ABSL_FLAG(bool, enable_heartbeat_eviction, true,
+          "Enable eviction during heartbeat when memory is under pressure.");
+
+ABSL_FLAG(uint32_t, max_eviction_per_heartbeat, 100,
+          "The maximum number of key-value pairs that will be deleted in each eviction "
+          "when heartbeat based eviction is triggered under memory pressure.");
+
+ABSL_FLAG(float, eviction_soft_watermark, 0,
+          "If positive, in cache mode a background fiber of every shard evicts keys ahead of "
+          "time to keep its memory usage below this ratio of maxmemory, based on the recent "
+          "memory growth rate. 0 disables it.");
+
 ABSL_FLAG(float, tiered_offload_threshold, 0.5,
           "The ratio of used/max memory above which we start offloading values to disk");
 
@@ -65,6 +80,18 @@ ABSL_FLAG(string, shard_round_robin_prefix, "",
           "support up to a few hundreds of prefixes. Note: prefix is looked inside hash tags when "
           "cluster mode is enabled.");
 
+ABSL_FLAG(uint32_t, expiry_index_max_deletes_per_heartbeat, 2000,
+          "With --expiry_index, the maximum number of index entries each shard processes per db "
+          "in a heartbeat.");
+
+ABSL_FLAG(std::vector<std::string>, key_prefixes, {},
+          "Comma separated key prefixes, each ending with ':', that the keys of every shard store "
+          "as a short reference to a shared dictionary instead of a copy.");
+
+ABSL_FLAG(uint32_t, key_prefix_max_learned, 0,
+          "Maximum number of additional key prefixes each shard learns from the common prefixes "
+          "of its keys. 0 disables learning.");
+
 namespace dfly {
 
 using namespace util;
@@ -75,6 +102,9 @@ namespace {
 
 constexpr uint64_t kCursorDoneState = 0u;
 
+// Buckets of growing sets and hashes that are rehashed by every heartbeat.
+constexpr size_t kRehashBucketsPerHeartbeat = 1024;
+
 vector<EngineShardSet::CachedStats> cached_stats;  // initialized in EngineShardSet::Init
 
 struct ShardMemUsage {
@@ -374,6 +404,9 @@ void EngineShard::Shutdown() {
   if (fiber_periodic_.IsJoinable()) {
     fiber_periodic_.Join();
   }
+  if (fiber_eviction_.IsJoinable()) {
+    fiber_eviction_.Join();
+  }
 
   ProactorBase::me()->RemoveOnIdleTask(defrag_task_);
 }
@@ -387,6 +420,13 @@ void EngineShard::StartPeriodicFiber(util::ProactorBase* pb) {
     ThisFiber::SetName(absl::StrCat("shard_periodic", index));
     RunPeriodic(std::chrono::milliseconds(period_ms));
   });
+
+  if (GetFlag(FLAGS_eviction_soft_watermark) > 0) {
+    fiber_eviction_ = MakeFiber([this, index = pb->GetPoolIndex(), period_ms = clock_cycle_ms] {
+      ThisFiber::SetName(absl::StrCat("shard_eviction", index));
+      RunEvictionController(std::chrono::milliseconds(period_ms));
+    });
+  }
 }
 
 void EngineShard::InitThreadLocal(ProactorBase* pb, bool update_db_time, size_t max_file_size) {
@@ -397,6 +437,7 @@ void EngineShard::InitThreadLocal(ProactorBase* pb, bool update_db_time, size_t
   shard_ = new (ptr) EngineShard(pb, data_heap);
 
   CompactObj::InitThreadLocal(shard_->memory_resource());
+  CompactObj::InitKeyPrefixes(GetFlag(FLAGS_key_prefixes), GetFlag(FLAGS_key_prefix_max_learned));
   SmallString::InitThreadLocal(data_heap);
 
   string backing_prefix = GetFlag(FLAGS_tiered_prefix);
@@ -587,6 +628,22 @@ void EngineShard::RemoveContTx(Transaction* tx) {
 void EngineShard::Heartbeat() {
   CacheStats();
 
+  // Keys evicted upon insertion, by the heartbeat or by the eviction controller.
+  size_t evicted_keys = db_slice_.events().evicted_keys;
+  counter_[EVICTED].IncBy(evicted_keys - std::min(evicted_keys, last_evicted_keys_));
+  last_evicted_keys_ = evicted_keys;
+
+  // Completes the growth of sets and hashes that are not modified anymore.
+  DenseSet::RehashStepAll(kRehashBucketsPerHeartbeat);
+
+  // Replicas grow their tables as well, e.g. during full sync.
+  for (unsigned i = 0; i < db_slice_.db_array_size(); ++i) {
+    if (db_slice_.IsDbValid(i)) {
+      db_slice_.SplitAheadStep(i);
+      db_slice_.CompressColdValuesStep(i);
+    }
+  }
+
   if (IsReplica())  // Never run expiration on replica.
     return;
 
@@ -616,7 +673,13 @@ void EngineShard::Heartbeat() {
 
     db_cntx.db_index = i;
     auto [pt, expt] = db_slice_.GetTables(i);
-    if (expt->size() > pt->size() / 4) {
+    if (db_slice_.UsesExpiryIndex()) {
+      DbSlice::DeleteExpiredStats stats = db_slice_.DeleteExpiredIndexStep(
+          db_cntx, GetFlag(FLAGS_expiry_index_max_deletes_per_heartbeat));
+
+      counter_[TTL_TRAVERSE].IncBy(stats.traversed);
+      counter_[TTL_DELETE].IncBy(stats.deleted);
+    } else if (expt->size() > pt->size() / 4) {
       DbSlice::DeleteExpiredStats stats = db_slice_.DeleteExpiredStep(db_cntx, ttl_delete_target);
 
       counter_[TTL_TRAVERSE].IncBy(stats.traversed);
@@ -624,8 +687,10 @@ void EngineShard::Heartbeat() {
     }
 
     // if our budget is below the limit
-    if (db_slice_.memory_budget() < eviction_redline) {
-      db_slice_.FreeMemWithEvictionStep(i, eviction_redline - db_slice_.memory_budget());
+    if (GetFlag(FLAGS_enable_heartbeat_eviction) &&
+        db_slice_.memory_budget() < eviction_redline) {
+      db_slice_.FreeMemWithEvictionStep(i, eviction_redline - db_slice_.memory_budget(),
+                                        GetFlag(FLAGS_max_eviction_per_heartbeat));
     }
 
     if (tiered_storage_) {
@@ -644,6 +709,70 @@ void EngineShard::Heartbeat() {
   }
 }
 
+void EngineShard::RunEvictionController(std::chrono::milliseconds period_ms) {
+  while (!fiber_periodic_done_.WaitFor(period_ms)) {
+    EvictionControllerStep();
+  }
+}
+
+void EngineShard::EvictionControllerStep() {
+  // The memory growth is extrapolated this many steps ahead, so that the eviction starts early
+  // enough to absorb write bursts.
+  constexpr unsigned kPredictionSteps = 10;
+  constexpr double kGrowthDecay = 0.8;
+  constexpr size_t kMinEvictions = 16;
+  constexpr size_t kMaxEvictionsPerStep = 4096;
+  constexpr size_t kMaxEvictionsPerBatch = 256;
+
+  EvictionState& state = eviction_state_;
+  size_t used_memory = UsedMemory();
+  double growth = double(used_memory) - double(state.last_used_memory);
+  state.growth_per_step = kGrowthDecay * state.growth_per_step + (1 - kGrowthDecay) * growth;
+  state.last_used_memory = used_memory;
+
+  // Checked again after every yield, since the shard may become a replica meanwhile.
+  auto can_evict = [this] { return !IsReplica() && db_slice_.IsCacheMode(); };
+  if (!can_evict())
+    return;
+
+  size_t watermark = max_memory_limit * GetFlag(FLAGS_eviction_soft_watermark) / shard_set->size();
+  size_t predicted = used_memory + std::max(state.growth_per_step, 0.0) * kPredictionSteps;
+  if (predicted <= watermark)
+    return;
+
+  // The budget follows the amount of memory to free, so that bursts are absorbed within a few
+  // steps while a steady state evicts little at a time.
+  size_t goal_bytes = predicted - watermark;
+  size_t bytes_per_object = std::max<size_t>(db_slice_.bytes_per_object(), 1);
+  size_t budget = std::clamp(goal_bytes / bytes_per_object, kMinEvictions, kMaxEvictionsPerStep);
+
+  size_t evicted = 0;
+  for (DbIndex i = 0; i < db_slice_.db_array_size() && goal_bytes > 0; ++i) {
+    while (evicted < budget && goal_bytes > 0 && db_slice_.IsDbValid(i) && can_evict()) {
+      size_t before = UsedMemory();
+      size_t batch = std::min(budget - evicted, kMaxEvictionsPerBatch);
+      size_t res = db_slice_.FreeMemWithEvictionStep(i, goal_bytes, batch);
+      if (res == 0)
+        break;
+
+      evicted += res;
+      goal_bytes -= std::min(goal_bytes, before - std::min(before, UsedMemory()));
+
+      // The journal entries of the evicted keys are not written to the socket by the eviction
+      // itself. Flush them before yielding, as the heartbeat does.
+      if (journal_) {
+        TriggerJournalWriteToSink();
+      }
+
+      // Evict in small batches so that the commands of the shard are not delayed.
+      ThisFiber::Yield();
+    }
+  }
+
+  VLOG(2) << "Eviction controller: used " << used_memory << ", predicted " << predicted
+          << ", evicted " << evicted;
+}
+
 void EngineShard::RunPeriodic(std::chrono::milliseconds period_ms) {
   bool runs_global_periodic = (shard_id() == 0);  // Only shard 0 runs global periodic.
   unsigned global_count = 0;
@@ -703,7 +832,8 @@ void EngineShard::CacheStats() {
     DbTable* table = db_slice_.GetDBTable(i);
     if (table) {
       entries += table->prime.size();
-      table_memory += (table->prime.mem_usage() + table->expire.mem_usage());
+      table_memory += (table->prime.mem_usage() + table->expire.mem_usage() +
+                       table->expiry_index.MemUsage());
     }
   }
   size_t obj_memory = table_memory <= used_mem ? used_mem - table_memory : 0;
@@ -714,7 +844,7 @@ void EngineShard::CacheStats() {
 
 size_t EngineShard::UsedMemory() const {
   return mi_resource_.used() + zmalloc_used_memory_tl + SmallString::UsedThreadLocal() +
-         search_indices()->GetUsedMemory();
+         Interpreter::UsedThreadLocal() + search_indices()->GetUsedMemory();
 }
 
 BlockingController* EngineShard::EnsureBlockingController() {
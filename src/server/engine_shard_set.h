@@ -129,7 +129,7 @@ class EngineShard {
   sds tmp_str1;
 
   // Moving average counters.
-  enum MovingCnt { TTL_TRAVERSE, TTL_DELETE, COUNTER_TOTAL };
+  enum MovingCnt { TTL_TRAVERSE, TTL_DELETE, EVICTED, COUNTER_TOTAL };
 
   // Returns moving sum over the last 6 seconds.
   uint32_t GetMovingSum6(MovingCnt type) const {
@@ -206,6 +206,10 @@ class EngineShard {
   void Heartbeat();
   void RunPeriodic(std::chrono::milliseconds period_ms);
 
+  // Runs the proactive eviction controller, see --eviction_soft_watermark.
+  void RunEvictionController(std::chrono::milliseconds period_ms);
+  void EvictionControllerStep();
+
   void CacheStats();
 
   // We are running a task that checks whether we need to
@@ -244,8 +248,17 @@ class EngineShard {
 
   uint32_t defrag_task_ = 0;
   Fiber fiber_periodic_;
+  Fiber fiber_eviction_;  // also stops on fiber_periodic_done_.
   util::fb2::Done fiber_periodic_done_;
 
+  // State of the eviction controller.
+  struct EvictionState {
+    size_t last_used_memory = 0;
+    double growth_per_step = 0;  // moving average of the memory growth between two steps.
+  } eviction_state_;
+
+  size_t last_evicted_keys_ = 0;  // evicted keys of the slice as of the previous heartbeat.
+
   DefragTaskState defrag_state_;
   std::unique_ptr<TieredStorage> tiered_storage_;
   std::unique_ptr<ShardDocIndices> shard_search_indices_;
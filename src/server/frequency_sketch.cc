@@ -0,0 +1,89 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/frequency_sketch.h"
+
+#include <absl/numeric/bits.h>
+
+#include <algorithm>
+
+namespace dfly {
+
+namespace {
+
+constexpr uint64_t kMinCapacity = 64;
+constexpr uint64_t kResetMask = 0x7777777777777777ULL;
+
+uint64_t Spread(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace
+
+FrequencySketch::FrequencySketch(size_t capacity, PMR_NS::memory_resource* mr) : table_(mr) {
+  EnsureCapacity(std::max<uint64_t>(capacity, kMinCapacity));
+}
+
+void FrequencySketch::EnsureCapacity(size_t capacity) {
+  size_t size = absl::bit_ceil(std::max<uint64_t>(capacity, kMinCapacity));
+  if (size <= this->capacity())
+    return;
+
+  // Release the old table before the new one is allocated.
+  table_ = PMR_NS::vector<uint64_t>(table_.get_allocator());
+  table_.resize(size / kHashesPerWord, 0);
+  additions_ = 0;
+  sample_size_ = size * 10;
+}
+
+size_t FrequencySketch::Locate(uint64_t hash, unsigned nibbles[4]) const {
+  uint64_t h = Spread(hash);
+
+  // Every word holds 16 counters: 4 for each row. The upper bits of h choose the counter of
+  // every row within the word.
+  for (unsigned i = 0; i < 4; ++i) {
+    nibbles[i] = i * 4 + ((h >> (56 + i * 2)) & 3);
+  }
+  return h & (table_.size() - 1);
+}
+
+void FrequencySketch::Increment(uint64_t hash) {
+  unsigned nibbles[4];
+  uint64_t& word = table_[Locate(hash, nibbles)];
+
+  bool added = false;
+  for (unsigned nibble : nibbles) {
+    unsigned shift = nibble * 4;
+    if (((word >> shift) & 0xF) < kMaxFrequency) {
+      word += 1ULL << shift;
+      added = true;
+    }
+  }
+
+  if (added && ++additions_ >= sample_size_)
+    Reset();
+}
+
+unsigned FrequencySketch::Frequency(uint64_t hash) const {
+  unsigned nibbles[4];
+  uint64_t word = table_[Locate(hash, nibbles)];
+
+  unsigned res = kMaxFrequency;
+  for (unsigned nibble : nibbles) {
+    res = std::min<unsigned>(res, (word >> (nibble * 4)) & 0xF);
+  }
+  return res;
+}
+
+void FrequencySketch::Reset() {
+  for (uint64_t& word : table_) {
+    word = (word >> 1) & kResetMask;
+  }
+  additions_ /= 2;
+}
+
+}  // namespace dfly
@@ -0,0 +1,61 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/pmr/memory_resource.h"
+
+namespace dfly {
+
+// FrequencySketch estimates how often a key hash was seen recently, as used by TinyLFU admission.
+//
+// Notes:
+// - This is a count-min sketch with 4 rows of 4-bit counters. Counters of all rows that belong to
+//   the same hash are packed into one 64-bit word, so Increment() and Frequency() touch a single
+//   cache line.
+// - Counters saturate at 15. Once the number of increments reaches 10 times the capacity, all the
+//   counters are halved, so the estimate reflects the recent history only.
+// - Like TopKeys, this class is statistical in nature and over-estimates on collisions.
+class FrequencySketch {
+ public:
+  static constexpr unsigned kMaxFrequency = 15;
+
+  // capacity is the expected number of distinct hashes, rounded up to a power of 2. Every hash
+  // takes a 4-bit counter in each row, i.e. 2 bytes.
+  explicit FrequencySketch(size_t capacity,
+                           PMR_NS::memory_resource* mr = PMR_NS::get_default_resource());
+
+  void Increment(uint64_t hash);
+  unsigned Frequency(uint64_t hash) const;
+
+  // Grows the sketch if capacity is larger than the current one. The history is lost on growth.
+  void EnsureCapacity(size_t capacity);
+
+  size_t capacity() const {
+    return table_.size() * kHashesPerWord;
+  }
+
+  size_t MemUsage() const {
+    return table_.capacity() * sizeof(uint64_t);
+  }
+
+ private:
+  // Returns the word of the hash and sets *nibbles to the index of its counter in every row.
+  size_t Locate(uint64_t hash, unsigned nibbles[4]) const;
+
+  void Reset();
+
+  // Every word holds 16 counters, 4 for each row.
+  static constexpr unsigned kHashesPerWord = 4;
+
+  PMR_NS::vector<uint64_t> table_;
+  uint64_t additions_ = 0;
+  uint64_t sample_size_ = 0;
+};
+
+}  // namespace dfly
@@ -0,0 +1,71 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/frequency_sketch.h"
+
+#include "base/gtest.h"
+#include "base/logging.h"
+
+namespace dfly {
+
+namespace {
+
+uint64_t Hash(uint64_t i) {
+  return i * 0x9E3779B97F4A7C15ULL;
+}
+
+}  // namespace
+
+TEST(FrequencySketchTest, Basic) {
+  FrequencySketch sketch(1024);
+  EXPECT_EQ(0u, sketch.Frequency(Hash(1)));
+
+  for (unsigned i = 0; i < 5; ++i)
+    sketch.Increment(Hash(1));
+  EXPECT_EQ(5u, sketch.Frequency(Hash(1)));
+  EXPECT_EQ(0u, sketch.Frequency(Hash(2)));
+
+  for (unsigned i = 0; i < 100; ++i)
+    sketch.Increment(Hash(1));
+  EXPECT_EQ(FrequencySketch::kMaxFrequency, sketch.Frequency(Hash(1)));
+}
+
+TEST(FrequencySketchTest, HotKeysStandOut) {
+  FrequencySketch sketch(1024);
+
+  // A scan of one-hit keys must not make them look as frequent as the hot ones.
+  for (unsigned round = 0; round < 4; ++round) {
+    for (uint64_t i = 0; i < 10; ++i)
+      sketch.Increment(Hash(i));
+  }
+  for (uint64_t i = 1000; i < 1500; ++i)
+    sketch.Increment(Hash(i));
+
+  unsigned cold = 0;
+  for (uint64_t i = 1000; i < 1500; ++i)
+    cold += sketch.Frequency(Hash(i)) >= 4;
+  for (uint64_t i = 0; i < 10; ++i)
+    EXPECT_GE(sketch.Frequency(Hash(i)), 4u);
+  EXPECT_LT(cold, 25u);
+}
+
+TEST(FrequencySketchTest, Aging) {
+  FrequencySketch sketch(64);
+  for (unsigned i = 0; i < 8; ++i)
+    sketch.Increment(Hash(1));
+  EXPECT_EQ(8u, sketch.Frequency(Hash(1)));
+
+  // Enough increments of other keys halve all the counters, even the saturated ones.
+  for (uint64_t i = 100; i < 100 + sketch.capacity() * 10; ++i)
+    sketch.Increment(Hash(i));
+  EXPECT_LT(sketch.Frequency(Hash(1)), 8u);
+
+  size_t capacity = sketch.capacity();
+  sketch.EnsureCapacity(capacity * 4);
+  EXPECT_EQ(capacity * 4, sketch.capacity());
+  EXPECT_EQ(capacity * 4 * 2, sketch.MemUsage());  // 2 bytes per hash.
+  EXPECT_EQ(0u, sketch.Frequency(Hash(1)));
+}
+
+}  // namespace dfly
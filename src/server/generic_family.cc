@@ -4,6 +4,8 @@
 
 #include "server/generic_family.h"
 
+#include <absl/container/inlined_vector.h>
+
 extern "C" {
 #include "redis/crc64.h"
 #include "redis/util.h"
@@ -330,6 +332,9 @@ OpStatus Renamer::MoveSrc(Transaction* t, EngineShard* es) {
     if (it->second.ObjType() == OBJ_STRING) {
       it->second.GetString(&str_val_);
     } else {
+      // Growing sets are tracked by their thread, UpdateDest attaches them to the destination.
+      it->second.DetachFromThread();
+
       bool has_expire = it->second.HasExpire();
       pv_ = std::move(it->second);
       it->second.SetExpire(has_expire);
@@ -352,6 +357,7 @@ OpStatus Renamer::UpdateDest(Transaction* t, EngineShard* es) {
     auto res = db_slice.FindMutable(t->GetDbContext(), dest_key);
     auto& dest_it = res.it;
     bool is_prior_list = false;
+    pv_.AttachToThread();
 
     if (IsValid(dest_it)) {
       bool has_expire = dest_it->second.HasExpire();
@@ -485,6 +491,11 @@ bool ScanCb(const OpArgs& op_args, PrimeIterator it, const ScanOpts& opts, Strin
     return false;
   }
 
+  // Keys sharing a dictionary prefix are filtered without materializing them.
+  string_view key_prefix = it->first.GetKeyPrefix();
+  if (!key_prefix.empty() && !opts.MayMatchPrefix(key_prefix))
+    return false;
+
   string str = it->first.ToString();
   if (!opts.Matches(str)) {
     return false;
@@ -1381,11 +1392,12 @@ OpResult<uint32_t> GenericFamily::OpDel(const OpArgs& op_args, ArgSlice keys) {
 OpResult<uint32_t> GenericFamily::OpExists(const OpArgs& op_args, ArgSlice keys) {
   DVLOG(1) << "Exists: " << keys[0];
   auto& db_slice = op_args.shard->db_slice();
-  uint32_t res = 0;
+  absl::InlinedVector<PrimeConstIterator, 32> iters(keys.size());
+  db_slice.FindManyReadOnly(op_args.db_cntx, keys, std::nullopt, false, absl::MakeSpan(iters));
 
-  for (uint32_t i = 0; i < keys.size(); ++i) {
-    auto find_res = db_slice.FindReadOnly(op_args.db_cntx, keys[i]);
-    res += IsValid(find_res.it);
+  uint32_t res = 0;
+  for (const auto& it : iters) {
+    res += IsValid(it);
   }
   return res;
 }
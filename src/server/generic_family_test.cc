@@ -8,8 +8,11 @@ extern "C" {
 #include "redis/rdb.h"
 }
 
+#include <absl/flags/reflection.h>
+
 #include "base/gtest.h"
 #include "base/logging.h"
+#include "core/sorted_map.h"
 #include "facade/facade_test.h"
 #include "server/command_registry.h"
 #include "server/conn_context.h"
@@ -75,6 +78,44 @@ TEST_F(GenericFamilyTest, Expire) {
   EXPECT_THAT(resp, ArgType(RespExpr::NIL));
 }
 
+TEST_F(GenericFamilyTest, ExpiryIndex) {
+  absl::FlagSaver fs;
+  SetTestFlag("expiry_index", "true");
+  ResetService();
+
+  for (unsigned i = 0; i < 100; ++i) {
+    Run({"set", StrCat("key", i), "val", "PX", i % 2 ? "1000" : "5000"});
+  }
+  // Updating or removing an expiry and deleting a key replace their entries.
+  for (unsigned i = 0; i < 10; ++i) {
+    Run({"pexpire", "key1", StrCat(1000 + i * 1000)});
+  }
+  Run({"pexpire", "key1", "10000"});
+  Run({"persist", "key3"});
+  Run({"del", "key5"});
+  EXPECT_EQ(98u, GetMetrics().expiry_index_entries);
+  Run({"set", "key5", "val", "PX", "1000"});
+  Run({"pexpire", "key3", "1000"});
+  EXPECT_EQ(100u, GetMetrics().expiry_index_entries);
+
+  auto expire_step = [] {
+    shard_set->RunBriefInParallel([](EngineShard* shard) {
+      shard->db_slice().DeleteExpiredIndexStep(DbContext{0, TEST_current_time_ms}, 1000);
+    });
+  };
+
+  AdvanceTime(2000);
+  expire_step();
+  EXPECT_EQ(51, CheckedInt({"dbsize"}));
+  EXPECT_EQ(51u, GetMetrics().expiry_index_entries);
+  EXPECT_EQ(Run({"get", "key1"}), "val");
+
+  AdvanceTime(10000);
+  expire_step();
+  EXPECT_EQ(0, CheckedInt({"dbsize"}));
+  EXPECT_EQ(0u, GetMetrics().expiry_index_entries);
+}
+
 TEST_F(GenericFamilyTest, ExpireOptions) {
   // NX and XX are mutually exclusive
   Run({"set", "key", "val"});
@@ -251,6 +292,42 @@ TEST_F(GenericFamilyTest, RenameNonString) {
   EXPECT_EQ(1, CheckedInt({"del", "b"}));
 }
 
+TEST_F(GenericFamilyTest, RenameGrowingZset) {
+  ASSERT_NE(Shard("x", shard_set->size()), Shard("b", shard_set->size()));
+
+  auto is_growing = [this](string_view key) {
+    return pp_->at(Shard(key, shard_set->size()))->AwaitBrief([key] {
+      auto& db_slice = EngineShard::tlocal()->db_slice();
+      auto res = db_slice.FindReadOnly(DbContext{0, TEST_current_time_ms}, key, OBJ_ZSET);
+      CHECK(res);
+      auto* zs = static_cast<detail::SortedMap*>((*res)->second.RObjPtr());
+      return zs->members()->IsRehashing();
+    });
+  };
+
+  // Add members until the member index of the skiplist zset grows.
+  unsigned num_members = 0;
+  do {
+    vector<string> cmd{"zadd", "x"};
+    for (unsigned i = 0; i < 64; ++i, ++num_members) {
+      cmd.push_back(absl::StrCat(num_members));
+      cmd.push_back(absl::StrCat("m", num_members));
+    }
+    Run(absl::MakeSpan(cmd));
+  } while (num_members < 256 || !is_growing("x"));
+
+  ASSERT_EQ(Run({"rename", "x", "b"}), "OK");
+
+  // The growth completes on the thread of the destination.
+  shard_set->RunBriefInParallel([](EngineShard*) { DenseSet::RehashStepAll(SIZE_MAX); });
+  EXPECT_FALSE(is_growing("b"));
+  EXPECT_THAT(Run({"zcard", "b"}), IntArg(num_members));
+  EXPECT_EQ(Run({"zscore", "b", "m100"}), "100");
+
+  EXPECT_EQ(1, CheckedInt({"del", "b"}));
+  shard_set->RunBriefInParallel([](EngineShard*) { DenseSet::RehashStepAll(SIZE_MAX); });
+}
+
 TEST_F(GenericFamilyTest, RenameBinary) {
   const char kKey1[] = "\x01\x02\x03\x04";
   const char kKey2[] = "\x05\x06\x07\x08";
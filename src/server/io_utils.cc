@@ -44,6 +44,15 @@ error_code BufferedStreamerBase::ConsumeIntoSink(io::Sink* dest) {
       break;
     }
 
+    // Give the producer a chance to fill the buffer. Data written before finalization is still
+    // flushed.
+    if (batch_delay_.count() > 0 && !IsStalled()) {
+      auto deadline = std::chrono::steady_clock::now() + batch_delay_;
+      waker_.await_until([this]() { return IsStalled() || IsStopped(); }, deadline);
+      if (cll_->IsCancelled())
+        break;
+    }
+
     // Swap producer and consumer buffers
     std::swap(producer_buf_, consumer_buf_);
     buffered_ = 0;
@@ -2,6 +2,8 @@
 // See LICENSE for licensing terms.
 //
 
+#include <chrono>
+
 #include "base/io_buf.h"
 #include "core/fibers.h"
 #include "io/io.h"
@@ -55,6 +57,8 @@ class BufferedStreamerBase : public io::Sink {
   void Finalize();
 
   // Consume whole stream to sink from the consumer fiber. Unblocks when cancelled or finalized.
+  // With a batch delay, the consumer waits up to the delay after being woken up for the
+  // producer to stall, so that small writes are merged into a single write to dest.
   std::error_code ConsumeIntoSink(io::Sink* dest);
 
   // Whether the consumer is not keeping up.
@@ -73,6 +77,8 @@ class BufferedStreamerBase : public io::Sink {
   unsigned max_buffered_cnt_;  // Max buffered entries before stall
   unsigned max_buffered_mem_;  // Max buffered mem before stall
 
+  std::chrono::microseconds batch_delay_{0};  // Max time to accumulate data before writing
+
   base::IoBuf producer_buf_, consumer_buf_;  // Two buffers that are swapped in turns.
 };
 
@@ -134,6 +134,49 @@ TEST(Journal, WriteRead) {
   }
 }
 
+// Test that LZ4 packed batches are unpacked transparently, also when mixed with plain entries.
+TEST(Journal, PackedBatch) {
+  StoredSlices slices{};
+  auto slice = [v = &slices](auto... ss) { return StoreSlice(v, ss...); };
+
+  std::vector<journal::Entry> test_entries;
+  for (unsigned i = 0; i < 100; i++) {
+    test_entries.push_back({i, journal::Op::COMMAND, DbIndex(i % 3), 1, nullopt,
+                            make_pair("SET", slice("key", "some value that repeats"))});
+  }
+
+  // Pack the first half of the entries, followed by the other half as plain entries.
+  base::IoBuf batch;
+  io::BufSink batch_sink{&batch};
+  JournalWriter batch_writer{&batch_sink};
+  for (unsigned i = 0; i < 50; i++) {
+    batch_writer.Write(test_entries[i]);
+  }
+
+  base::IoBuf buf;
+  ASSERT_TRUE(PackJournalBatch(batch.InputBuffer(), &buf));
+  EXPECT_LT(buf.InputLen(), batch.InputLen());
+
+  io::BufSink sink{&buf};
+  JournalWriter writer{&sink};
+  for (unsigned i = 50; i < test_entries.size(); i++) {
+    writer.Write(test_entries[i]);
+  }
+
+  io::BufSource source{&buf};
+  JournalReader reader{&source, 0};
+
+  for (auto& expected : test_entries) {
+    auto res = reader.ReadEntry();
+    ASSERT_TRUE(res.has_value());
+
+    ASSERT_EQ(expected.opcode, res->opcode);
+    ASSERT_EQ(expected.txid, res->txid);
+    ASSERT_EQ(expected.dbid, res->dbid);
+    ASSERT_EQ(ExtractPayload(expected), ExtractPayload(*res));
+  }
+}
+
 }  // namespace dfly
 
 // TODO: extend test.
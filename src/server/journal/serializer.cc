@@ -4,6 +4,8 @@
 
 #include "server/journal/serializer.h"
 
+#include <lz4.h>
+
 #include <system_error>
 
 #include "base/io_buf.h"
@@ -21,6 +23,13 @@ using namespace std;
 
 namespace dfly {
 
+namespace {
+
+// Upper bound for the unpacked size of LZ4_BATCH records, protects against corrupted input.
+constexpr size_t kMaxPackedBatchSize = 64_MB;
+
+}  // namespace
+
 JournalWriter::JournalWriter(io::Sink* sink) : sink_{sink} {
 }
 
@@ -144,6 +153,36 @@ template io::Result<uint16_t> JournalReader::ReadUInt<uint16_t>();
 template io::Result<uint32_t> JournalReader::ReadUInt<uint32_t>();
 template io::Result<uint64_t> JournalReader::ReadUInt<uint64_t>();
 
+bool PackJournalBatch(io::Bytes entries, base::IoBuf* dest) {
+  if (entries.empty() || entries.size() > kMaxPackedBatchSize)
+    return false;
+
+  uint8_t header[1 + 2 * 10];
+  header[0] = uint8_t(journal::Op::LZ4_BATCH);
+  unsigned header_len = 1 + WritePackedUInt(entries.size(), io::MutableBytes{header}.subspan(1));
+
+  int bound = LZ4_compressBound(entries.size());
+  // Reserve the worst case for the compressed size, the actual one is written after compression.
+  size_t max_len = header_len + 9 + bound;
+  dest->EnsureCapacity(max_len);
+  auto out = dest->AppendBuffer();
+
+  int packed = LZ4_compress_default(reinterpret_cast<const char*>(entries.data()),
+                                    reinterpret_cast<char*>(out.data()) + max_len - bound,
+                                    entries.size(), bound);
+  if (packed <= 0)
+    return false;
+
+  header_len += WritePackedUInt(packed, io::MutableBytes{header}.subspan(header_len));
+  if (header_len + packed >= entries.size())
+    return false;
+
+  memcpy(out.data(), header, header_len);
+  memmove(out.data() + header_len, out.data() + max_len - bound, packed);
+  dest->CommitWrite(header_len + packed);
+  return true;
+}
+
 io::Result<size_t> JournalReader::ReadString(MutableSlice buffer) {
   size_t size = 0;
   SET_OR_UNEXPECT(ReadUInt<uint64_t>(), size);
@@ -181,6 +220,34 @@ std::error_code JournalReader::ReadCommand(journal::ParsedEntry::CmdData* data)
   return std::error_code{};
 }
 
+std::error_code JournalReader::ReadPackedBatch() {
+  size_t raw_size = 0, packed_size = 0;
+  SET_OR_RETURN(ReadUInt<uint64_t>(), raw_size);
+  SET_OR_RETURN(ReadUInt<uint64_t>(), packed_size);
+
+  if (raw_size == 0 || raw_size > kMaxPackedBatchSize ||
+      packed_size > size_t(LZ4_compressBound(raw_size)))
+    return make_error_code(errc::bad_message);
+
+  if (auto ec = EnsureRead(packed_size); ec)
+    return ec;
+
+  // Entries that follow the batch might be already buffered, so they are placed after the
+  // unpacked ones.
+  base::IoBuf unpacked{raw_size + buf_.InputLen() - packed_size};
+  auto dest = unpacked.AppendBuffer();
+  int res = LZ4_decompress_safe(reinterpret_cast<const char*>(buf_.InputBuffer().data()),
+                                reinterpret_cast<char*>(dest.data()), packed_size, raw_size);
+  if (res < 0 || size_t(res) != raw_size)
+    return make_error_code(errc::bad_message);
+
+  unpacked.CommitWrite(raw_size);
+  buf_.ConsumeInput(packed_size);
+  unpacked.WriteAndCommit(buf_.InputBuffer().data(), buf_.InputLen());
+  buf_ = std::move(unpacked);
+  return {};
+}
+
 io::Result<journal::ParsedEntry> JournalReader::ReadEntry() {
   uint8_t int_op;
   SET_OR_UNEXPECT(ReadUInt<uint8_t>(), int_op);
@@ -191,6 +258,12 @@ io::Result<journal::ParsedEntry> JournalReader::ReadEntry() {
     return ReadEntry();
   }
 
+  if (opcode == journal::Op::LZ4_BATCH) {
+    if (auto ec = ReadPackedBatch(); ec)
+      return make_unexpected(ec);
+    return ReadEntry();
+  }
+
   journal::ParsedEntry entry;
   entry.dbid = dbid_;
   entry.opcode = opcode;
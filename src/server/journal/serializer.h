@@ -37,6 +37,11 @@ class JournalWriter {
   std::optional<DbIndex> cur_dbid_{};
 };
 
+// Packs a batch of serialized journal entries into a single LZ4 compressed LZ4_BATCH record that
+// JournalReader unpacks transparently. The batch must consist of whole entries.
+// Returns false and leaves dest untouched if compression does not reduce the size.
+bool PackJournalBatch(io::Bytes entries, base::IoBuf* dest);
+
 // JournalReader allows deserializing journal entries from a source.
 // Like the writer, it automatically keeps track of the database index.
 struct JournalReader {
@@ -63,6 +68,9 @@ struct JournalReader {
   // Read argument array into string buffer.
   std::error_code ReadCommand(journal::ParsedEntry::CmdData* entry);
 
+  // Decompress LZ4_BATCH record in front of the remaining input.
+  std::error_code ReadPackedBatch();
+
  private:
   io::Source* source_;
   base::IoBuf buf_;
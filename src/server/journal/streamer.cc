@@ -4,13 +4,87 @@
 
 #include "server/journal/streamer.h"
 
+#include <absl/flags/flag.h>
 #include <absl/functional/bind_front.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 
+ABSL_FLAG(uint32_t, journal_stream_batch_usec, 0,
+          "If positive, journal changes are accumulated for up to this time before being sent "
+          "to replicas and migration targets, reducing the number of socket writes.");
+ABSL_FLAG(uint32_t, journal_stream_batch_bytes, 16384,
+          "Size at which a batch of journal changes is sent without waiting for "
+          "journal_stream_batch_usec to pass.");
+ABSL_FLAG(bool, journal_stream_compression, false,
+          "Compress batches of journal changes with LZ4 when streaming to replicas.");
+
 namespace dfly {
 using namespace util;
 
+namespace {
+
+// Smaller batches are sent as is, as compression would hardly reduce their size.
+constexpr size_t kMinPackedBatch = 256;
+
+thread_local JournalStreamStats tl_stream_stats;
+
+// Sink adapter that accounts the data written by the streamer and compresses it if requested.
+// Every write must consist of whole journal entries.
+class StreamBatchSink : public io::Sink {
+ public:
+  StreamBatchSink(io::Sink* dest, bool compress) : dest_{dest}, compress_{compress} {
+  }
+
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) override;
+
+ private:
+  io::Sink* dest_;
+  bool compress_;
+  base::IoBuf packed_;
+};
+
+io::Result<size_t> StreamBatchSink::WriteSome(const iovec* v, uint32_t len) {
+  size_t total = 0;
+  for (uint32_t i = 0; i < len; ++i) {
+    io::Bytes batch{reinterpret_cast<const uint8_t*>(v[i].iov_base), v[i].iov_len};
+    io::Bytes out = batch;
+
+    packed_.Clear();
+    if (compress_ && batch.size() >= kMinPackedBatch && PackJournalBatch(batch, &packed_))
+      out = packed_.InputBuffer();
+
+    if (auto ec = dest_->Write(out); ec)
+      return nonstd::make_unexpected(ec);
+
+    tl_stream_stats.writes++;
+    tl_stream_stats.bytes_raw += batch.size();
+    tl_stream_stats.bytes_sent += out.size();
+    total += batch.size();
+  }
+  return total;
+}
+
+}  // namespace
+
+JournalStreamer::JournalStreamer(journal::Journal* journal, Context* cntx, bool allow_compression)
+    : BufferedStreamerBase{cntx->GetCancellation()}, cntx_{cntx}, journal_{journal} {
+  compress_ = allow_compression && absl::GetFlag(FLAGS_journal_stream_compression);
+
+  if (uint32_t batch_usec = absl::GetFlag(FLAGS_journal_stream_batch_usec); batch_usec > 0) {
+    batch_delay_ = std::chrono::microseconds(batch_usec);
+    // Producers stall only once a full batch is pending, otherwise they would wait for the
+    // batch delay to pass on every write.
+    max_buffered_cnt_ = UINT32_MAX;
+    max_buffered_mem_ = std::max(absl::GetFlag(FLAGS_journal_stream_batch_bytes), 512u);
+  }
+}
+
+JournalStreamStats JournalStreamer::GetThreadLocalStats() {
+  return tl_stream_stats;
+}
+
 void JournalStreamer::Start(io::Sink* dest) {
   using namespace journal;
   write_fb_ = fb2::Fiber("journal_stream", &JournalStreamer::WriterFb, this, dest);
@@ -44,17 +118,19 @@ void JournalStreamer::Cancel() {
 }
 
 void JournalStreamer::WriterFb(io::Sink* dest) {
-  if (auto ec = ConsumeIntoSink(dest); ec) {
+  StreamBatchSink sink{dest, compress_};
+  if (auto ec = ConsumeIntoSink(&sink); ec) {
     cntx_->ReportError(ec);
   }
 }
 
 RestoreStreamer::RestoreStreamer(DbSlice* slice, SlotSet slots, uint32_t sync_id,
-                                 journal::Journal* journal, Context* cntx)
+                                 uint32_t flow_id, journal::Journal* journal, Context* cntx)
     : JournalStreamer(journal, cntx),
       db_slice_(slice),
       my_slots_(std::move(slots)),
-      sync_id_(sync_id) {
+      sync_id_(sync_id),
+      flow_id_(flow_id) {
   DCHECK(slice != nullptr);
 }
 
@@ -77,6 +153,10 @@ void RestoreStreamer::Start(io::Sink* dest) {
 
       bool written = false;
       cursor = pt->Traverse(cursor, [&](PrimeTable::bucket_iterator it) {
+        // Other streams of the shard traverse the same table with earlier versions. They must
+        // serialize the bucket before we bump its version, or they would skip it.
+        if (it.GetVersion() < snapshot_version_)
+          db_slice_->FlushChangeToEarlierCallbacks(0, it, snapshot_version_);
         if (WriteBucket(it)) {
           written = true;
         }
@@ -92,9 +172,9 @@ void RestoreStreamer::Start(io::Sink* dest) {
       }
     } while (cursor);
 
-    VLOG(2) << "FULL-SYNC-CUT for " << sync_id_ << " : " << db_slice_->shard_id();
+    VLOG(2) << "FULL-SYNC-CUT for " << sync_id_ << " : " << flow_id_;
     WriteCommand(make_pair("DFLYMIGRATE", ArgSlice{"FULL-SYNC-CUT", absl::StrCat(sync_id_),
-                                                   absl::StrCat(db_slice_->shard_id())}));
+                                                   absl::StrCat(flow_id_)}));
     NotifyWritten(true);
     snapshot_finished_ = true;
   });
@@ -201,6 +281,7 @@ void RestoreStreamer::WriteEntry(string_view key, const PrimeValue& pv, uint64_t
   args.push_back("ABSTTL");  // Means expire string is since epoch
 
   WriteCommand(make_pair("RESTORE", ArgSlice{args}));
+  keys_written_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void RestoreStreamer::WriteCommand(journal::Entry::Payload cmd_payload) {
@@ -14,11 +14,11 @@ namespace dfly {
 
 // Buffered single-shard journal streamer that listens for journal changes with a
 // journal listener and writes them to a destination sink in a separate fiber.
+// Depending on flags, changes are batched over a short window and the batches are LZ4 compressed
+// if the receiver supports it.
 class JournalStreamer : protected BufferedStreamerBase {
  public:
-  JournalStreamer(journal::Journal* journal, Context* cntx)
-      : BufferedStreamerBase{cntx->GetCancellation()}, cntx_{cntx}, journal_{journal} {
-  }
+  JournalStreamer(journal::Journal* journal, Context* cntx, bool allow_compression = false);
 
   // Self referential.
   JournalStreamer(const JournalStreamer& other) = delete;
@@ -33,6 +33,8 @@ class JournalStreamer : protected BufferedStreamerBase {
 
   using BufferedStreamerBase::GetTotalBufferCapacities;
 
+  static JournalStreamStats GetThreadLocalStats();
+
  private:
   // Writer fiber that steals buffer contents and writes them to dest.
   void WriterFb(io::Sink* dest);
@@ -45,6 +47,7 @@ class JournalStreamer : protected BufferedStreamerBase {
 
   uint32_t journal_cb_id_{0};
   journal::Journal* journal_;
+  bool compress_ = false;
 
   Fiber write_fb_{};
 };
@@ -53,8 +56,9 @@ class JournalStreamer : protected BufferedStreamerBase {
 // Only handles relevant slots, while ignoring all others.
 class RestoreStreamer : public JournalStreamer {
  public:
-  RestoreStreamer(DbSlice* slice, SlotSet slots, uint32_t sync_id, journal::Journal* journal,
-                  Context* cntx);
+  // flow_id identifies the stream towards the target in the FULL-SYNC-CUT command.
+  RestoreStreamer(DbSlice* slice, SlotSet slots, uint32_t sync_id, uint32_t flow_id,
+                  journal::Journal* journal, Context* cntx);
   ~RestoreStreamer() override;
 
   void Start(io::Sink* dest) override;
@@ -67,6 +71,11 @@ class RestoreStreamer : public JournalStreamer {
     return snapshot_finished_;
   }
 
+  // Number of keys serialized so far. Thread-safe.
+  size_t GetKeysWritten() const {
+    return keys_written_.load(std::memory_order_relaxed);
+  }
+
  private:
   void OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req);
   bool ShouldWrite(const journal::JournalItem& item) const override;
@@ -82,6 +91,8 @@ class RestoreStreamer : public JournalStreamer {
   uint64_t snapshot_version_ = 0;
   SlotSet my_slots_;
   uint32_t sync_id_;
+  uint32_t flow_id_;
+  std::atomic_size_t keys_written_ = 0;
   Fiber snapshot_fb_;
   Cancellation fiber_cancellation_;
   bool snapshot_finished_ = false;
@@ -5,9 +5,15 @@
 #include "tx_executor.h"
 
 #include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
+
+#include <algorithm>
 
 #include "base/logging.h"
+#include "server/journal/executor.h"
 #include "server/journal/serializer.h"
+#include "server/main_service.h"
+#include "server/transaction.h"
 
 using namespace std;
 using namespace facade;
@@ -133,4 +139,150 @@ std::optional<TransactionData> TransactionReader::NextTxData(JournalReader* read
   return std::nullopt;
 }
 
+ParallelTxApplier::ParallelTxApplier(Service* service, unsigned num_workers,
+                                     std::function<void(uint32_t)> on_applied)
+    : service_{service}, on_applied_{std::move(on_applied)} {
+  DCHECK_GT(num_workers, 0u);
+  for (unsigned i = 0; i < num_workers; ++i)
+    executors_.push_back(make_unique<JournalExecutor>(service));
+}
+
+ParallelTxApplier::~ParallelTxApplier() {
+  Shutdown();
+}
+
+void ParallelTxApplier::Start() {
+  DCHECK(workers_.empty());
+  for (auto& executor : executors_)
+    workers_.emplace_back("replica_apply", &ParallelTxApplier::WorkerFb, this, executor.get());
+}
+
+bool ParallelTxApplier::Schedule(TransactionData&& tx_data) {
+  Task task{0, std::move(tx_data), {}, false};
+  task.exclusive = !CollectKeys(task.tx_data, &task.keys);
+
+  waker_.await([&] { return cancelled_.load(memory_order_relaxed) || CanDispatch(task); });
+  if (cancelled_.load(memory_order_relaxed))
+    return false;
+
+  for (const auto& key : task.keys)
+    ++keys_in_flight_[key];
+  ++tasks_in_flight_;
+  exclusive_in_flight_ = task.exclusive;
+
+  task.seq = window_start_ + window_.size();
+  window_.emplace_back(task.tx_data.journal_rec_count, false);
+  ready_.push_back(std::move(task));
+  waker_.notifyAll();
+  return true;
+}
+
+void ParallelTxApplier::Skip(uint32_t journal_rec_count) {
+  uint64_t seq = window_start_ + window_.size();
+  window_.emplace_back(journal_rec_count, false);
+  MarkApplied(seq);
+}
+
+void ParallelTxApplier::Drain() {
+  waker_.await([&] { return tasks_in_flight_ == 0; });
+}
+
+void ParallelTxApplier::Cancel() {
+  cancelled_.store(true, memory_order_relaxed);
+  waker_.notifyAll();
+}
+
+void ParallelTxApplier::Shutdown() {
+  shutdown_ = true;
+  waker_.notifyAll();
+  for (auto& worker : workers_)
+    worker.JoinIfNeeded();
+  workers_.clear();
+}
+
+bool ParallelTxApplier::CollectKeys(const TransactionData& tx_data,
+                                    std::vector<std::string>* keys) const {
+  for (const auto& cmd : tx_data.commands) {
+    if (cmd.cmd_args.empty())
+      return false;
+
+    // FindCmd and DetermineKeys do not modify the arguments.
+    auto& cmd_args = const_cast<CmdArgVec&>(cmd.cmd_args);
+    auto [cid, args] = service_->FindCmd(CmdArgList{cmd_args.data(), cmd_args.size()});
+    if (cid == nullptr)
+      return false;
+
+    OpResult<KeyIndex> key_index = DetermineKeys(cid, args);
+    if (!key_index || key_index->num_args() == 0)
+      return false;
+
+    for (unsigned i = key_index->start; i < key_index->end; i += key_index->step)
+      keys->emplace_back(ArgS(args, i));
+    if (key_index->bonus)
+      keys->emplace_back(ArgS(args, *key_index->bonus));
+  }
+
+  // Without multi shard sync the commands of a MULTI transaction arrive one by one and must not
+  // overtake each other, so they share a key that no other transaction uses.
+  if (tx_data.opcode == journal::Op::MULTI_COMMAND)
+    keys->push_back(absl::StrCat("\0multi:"sv, tx_data.txid));
+
+  return true;
+}
+
+bool ParallelTxApplier::CanDispatch(const Task& task) const {
+  if (exclusive_in_flight_ || tasks_in_flight_ >= workers_.size())
+    return false;
+
+  if (task.exclusive)
+    return tasks_in_flight_ == 0;
+
+  return none_of(task.keys.begin(), task.keys.end(),
+                 [this](const auto& key) { return keys_in_flight_.contains(key); });
+}
+
+void ParallelTxApplier::MarkApplied(uint64_t seq) {
+  DCHECK_GE(seq, window_start_);
+  DCHECK_LT(seq - window_start_, window_.size());
+  window_[seq - window_start_].second = true;
+
+  uint32_t applied = 0;
+  while (!window_.empty() && window_.front().second) {
+    applied += window_.front().first;
+    window_.pop_front();
+    ++window_start_;
+  }
+
+  if (applied > 0)
+    on_applied_(applied);
+}
+
+void ParallelTxApplier::WorkerFb(JournalExecutor* executor) {
+  while (true) {
+    waker_.await([&] { return !ready_.empty() || shutdown_; });
+    if (ready_.empty())
+      return;
+
+    Task task = std::move(ready_.front());
+    ready_.pop_front();
+
+    // Transactions that were dispatched are applied even if the flow was cancelled, so that the
+    // reported offset matches the applied data.
+    executor->Execute(task.tx_data.dbid, absl::MakeSpan(task.tx_data.commands));
+
+    for (const auto& key : task.keys) {
+      auto it = keys_in_flight_.find(key);
+      DCHECK(it != keys_in_flight_.end());
+      if (--it->second == 0)
+        keys_in_flight_.erase(it);
+    }
+    --tasks_in_flight_;
+    if (task.exclusive)
+      exclusive_in_flight_ = false;
+
+    MarkApplied(task.seq);
+    waker_.notifyAll();
+  }
+}
+
 }  // namespace dfly
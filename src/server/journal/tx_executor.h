@@ -3,13 +3,21 @@
 //
 #pragma once
 
+#include <absl/container/flat_hash_map.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
+#include "core/fibers.h"
 #include "server/common.h"
 #include "server/journal/types.h"
 
 namespace dfly {
 
+class JournalExecutor;
+class Service;
 struct JournalReader;
 
 // Coordinator for multi shard execution.
@@ -67,4 +75,77 @@ struct TransactionReader {
   bool accumulate_multi_ = false;
 };
 
+// Applies the single shard transactions of a replication flow on several fibers.
+// Transactions run concurrently as long as their keys do not intersect with the keys of the
+// transactions in flight. A transaction that touches a key in flight is held back, together
+// with all the transactions after it, until the conflicting ones complete. This preserves the
+// order of changes per key, while commands of a MULTI transaction are applied in order.
+// Transactions with keys that can not be determined act as barriers and run alone.
+class ParallelTxApplier {
+ public:
+  // `on_applied` is called with the journal record counts of applied transactions in the order
+  // they were scheduled, so that the flow offset never skips over a pending transaction.
+  ParallelTxApplier(Service* service, unsigned num_workers,
+                    std::function<void(uint32_t)> on_applied);
+  ~ParallelTxApplier();
+
+  // Launches the worker fibers in the calling thread.
+  void Start();
+
+  // Schedules the transaction for execution. Blocks while it conflicts with transactions in
+  // flight or all the workers are busy. Returns false if the applier was cancelled.
+  bool Schedule(TransactionData&& tx_data);
+
+  // Accounts for journal records that do not require execution, like PING or EXEC.
+  void Skip(uint32_t journal_rec_count);
+
+  // Waits until all the scheduled transactions are applied.
+  void Drain();
+
+  // Rejects further scheduling and wakes up blocked callers. Thread-safe.
+  void Cancel();
+
+  // Applies the transactions already scheduled and joins the workers.
+  void Shutdown();
+
+ private:
+  struct Task {
+    uint64_t seq;
+    TransactionData tx_data;
+    std::vector<std::string> keys;
+    bool exclusive;
+  };
+
+  // Fills keys with the keys touched by the transaction. Returns false if they can not be
+  // determined.
+  bool CollectKeys(const TransactionData& tx_data, std::vector<std::string>* keys) const;
+
+  bool CanDispatch(const Task& task) const;
+
+  // Registers the transaction `seq` as applied and reports the completed prefix.
+  void MarkApplied(uint64_t seq);
+
+  void WorkerFb(JournalExecutor* executor);
+
+  Service* service_;
+  std::function<void(uint32_t)> on_applied_;
+
+  std::vector<std::unique_ptr<JournalExecutor>> executors_;
+  std::vector<Fiber> workers_;
+
+  std::deque<Task> ready_;
+  absl::flat_hash_map<std::string, unsigned> keys_in_flight_;
+  unsigned tasks_in_flight_ = 0;
+  bool exclusive_in_flight_ = false;
+  bool shutdown_ = false;
+  std::atomic_bool cancelled_ = false;
+
+  // Journal record counts and applied state of the transactions that were not reported yet,
+  // indexed by seq - window_start_.
+  std::deque<std::pair<uint32_t, bool>> window_;
+  uint64_t window_start_ = 0;
+
+  util::fb2::EventCount waker_;
+};
+
 }  // namespace dfly
@@ -22,7 +22,8 @@ enum class Op : uint8_t {
   MULTI_COMMAND = 11,
   EXEC = 12,
   PING = 13,
-  FIN = 14
+  FIN = 14,
+  LZ4_BATCH = 15  // Compressed batch of entries, unpacked by JournalReader.
 };
 
 struct EntryBase {
@@ -4,16 +4,18 @@
 
 #include "server/json_family.h"
 
+#include <absl/cleanup/cleanup.h>
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_join.h>
 #include <absl/strings/str_split.h>
 #include <flatbuffers/flexbuffers.h>
-#include <flatbuffers/idl.h>
 
 #include <jsoncons/json.hpp>
 #include <jsoncons_ext/jsonpatch/jsonpatch.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath.hpp>
 #include <jsoncons_ext/jsonpointer/jsonpointer.hpp>
+#include <list>
 
 #include "base/flags.h"
 #include "base/logging.h"
@@ -26,12 +28,12 @@
 #include "server/error.h"
 #include "server/journal/journal.h"
 #include "server/search/doc_index.h"
-#include "server/string_family.h"
 #include "server/tiered_storage.h"
 #include "server/transaction.h"
 
 ABSL_FLAG(bool, jsonpathv2, false, "If true uses Dragonfly jsonpath implementation.");
-ABSL_FLAG(bool, experimental_flat_json, false, "If true uses flat json implementation.");
+ABSL_FLAG(bool, experimental_flat_json, false,
+          "If true, json objects are stored as flexbuffers instead of jsoncons trees.");
 
 namespace dfly {
 
@@ -80,6 +82,46 @@ inline OpStatus JsonReplaceVerifyNoOp(JsonType&) {
   return OpStatus::OK;
 }
 
+// Stores value in the flat encoding if it is enabled and can represent the value.
+// Returns false if the value should be stored in the jsoncons encoding.
+bool SetFlatJson(const JsonType& value, PrimeValue* pv) {
+  if (!absl::GetFlag(FLAGS_experimental_flat_json))
+    return false;
+
+  flexbuffers::Builder fbb;
+  if (!JsonToFlex(value, &fbb))
+    return false;
+
+  fbb.Finish();
+  const auto& buffer = fbb.GetBuffer();
+  pv->SetJson(buffer.data(), buffer.size());
+  return true;
+}
+
+// Returns the json object of the value. Objects in the flat encoding are fully decoded into a
+// thread-local object that is valid until the next call.
+JsonType* ReadJson(const PrimeValue& pv) {
+  if (pv.JsonEncoding() == kEncodingJsonCons)
+    return pv.GetJson();
+
+  thread_local JsonType flat_json;
+  flat_json = JsonFromFlat(pv.GetFlatJson(), PMR_NS::get_default_resource());
+  return &flat_json;
+}
+
+// Returns the json object of the value for modification. Objects in the flat encoding are
+// converted to the jsoncons encoding, FinishJsonUpdate converts them back.
+JsonType* GetMutableJson(PrimeValue* pv) {
+  if (pv->JsonEncoding() == kEncodingJsonFlat) {
+    pv->SetJson(JsonFromFlat(pv->GetFlatJson(), CompactObj::memory_resource()));
+  }
+  return pv->GetJson();
+}
+
+void FinishJsonUpdate(PrimeValue* pv) {
+  SetFlatJson(*pv->GetJson(), pv);
+}
+
 facade::OpStatus SetJson(const OpArgs& op_args, string_view key, JsonType&& value) {
   auto& db_slice = op_args.shard->db_slice();
 
@@ -90,7 +132,7 @@ facade::OpStatus SetJson(const OpArgs& op_args, string_view key, JsonType&& valu
 
   op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, res.it->second);
 
-  res.it->second.SetJson(std::move(value));
+  JsonFamily::SetJsonObject(std::move(value), &res.it->second);
 
   op_args.shard->search_indices()->AddDoc(key, op_args.db_cntx, res.it->second);
   return OpStatus::OK;
@@ -191,26 +233,28 @@ OpStatus UpdateEntry(const OpArgs& op_args, std::string_view key, std::string_vi
     return it_res.status();
   }
 
-  PrimeConstIterator entry_it = it_res->it;
-  JsonType* json_val = entry_it->second.GetJson();
+  PrimeValue& pv = it_res->it->second;
+  op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, pv);
+
+  JsonType* json_val = GetMutableJson(&pv);
   DCHECK(json_val) << "should have a valid JSON object for key '" << key << "' the type for it is '"
-                   << entry_it->second.ObjType() << "'";
+                   << pv.ObjType() << "'";
   JsonType& json_entry = *json_val;
 
-  op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, entry_it->second);
-
   // Run the update operation on this entry
   error_code ec = JsonReplace(json_entry, path, callback);
   if (ec) {
     VLOG(1) << "Failed to evaluate expression on json with error: " << ec.message();
+    FinishJsonUpdate(&pv);
     return OpStatus::SYNTAX_ERR;
   }
 
   // Make sure that we don't have other internal issue with the operation
   OpStatus res = verify_op(json_entry);
+  FinishJsonUpdate(&pv);
   if (res == OpStatus::OK) {
     it_res->post_updater.Run();
-    op_args.shard->search_indices()->AddDoc(key, op_args.db_cntx, entry_it->second);
+    op_args.shard->search_indices()->AddDoc(key, op_args.db_cntx, pv);
   }
 
   return res;
@@ -227,25 +271,14 @@ OpStatus UpdateEntry(const OpArgs& op_args, string_view key, const json::Path& p
   PrimeValue& pv = it_res->it->second;
 
   op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, pv);
-  json::MutatePath(path, std::move(cb), pv.GetJson());
+  json::MutatePath(path, std::move(cb), GetMutableJson(&pv));
+  FinishJsonUpdate(&pv);
   it_res->post_updater.Run();
   op_args.shard->search_indices()->AddDoc(key, op_args.db_cntx, pv);
 
   return OpStatus::OK;
 }
 
-OpResult<JsonType*> GetJson(const OpArgs& op_args, string_view key) {
-  OpResult<PrimeConstIterator> it_res =
-      op_args.shard->db_slice().FindReadOnly(op_args.db_cntx, key, OBJ_JSON);
-  if (!it_res.ok())
-    return it_res.status();
-
-  JsonType* json_val = it_res.value()->second.GetJson();
-  DCHECK(json_val) << "should have a valid JSON object for key " << key;
-
-  return json_val;
-}
-
 // Returns the index of the next right bracket
 optional<size_t> GetNextIndex(string_view str) {
   size_t current_idx = 0;
@@ -447,20 +480,221 @@ void SendJsonValue(RedisReplyBuilder* rb, const JsonType& j) {
   }
 }
 
+// Returns the path if it is a jsonpathv2 path of object keys and array indices only, or null.
+// jsoncons expressions are not served from the flat encoding, since they differ in semantics,
+// e.g. for `$.arr.length`.
+const json::Path* AsFlatPath(const JsonPathV2& expr) {
+  const auto* path = get_if<json::Path>(&expr);
+  if (!path)
+    return nullptr;
+
+  for (const auto& segment : *path) {
+    if (segment.type() == json::SegmentType::INDEX)
+      continue;
+    // Keys of the flat encoding are null terminated.
+    if (segment.type() != json::SegmentType::IDENTIFIER ||
+        segment.identifier().find('\0') != string::npos)
+      return nullptr;
+  }
+  return path;
+}
+
+optional<json::Path> GetSimplePath(const JsonPathV2& expr) {
+  if (const json::Path* path = AsFlatPath(expr))
+    return *path;
+  return nullopt;
+}
+
+io::Result<JsonPathV2, string> ParsePathV2(string_view path, bool v2) {
+  if (v2) {
+    return json::ParsePath(path);
+  }
+  io::Result<JsonExpression> expr_result = ParseJsonPath(path);
+  if (!expr_result) {
+    return nonstd::make_unexpected(kSyntaxErr);
+  }
+  return JsonPathV2(std::move(expr_result.value()));
+}
+
+// A parsed path together with its simple form, if it has one.
+struct CompiledPath {
+  JsonPathV2 expr;
+  optional<json::Path> simple;
+};
+
+using CompiledPathPtr = shared_ptr<const CompiledPath>;
+
+// LRU cache of compiled paths keyed by the path string. Workloads usually reuse a small set of
+// paths, so most commands skip parsing. Entries are shared with the commands that use them,
+// hence eviction does not invalidate paths in flight.
+class PathCache {
+ public:
+  static constexpr size_t kCapacity = 256;
+
+  CompiledPathPtr Get(string_view path) {
+    auto it = index_.find(path);
+    if (it == index_.end())
+      return nullptr;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+  }
+
+  void Put(string_view path, CompiledPathPtr compiled) {
+    DCHECK(!index_.contains(path));
+    if (entries_.size() >= kCapacity) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(string(path), std::move(compiled));
+    index_.emplace(entries_.front().first, entries_.begin());
+  }
+
+ private:
+  using Entry = pair<string, CompiledPathPtr>;
+
+  list<Entry> entries_;
+  absl::flat_hash_map<string_view, list<Entry>::iterator> index_;  // points into entries_
+};
+
+// Aggregation functions accumulate their result inside the path, so it can not be shared.
+bool IsAggregation(const JsonPathV2& expr) {
+  const auto* parsed = get_if<json::Path>(&expr);
+  return parsed && !parsed->empty() && parsed->front().type() == json::SegmentType::FUNCTION;
+}
+
+io::Result<CompiledPathPtr, string> CompilePath(string_view path) {
+  // Both parsers are kept apart since the flag can be changed at runtime.
+  thread_local PathCache caches[2];
+
+  bool v2 = absl::GetFlag(FLAGS_jsonpathv2);
+  PathCache& cache = caches[v2];
+  if (CompiledPathPtr res = cache.Get(path))
+    return res;
+
+  auto expr = ParsePathV2(path, v2);
+  if (!expr)
+    return nonstd::make_unexpected(expr.error());
+
+  optional<json::Path> simple = GetSimplePath(*expr);
+  auto res = make_shared<CompiledPath>(CompiledPath{std::move(*expr), std::move(simple)});
+
+  if (!IsAggregation(res->expr))
+    cache.Put(path, res);
+  return res;
+}
+
+// Follows a path of object keys and array indices in the flat encoding.
+// Returns false if the path does not exist.
+bool FindFlat(const json::Path& path, flexbuffers::Reference* ref) {
+  for (const auto& segment : path) {
+    if (segment.type() == json::SegmentType::INDEX) {
+      if (ref->GetType() != flexbuffers::FBT_VECTOR)
+        return false;
+      auto vec = ref->AsVector();
+      if (segment.index() >= vec.size())
+        return false;
+      *ref = vec[segment.index()];
+      continue;
+    }
+
+    if (!ref->IsMap())
+      return false;
+
+    // The keys of a flexbuffer map are sorted, so it is a binary search.
+    auto map = ref->AsMap();
+    auto keys = map.Keys();
+    const char* key = segment.identifier().c_str();
+    size_t lo = 0, hi = keys.size();
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (strcmp(keys[mid].AsKey(), key) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == keys.size() || strcmp(keys[lo].AsKey(), key) != 0)
+      return false;
+    *ref = map.Values()[lo];
+  }
+  return true;
+}
+
+// Evaluates JSON.GET expressions directly on the flat encoding, so only the matched values are
+// decoded. Returns nullopt if some expression is not a simple path.
+optional<vector<JsonType>> EvaluateFlat(
+    string_view flat, const vector<pair<string_view, CompiledPathPtr>>& expressions) {
+  for (const auto& [expr_str, expr] : expressions) {
+    if (expr && !expr->simple)
+      return nullopt;
+  }
+
+  auto* mr = PMR_NS::get_default_resource();
+  auto root = flexbuffers::GetRoot(reinterpret_cast<const uint8_t*>(flat.data()), flat.size());
+  vector<JsonType> res;
+  res.reserve(expressions.size());
+  for (const auto& [expr_str, expr] : expressions) {
+    if (!expr) {  // legacy root path
+      res.push_back(JsonFromFlex(root, mr));
+      continue;
+    }
+
+    JsonType& arr = res.emplace_back(json_array_arg);
+    flexbuffers::Reference ref = root;
+    if (FindFlat(*expr->simple, &ref)) {
+      arr.push_back(JsonFromFlex(ref, mr));
+    }
+  }
+  return res;
+}
+
+// Evaluates the expression on the json value of the key. Documents in the flat encoding are
+// decoded only at the matched value if the expression is a simple path, and fully otherwise.
+OpStatus EvaluateReadOnly(const OpArgs& op_args, string_view key, const JsonPathV2& expression,
+                          ExprCallback cb) {
+  OpResult<PrimeConstIterator> it_res =
+      op_args.shard->db_slice().FindReadOnly(op_args.db_cntx, key, OBJ_JSON);
+  if (!it_res.ok())
+    return it_res.status();
+
+  const PrimeValue& pv = it_res.value()->second;
+  const json::Path* path = AsFlatPath(expression);
+  if (pv.JsonEncoding() == kEncodingJsonFlat && path) {
+    string_view flat = pv.GetFlatJson();
+    auto ref = flexbuffers::GetRoot(reinterpret_cast<const uint8_t*>(flat.data()), flat.size());
+    if (FindFlat(*path, &ref)) {
+      string_view last_key;
+      if (!path->empty() && path->back().type() == json::SegmentType::IDENTIFIER)
+        last_key = path->back().identifier();
+      cb(last_key, JsonFromFlex(ref, PMR_NS::get_default_resource()));
+    }
+    return OpStatus::OK;
+  }
+
+  const JsonType* json_entry = ReadJson(pv);
+  visit([&](auto&& arg) { Evaluate(arg, *json_entry, cb); }, expression);
+  return OpStatus::OK;
+}
+
 OpResult<string> OpJsonGet(const OpArgs& op_args, string_view key,
-                           const vector<pair<string_view, optional<JsonPathV2>>>& expressions,
+                           const vector<pair<string_view, CompiledPathPtr>>& expressions,
                            bool should_format, const OptString& indent, const OptString& new_line,
                            const OptString& space) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
+  OpResult<PrimeConstIterator> it_res =
+      op_args.shard->db_slice().FindReadOnly(op_args.db_cntx, key, OBJ_JSON);
+  if (!it_res.ok())
+    return it_res.status();
+
+  const PrimeValue& pv = it_res.value()->second;
+  optional<vector<JsonType>> flat_res;
+  if (pv.JsonEncoding() == kEncodingJsonFlat && !expressions.empty()) {
+    flat_res = EvaluateFlat(pv.GetFlatJson(), expressions);
   }
 
-  const JsonType& json_entry = *(result.value());
+  const JsonType* json_entry = flat_res ? nullptr : ReadJson(pv);
   if (expressions.empty()) {
     // this implicitly means that we're using $ which
     // means we just brings all values
-    return json_entry.to_string();
+    return json_entry->to_string();
   }
 
   json_options options;
@@ -486,16 +720,21 @@ OpResult<string> OpJsonGet(const OpArgs& op_args, string_view key,
     }
   }
 
-  auto eval_wrapped = [&json_entry](const optional<JsonPathV2>& expr) -> JsonType {
-    return expr ? visit([&](auto& arg) { return Evaluate(arg, json_entry); }, *expr) : json_entry;
+  auto eval_wrapped = [&](size_t i) -> JsonType {
+    if (flat_res)
+      return std::move((*flat_res)[i]);
+
+    const auto& expr = expressions[i].second;
+    return expr ? visit([&](auto& arg) { return Evaluate(arg, *json_entry); }, expr->expr)
+                : *json_entry;
   };
 
   JsonType out{json_object_arg};  // see https://github.com/danielaparker/jsoncons/issues/482
   if (expressions.size() == 1) {
-    out = eval_wrapped(expressions[0].second);
+    out = eval_wrapped(0);
   } else {
-    for (const auto& [expr_str, expr] : expressions) {
-      out[expr_str] = eval_wrapped(expr);
+    for (size_t i = 0; i < expressions.size(); ++i) {
+      out[expressions[i].first] = eval_wrapped(i);
     }
   }
 
@@ -509,28 +748,22 @@ OpResult<string> OpJsonGet(const OpArgs& op_args, string_view key,
   return out.as<string>();
 }
 
-OpResult<vector<string>> OpType(const OpArgs& op_args, string_view key, JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
-  const JsonType& json_entry = *(result.value());
+OpResult<vector<string>> OpType(const OpArgs& op_args, string_view key,
+                                const JsonPathV2& expression) {
   vector<string> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) {
     vec.emplace_back(JsonTypeToName(val));
   };
 
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
-OpResult<vector<OptSizeT>> OpStrLen(const OpArgs& op_args, string_view key, JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-  const JsonType& json_entry = *(result.value());
+OpResult<vector<OptSizeT>> OpStrLen(const OpArgs& op_args, string_view key,
+                                    const JsonPathV2& expression) {
   vector<OptSizeT> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) {
     if (val.is_string()) {
@@ -540,17 +773,15 @@ OpResult<vector<OptSizeT>> OpStrLen(const OpArgs& op_args, string_view key, Json
     }
   };
 
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
-OpResult<vector<OptSizeT>> OpObjLen(const OpArgs& op_args, string_view key, JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
-  const JsonType& json_entry = *(result.value());
+OpResult<vector<OptSizeT>> OpObjLen(const OpArgs& op_args, string_view key,
+                                    const JsonPathV2& expression) {
   vector<OptSizeT> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) {
     if (val.is_object()) {
@@ -560,17 +791,15 @@ OpResult<vector<OptSizeT>> OpObjLen(const OpArgs& op_args, string_view key, Json
     }
   };
 
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
-OpResult<vector<OptSizeT>> OpArrLen(const OpArgs& op_args, string_view key, JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
-  const JsonType& json_entry = *(result.value());
+OpResult<vector<OptSizeT>> OpArrLen(const OpArgs& op_args, string_view key,
+                                    const JsonPathV2& expression) {
   vector<OptSizeT> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) {
     if (val.is_array()) {
@@ -580,12 +809,15 @@ OpResult<vector<OptSizeT>> OpArrLen(const OpArgs& op_args, string_view key, Json
     }
   };
 
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
 OpResult<vector<OptBool>> OpToggle(const OpArgs& op_args, string_view key, string_view path,
-                                   JsonPathV2 expression) {
+                                   const JsonPathV2& expression) {
   vector<OptBool> vec;
   OpStatus status;
   if (std::holds_alternative<json::Path>(expression)) {
@@ -671,8 +903,8 @@ OpResult<long> OpDel(const OpArgs& op_args, string_view key, string_view path) {
     return total_deletions;
   }
 
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
+  auto it_res = op_args.shard->db_slice().FindMutable(op_args.db_cntx, key, OBJ_JSON);
+  if (!it_res) {
     return total_deletions;
   }
 
@@ -681,7 +913,9 @@ OpResult<long> OpDel(const OpArgs& op_args, string_view key, string_view path) {
     deletion_items.emplace_back(jsonpath::to_string(path));
   };
 
-  JsonType& json_entry = *(result.value());
+  PrimeValue& pv = it_res->it->second;
+  JsonType& json_entry = *GetMutableJson(&pv);
+  absl::Cleanup finish_update = [&] { FinishJsonUpdate(&pv); };
   error_code ec = JsonReplace(json_entry, path, cb);
   if (ec) {
     VLOG(1) << "Failed to evaluate expression on json with error: " << ec.message();
@@ -714,12 +948,7 @@ OpResult<long> OpDel(const OpArgs& op_args, string_view key, string_view path) {
 // Returns a vector of string vectors,
 // keys within the same object are stored in the same string vector.
 OpResult<vector<StringVec>> OpObjKeys(const OpArgs& op_args, string_view key,
-                                      JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
+                                      const JsonPathV2& expression) {
   vector<StringVec> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) {
     // Aligned with ElastiCache flavor.
@@ -735,8 +964,10 @@ OpResult<vector<StringVec>> OpObjKeys(const OpArgs& op_args, string_view key,
       current_object.emplace_back(member.key());
     }
   };
-  JsonType& json_entry = *(result.value());
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
 
   return vec;
 }
@@ -830,7 +1061,7 @@ void ArrayPop(std::optional<std::string_view>, int index, JsonType* val,
 
 // Returns string vector that represents the pop out values.
 OpResult<vector<OptString>> OpArrPop(const OpArgs& op_args, string_view key, string_view path,
-                                     int index, JsonPathV2 expression) {
+                                     int index, const JsonPathV2& expression) {
   vector<OptString> vec;
   OpStatus status;
   if (std::holds_alternative<json::Path>(expression)) {
@@ -974,9 +1205,11 @@ OpResult<vector<OptSizeT>> OpArrAppend(const OpArgs& op_args, string_view key, s
                                        const vector<JsonType>& append_values) {
   vector<OptSizeT> vec;
 
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
+  // Only the existence is checked here, UpdateEntry decodes the value.
+  OpResult<PrimeConstIterator> it_res =
+      op_args.shard->db_slice().FindReadOnly(op_args.db_cntx, key, OBJ_JSON);
+  if (!it_res.ok()) {
+    return it_res.status();
   }
 
   auto cb = [&](const auto&, JsonType& val) {
@@ -1001,13 +1234,9 @@ OpResult<vector<OptSizeT>> OpArrAppend(const OpArgs& op_args, string_view key, s
 // Returns a numeric vector representing each JSON value first index of the JSON scalar.
 // An index value of -1 represents unfound in the array.
 // JSON scalar has types of string, boolean, null, and number.
-OpResult<vector<OptLong>> OpArrIndex(const OpArgs& op_args, string_view key, JsonPathV2 expression,
-                                     const JsonType& search_val, int start_index, int end_index) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
+OpResult<vector<OptLong>> OpArrIndex(const OpArgs& op_args, string_view key,
+                                     const JsonPathV2& expression, const JsonType& search_val,
+                                     int start_index, int end_index) {
   vector<OptLong> vec;
   auto cb = [&](const string_view& path, const JsonType& val) {
     if (!val.is_array()) {
@@ -1057,13 +1286,17 @@ OpResult<vector<OptLong>> OpArrIndex(const OpArgs& op_args, string_view key, Jso
 
     vec.emplace_back(pos);
   };
-  JsonType& json_entry = *(result.value());
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
 // Returns string vector that represents the query result of each supplied key.
-vector<OptString> OpJsonMGet(JsonPathV2 expression, const Transaction* t, EngineShard* shard) {
+// path is the source of expression.
+vector<OptString> OpJsonMGet(string_view path, const JsonPathV2& expression, const Transaction* t,
+                             EngineShard* shard) {
   auto args = t->GetShardArgs(shard->shard_id());
   DCHECK(!args.empty());
   vector<OptString> response(args.size());
@@ -1076,7 +1309,7 @@ vector<OptString> OpJsonMGet(JsonPathV2 expression, const Transaction* t, Engine
       continue;
 
     auto& dest = response[i].emplace();
-    JsonType* json_val = it_res.value()->second.GetJson();
+    JsonType* json_val = ReadJson(it_res.value()->second);
     DCHECK(json_val) << "should have a valid JSON object for key " << args[i];
 
     vector<JsonType> query_result;
@@ -1084,8 +1317,19 @@ vector<OptString> OpJsonMGet(JsonPathV2 expression, const Transaction* t, Engine
       query_result.push_back(val);
     };
 
+    // Aggregation functions accumulate across the keys they visit and are shared by the copies
+    // of a path, so every key evaluates a freshly parsed one.
+    CompiledPathPtr aggregation;
+    if (IsAggregation(expression)) {
+      auto res = CompilePath(path);
+      if (!res)
+        continue;
+      aggregation = std::move(*res);
+    }
+
     const JsonType& json_entry = *(json_val);
-    visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+    visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); },
+          aggregation ? aggregation->expr : expression);
 
     if (query_result.empty()) {
       continue;
@@ -1111,32 +1355,28 @@ vector<OptString> OpJsonMGet(JsonPathV2 expression, const Transaction* t, Engine
 }
 
 // Returns numeric vector that represents the number of fields of JSON value at each path.
-OpResult<vector<OptSizeT>> OpFields(const OpArgs& op_args, string_view key, JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
+OpResult<vector<OptSizeT>> OpFields(const OpArgs& op_args, string_view key,
+                                    const JsonPathV2& expression) {
   vector<OptSizeT> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) {
     vec.emplace_back(CountJsonFields(val));
   };
-  const JsonType& json_entry = *(result.value());
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
 // Returns json vector that represents the result of the json query.
-OpResult<vector<JsonType>> OpResp(const OpArgs& op_args, string_view key, JsonPathV2 expression) {
-  OpResult<JsonType*> result = GetJson(op_args, key);
-  if (!result) {
-    return result.status();
-  }
-
+OpResult<vector<JsonType>> OpResp(const OpArgs& op_args, string_view key,
+                                  const JsonPathV2& expression) {
   vector<JsonType> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) { vec.emplace_back(val); };
-  const JsonType& json_entry = *(result.value());
-  visit([&](auto&& arg) { Evaluate(arg, json_entry, cb); }, expression);
+  OpStatus status = EvaluateReadOnly(op_args, key, expression, cb);
+  if (status != OpStatus::OK) {
+    return status;
+  }
   return vec;
 }
 
@@ -1167,22 +1407,8 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
       }
     }
 
-    if (absl::GetFlag(FLAGS_experimental_flat_json)) {
-      flatbuffers::Parser parser;
-      flexbuffers::Builder fbb;
-      string tmp(json_str);
-      CHECK_EQ(json_str.size(), strlen(tmp.c_str()));
-
-      parser.ParseFlexBuffer(tmp.c_str(), nullptr, &fbb);
-      fbb.Finish();
-      const auto& buffer = fbb.GetBuffer();
-      string_view buf_view{reinterpret_cast<const char*>(buffer.data()), buffer.size()};
-      SetCmd scmd(op_args, false);
-      scmd.Set(SetCmd::SetParams{}, key, buf_view);
-    } else {
-      if (SetJson(op_args, key, std::move(parsed_json.value())) == OpStatus::OUT_OF_MEMORY) {
-        return OpStatus::OUT_OF_MEMORY;
-      }
+    if (SetJson(op_args, key, std::move(parsed_json.value())) == OpStatus::OUT_OF_MEMORY) {
+      return OpStatus::OUT_OF_MEMORY;
     }
     return true;
   }
@@ -1235,22 +1461,11 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
   return operation_result;
 }
 
-io::Result<JsonPathV2, string> ParsePathV2(string_view path) {
-  if (absl::GetFlag(FLAGS_jsonpathv2)) {
-    return json::ParsePath(path);
-  }
-  io::Result<JsonExpression> expr_result = ParseJsonPath(path);
-  if (!expr_result) {
-    return nonstd::make_unexpected(kSyntaxErr);
-  }
-  return JsonPathV2(std::move(expr_result.value()));
-}
-
 }  // namespace
 
 #define PARSE_PATHV2(path)             \
   ({                                   \
-    auto result = ParsePathV2(path);   \
+    auto result = CompilePath(path);   \
     if (!result) {                     \
       cntx->SendError(result.error()); \
       return;                          \
@@ -1304,10 +1519,10 @@ void JsonFamily::Resp(CmdArgList args, ConnectionContext* cntx) {
     path = ArgS(args, 1);
   }
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpResp(t->GetOpArgs(shard), key, std::move(expression));
+    return OpResp(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1351,10 +1566,10 @@ void JsonFamily::Debug(CmdArgList args, ConnectionContext* cntx) {
 
   string_view key = ArgS(args, 1);
   string_view path = ArgS(args, 2);
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return func(t->GetOpArgs(shard), key, std::move(expression));
+    return func(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1371,7 +1586,7 @@ void JsonFamily::MGet(CmdArgList args, ConnectionContext* cntx) {
   DCHECK_GE(args.size(), 1U);
 
   string_view path = ArgS(args, args.size() - 1);
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   Transaction* transaction = cntx->transaction;
   unsigned shard_count = shard_set->size();
@@ -1379,7 +1594,7 @@ void JsonFamily::MGet(CmdArgList args, ConnectionContext* cntx) {
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
     ShardId sid = shard->shard_id();
-    mget_resp[sid] = OpJsonMGet(*ParseJsonPath(path), t, shard);
+    mget_resp[sid] = OpJsonMGet(path, expression->expr, t, shard);
     return OpStatus::OK;
   };
 
@@ -1421,7 +1636,7 @@ void JsonFamily::ArrIndex(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   optional<JsonType> search_value = JsonFromString(ArgS(args, 2));
   if (!search_value) {
@@ -1453,7 +1668,7 @@ void JsonFamily::ArrIndex(CmdArgList args, ConnectionContext* cntx) {
   }
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpArrIndex(t->GetOpArgs(shard), key, std::move(expression), *search_value, start_index,
+    return OpArrIndex(t->GetOpArgs(shard), key, expression->expr, *search_value, start_index,
                       end_index);
   };
 
@@ -1576,10 +1791,10 @@ void JsonFamily::ArrPop(CmdArgList args, ConnectionContext* cntx) {
     }
   }
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpArrPop(t->GetOpArgs(shard), key, path, index, std::move(expression));
+    return OpArrPop(t->GetOpArgs(shard), key, path, index, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1644,10 +1859,10 @@ void JsonFamily::ObjKeys(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpObjKeys(t->GetOpArgs(shard), key, std::move(expression));
+    return OpObjKeys(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1737,10 +1952,10 @@ void JsonFamily::Toggle(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpToggle(t->GetOpArgs(shard), key, path, std::move(expression));
+    return OpToggle(t->GetOpArgs(shard), key, path, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1757,10 +1972,10 @@ void JsonFamily::Type(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpType(t->GetOpArgs(shard), key, std::move(expression));
+    return OpType(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1786,10 +2001,10 @@ void JsonFamily::ArrLen(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpArrLen(t->GetOpArgs(shard), key, std::move(expression));
+    return OpArrLen(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1806,10 +2021,10 @@ void JsonFamily::ObjLen(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpObjLen(t->GetOpArgs(shard), key, std::move(expression));
+    return OpObjLen(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1826,10 +2041,10 @@ void JsonFamily::StrLen(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
   string_view path = ArgS(args, 1);
 
-  JsonPathV2 expression = PARSE_PATHV2(path);
+  CompiledPathPtr expression = PARSE_PATHV2(path);
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpStrLen(t->GetOpArgs(shard), key, std::move(expression));
+    return OpStrLen(t->GetOpArgs(shard), key, expression->expr);
   };
 
   Transaction* trans = cntx->transaction;
@@ -1842,6 +2057,12 @@ void JsonFamily::StrLen(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void JsonFamily::SetJsonObject(JsonType&& value, PrimeValue* pv) {
+  if (!SetFlatJson(value, pv)) {
+    pv->SetJson(std::move(value));
+  }
+}
+
 void JsonFamily::Get(CmdArgList args, ConnectionContext* cntx) {
   DCHECK_GE(args.size(), 1U);
 
@@ -1852,8 +2073,8 @@ void JsonFamily::Get(CmdArgList args, ConnectionContext* cntx) {
   OptString new_line;
   OptString space;
 
-  // '.' corresponds to the legacy, non-array format and is passed as nullopt.
-  vector<pair<string_view, optional<JsonPathV2>>> expressions;
+  // '.' corresponds to the legacy, non-array format and is passed as null.
+  vector<pair<string_view, CompiledPathPtr>> expressions;
 
   while (parser.HasNext()) {
     if (parser.Check("SPACE").IgnoreCase().ExpectTail(1)) {
@@ -1869,12 +2090,11 @@ void JsonFamily::Get(CmdArgList args, ConnectionContext* cntx) {
       continue;
     }
 
-    optional<JsonPathV2> expr;
+    CompiledPathPtr expr;
     string_view expr_str = parser.Next();
 
     if (expr_str != ".") {
-      JsonPathV2 expression = PARSE_PATHV2(expr_str);
-      expr.emplace(std::move(expression));
+      expr = PARSE_PATHV2(expr_str);
     }
 
     expressions.emplace_back(expr_str, std::move(expr));
@@ -19,6 +19,9 @@ class JsonFamily {
  public:
   static void Register(CommandRegistry* registry);
 
+  // Stores a json object into pv, in the flat encoding if experimental_flat_json is set.
+  static void SetJsonObject(JsonType&& value, PrimeValue* pv);
+
  private:
   static void Get(CmdArgList args, ConnectionContext* cntx);
   static void MGet(CmdArgList args, ConnectionContext* cntx);
@@ -4,10 +4,12 @@
 
 #include "server/json_family.h"
 
+#include <absl/flags/reflection.h>
 #include <absl/strings/str_replace.h>
 
 #include <jsoncons/json.hpp>
 
+#include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
@@ -18,6 +20,9 @@ using namespace testing;
 using namespace std;
 using namespace util;
 
+ABSL_DECLARE_FLAG(bool, experimental_flat_json);
+ABSL_DECLARE_FLAG(bool, jsonpathv2);
+
 namespace dfly {
 
 class JsonFamilyTest : public BaseFamilyTest {
@@ -937,6 +942,25 @@ TEST_F(JsonFamilyTest, MGet) {
   resp = Run({"JSON.MGET", "json3", "json4", "$..a"});
   ASSERT_EQ(RespExpr::ARRAY, resp.type);
   EXPECT_THAT(resp.GetVec(), ElementsAre(R"([1,3])", R"([4,6])"));
+
+  // Aggregations are evaluated per key, also by shards that run in parallel.
+  absl::SetFlag(&FLAGS_jsonpathv2, true);
+  vector<string> cmd{"JSON.MGET"};
+  bool spans_shards = false;
+  for (unsigned i = 0; i < 8; ++i) {
+    string key = absl::StrCat("agg", i);
+    ASSERT_EQ(Run({"JSON.SET", key, ".", absl::StrCat(R"({"a":[1,)", i * 2, "]}")}), "OK");
+    cmd.push_back(key);
+    spans_shards |= Shard(key, shard_set->size()) != Shard("agg0", shard_set->size());
+  }
+  cmd.push_back("max($.a[*])");
+  ASSERT_TRUE(spans_shards);
+
+  resp = Run(absl::MakeSpan(cmd));
+  ASSERT_THAT(resp, ArrLen(8));
+  for (unsigned i = 0; i < 8; ++i)
+    EXPECT_EQ(resp.GetVec()[i], absl::StrCat("[", max(1u, i * 2), "]"));
+  absl::SetFlag(&FLAGS_jsonpathv2, false);
 }
 
 TEST_F(JsonFamilyTest, DebugFields) {
@@ -1052,4 +1076,69 @@ TEST_F(JsonFamilyTest, Set) {
   EXPECT_EQ(resp, R"([{"a":2,"b":8,"c":[1,2,3]}])");
 }
 
+TEST_F(JsonFamilyTest, FlatEncoding) {
+  absl::FlagSaver fs;
+  string json =
+      R"({"a":123456,"b":"hello","c":[1,{"d":null},1.5],"nested":{"abc":"f","bfb":true}})";
+
+  absl::SetFlag(&FLAGS_experimental_flat_json, false);
+  ASSERT_EQ(Run({"JSON.SET", "cons", ".", json}), "OK");
+  absl::SetFlag(&FLAGS_experimental_flat_json, true);
+  ASSERT_EQ(Run({"JSON.SET", "flat", ".", json}), "OK");
+
+  // Simple jsonpathv2 paths are served from the flat encoding, the rest from the decoded object.
+  for (bool v2 : {false, true}) {
+    absl::SetFlag(&FLAGS_jsonpathv2, v2);
+    for (string_view path : {"$", ".", "$.a", "$.c[1]", "$.c[1].d", "$.c[5]", "$.a.b",
+                             "$.nested", "$..abc", "$.c[*]", "$.c.length", "$.b.length"}) {
+      EXPECT_EQ(Run({"JSON.GET", "cons", path}).GetString(),
+                Run({"JSON.GET", "flat", path}).GetString())
+          << path << " v2: " << v2;
+    }
+  }
+
+  // Read-only commands on simple paths decode only the matched value.
+  EXPECT_EQ(Run({"JSON.TYPE", "flat", "$.c[1]"}), "object");
+  EXPECT_THAT(Run({"JSON.STRLEN", "flat", "$.b"}), IntArg(5));
+  EXPECT_THAT(Run({"JSON.ARRLEN", "flat", "$.c"}), IntArg(3));
+  EXPECT_THAT(Run({"JSON.ARRLEN", "flat", "$.x"}), ArgType(RespExpr::NIL_ARRAY));
+  EXPECT_THAT(Run({"JSON.OBJLEN", "flat", "$.nested"}), IntArg(2));
+  EXPECT_THAT(Run({"JSON.OBJKEYS", "flat", "$.nested"}).GetVec(), ElementsAre("abc", "bfb"));
+  EXPECT_THAT(Run({"JSON.ARRINDEX", "flat", "$.c", "1.5"}), IntArg(2));
+
+  EXPECT_EQ(Run({"JSON.GET", "cons", "$.a", "$.nested.bfb"}).GetString(),
+            Run({"JSON.GET", "flat", "$.a", "$.nested.bfb"}).GetString());
+  EXPECT_EQ(Run({"JSON.GET", "flat", "$.b"}), R"(["hello"])");
+
+  EXPECT_EQ(Run({"JSON.SET", "flat", "$.b", R"("world")"}), "OK");
+  EXPECT_EQ(Run({"JSON.NUMINCRBY", "flat", "$.a", "1"}), "[123457]");
+  EXPECT_THAT(Run({"JSON.DEL", "flat", "$.nested"}), IntArg(1));
+  EXPECT_EQ(Run({"JSON.GET", "flat", "."}), R"({"a":123457,"b":"world","c":[1,{"d":null},1.5]})");
+
+  EXPECT_THAT(Run({"JSON.ARRAPPEND", "flat", "$.c", "2"}), IntArg(4));
+  EXPECT_EQ(Run({"JSON.GET", "flat", "$.c"}), R"([[1,{"d":null},1.5,2]])");
+}
+
+TEST_F(JsonFamilyTest, PathCache) {
+  absl::FlagSaver fs;
+  ASSERT_EQ(Run({"JSON.SET", "j1", ".", R"({"a":{"b":[1,2,3]},"c":[{"d":4},{"d":5}]})"}), "OK");
+  ASSERT_EQ(Run({"JSON.SET", "j2", ".", R"({"a":{"b":[1]}})"}), "OK");
+
+  // Repeated paths are parsed once per thread and then served from the cache.
+  for (bool v2 : {false, true, false}) {
+    absl::SetFlag(&FLAGS_jsonpathv2, v2);
+    for (unsigned i = 0; i < 3; ++i) {
+      EXPECT_EQ(Run({"JSON.GET", "j1", "$.a.b[1]"}), "[2]");
+      EXPECT_EQ(Run({"JSON.GET", "j1", "$..d"}), "[4,5]");
+      EXPECT_EQ(Run({"JSON.GET", "j2", "$.a.b[1]"}), "[]");
+      EXPECT_THAT(Run({"JSON.GET", "j1", "$.a.b["}), ErrArg("syntax error"));
+    }
+  }
+
+  // Aggregation functions keep their state in the path, so such paths are not shared.
+  absl::SetFlag(&FLAGS_jsonpathv2, true);
+  EXPECT_EQ(Run({"JSON.GET", "j1", "max($.a.b[*])"}), "[3]");
+  EXPECT_EQ(Run({"JSON.GET", "j2", "max($.a.b[*])"}), "[1]");
+}
+
 }  // namespace dfly
@@ -89,6 +89,13 @@ ABSL_FLAG(dfly::MemoryBytesFlag, maxmemory, dfly::MemoryBytesFlag{},
 ABSL_FLAG(double, oom_deny_ratio, 1.1,
           "commands with flag denyoom will return OOM when the ratio between maxmemory and used "
           "memory is above this value");
+ABSL_FLAG(uint32_t, stream_node_max_bytes, 4096,
+          "Maximum size in bytes of a stream listpack node, 0 for no limit. Entries of a node "
+          "that have the same fields as its first entry store only their values, so larger nodes "
+          "keep homogeneous streams more compact. Nodes are always listpacks, there is no "
+          "columnar stream encoding.");
+ABSL_FLAG(uint32_t, stream_node_max_entries, 100,
+          "Maximum number of entries in a stream listpack node, 0 for no limit.");
 
 namespace dfly {
 
@@ -799,6 +806,21 @@ void Service::Init(util::AcceptServer* acceptor, std::vector<facade::Listener*>
   config_registry.RegisterMutable("enable_heartbeat_eviction");
   config_registry.RegisterMutable("dbfilename");
 
+  server.stream_node_max_bytes = GetFlag(FLAGS_stream_node_max_bytes);
+  server.stream_node_max_entries = GetFlag(FLAGS_stream_node_max_entries);
+  config_registry.RegisterMutable("stream_node_max_bytes", [](const absl::CommandLineFlag& flag) {
+    auto res = flag.TryGet<uint32_t>();
+    if (res)
+      server.stream_node_max_bytes = *res;
+    return res.has_value();
+  });
+  config_registry.RegisterMutable("stream_node_max_entries", [](const absl::CommandLineFlag& flag) {
+    auto res = flag.TryGet<uint32_t>();
+    if (res)
+      server.stream_node_max_entries = *res;
+    return res.has_value();
+  });
+
   uint32_t shard_num = GetFlag(FLAGS_num_shards);
   if (shard_num == 0 || shard_num > pp_.size()) {
     LOG_IF(WARNING, shard_num > pp_.size())
@@ -1045,6 +1067,9 @@ std::optional<ErrorReply> Service::VerifyCommandState(const CommandId* cid, CmdA
   if (under_script && (cid->opt_mask() & CO::NOSCRIPT))
     return ErrorReply{"This Redis command is not allowed from script"};
 
+  if (under_script && is_write_cmd && dfly_cntx.conn_state.script_info->read_only)
+    return ErrorReply{"Write commands are not allowed from read-only scripts"};
+
   if (under_script) {
     DCHECK(dfly_cntx.transaction);
     // The following commands access shards arbitrarily without having keys, so they can only be run
@@ -1100,7 +1125,8 @@ void Service::DispatchCommand(CmdArgList args, facade::ConnectionContext* cntx)
 
   if (!dispatching_in_multi) {  // Don't interrupt running multi commands
     bool is_write = cid->IsWriteOnly();
-    is_write |= cid->name() == "PUBLISH" || cid->name() == "EVAL" || cid->name() == "EVALSHA";
+    is_write |= cid->name() == "PUBLISH" || cid->name() == "EVAL" || cid->name() == "EVALSHA" ||
+                cid->name() == "FCALL";
     is_write |= cid->name() == "EXEC" && dfly_cntx->conn_state.exec_info.is_write;
 
     cntx->paused = true;
@@ -1135,6 +1161,7 @@ void Service::DispatchCommand(CmdArgList args, facade::ConnectionContext* cntx)
     uint64_t used_memory = etl.GetUsedMemory(start_ns);
     double oom_deny_ratio = GetFlag(FLAGS_oom_deny_ratio);
     if (used_memory > (max_memory_limit * oom_deny_ratio)) {
+      etl.stats.oom_deny_rejections++;
       return cntx->reply_builder()->SendError(kOutOfMemory);
     }
   }
@@ -1669,8 +1696,39 @@ void Service::EvalSha(CmdArgList args, ConnectionContext* cntx) {
   CallSHA(args, sha, interpreter, cntx);
 }
 
+void Service::FCall(CmdArgList args, ConnectionContext* cntx) {
+  CallFunction(args, false, cntx);
+}
+
+void Service::FCallRo(CmdArgList args, ConnectionContext* cntx) {
+  CallFunction(args, true, cntx);
+}
+
+void Service::CallFunction(CmdArgList args, bool read_only, ConnectionContext* cntx) {
+  string_view name = ArgS(args, 0);
+
+  // Functions are run like scripts, by the id of the function in the interpreter.
+  char sha[41];
+  Interpreter::FunctionSha1(name, sha);
+
+  BorrowedInterpreter interpreter{cntx};
+  if (!interpreter->Exists(sha, true)) {
+    if (auto err = server_family_.script_mgr()->LoadFunction(name, interpreter); err)
+      return cntx->SendError(err.Format());
+  }
+
+  // The script manager updates the caches before a function can be loaded.
+  auto params = ServerState::tlocal()->GetScriptParams(sha);
+  if (!params)
+    return cntx->SendError("Function not found");
+  if (read_only && !params->read_only)
+    return cntx->SendError("Can not execute a script with write flag using *_ro command.");
+
+  CallSHA(args, sha, interpreter, cntx, true);
+}
+
 void Service::CallSHA(CmdArgList args, string_view sha, Interpreter* interpreter,
-                      ConnectionContext* cntx) {
+                      ConnectionContext* cntx, bool library) {
   uint32_t num_keys;
   CHECK(absl::SimpleAtoi(ArgS(args, 1), &num_keys));  // we already validated this
 
@@ -1678,6 +1736,7 @@ void Service::CallSHA(CmdArgList args, string_view sha, Interpreter* interpreter
   ev_args.sha = sha;
   ev_args.keys = args.subspan(2, num_keys);
   ev_args.args = args.subspan(2 + num_keys);
+  ev_args.library = library;
 
   uint64_t start = absl::GetCurrentTimeNanos();
   EvalInternal(args, ev_args, interpreter, cntx);
@@ -1696,7 +1755,11 @@ optional<ScriptMgr::ScriptParams> LoadScript(string_view sha, ScriptMgr* script_
       return std::nullopt;
 
     string err;
-    CHECK_EQ(Interpreter::ADD_OK, interpreter->AddFunction(sha, script_data->body, &err));
+    Interpreter::AddResult add_result =
+        script_data->bytecode.empty()
+            ? interpreter->AddFunction(sha, script_data->body, &err)
+            : interpreter->AddPrecompiled(sha, script_data->bytecode, &err);
+    CHECK_EQ(Interpreter::ADD_OK, add_result);
     CHECK(err.empty()) << err;
 
     return script_data;
@@ -1815,9 +1878,12 @@ void Service::EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpret
     return cntx->SendError(facade::kScriptNotFound);
   }
 
-  auto params = LoadScript(eval_args.sha, server_family_.script_mgr(), interpreter);
+  // Library functions are loaded by CallFunction.
+  auto params = eval_args.library
+                    ? ServerState::tlocal()->GetScriptParams(eval_args.sha)
+                    : LoadScript(eval_args.sha, server_family_.script_mgr(), interpreter);
   if (!params)
-    return cntx->SendError(facade::kScriptNotFound);
+    return cntx->SendError(eval_args.library ? "Function not found" : facade::kScriptNotFound);
 
   string error;
 
@@ -1829,6 +1895,7 @@ void Service::EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpret
   auto& sinfo = cntx->conn_state.script_info;
   sinfo = make_unique<ConnectionState::ScriptInfo>();
   sinfo->keys.reserve(eval_args.keys.size());
+  sinfo->read_only = params->read_only;
 
   optional<ShardId> sid;
 
@@ -1876,7 +1943,7 @@ void Service::EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpret
           new Transaction{tx, *sid, slot_checker.GetUniqueSlotId()};
       cntx->transaction = stub_tx.get();
 
-      result = interpreter->RunFunction(eval_args.sha, &error);
+      result = interpreter->RunFunction(eval_args.sha, &error, eval_args.library);
       cntx->transaction->FIX_ConcludeJournalExec();  // flush journal
 
       cntx->transaction = tx;
@@ -1898,7 +1965,7 @@ void Service::EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpret
     interpreter->SetRedisFunc(
         [cntx, this](Interpreter::CallArgs args) { CallFromScript(cntx, args); });
 
-    result = interpreter->RunFunction(eval_args.sha, &error);
+    result = interpreter->RunFunction(eval_args.sha, &error, eval_args.library);
 
     if (auto err = FlushEvalAsyncCmds(cntx, true); err) {
       auto err_ref = CapturingReplyBuilder::GetError(*err);
@@ -2210,18 +2277,8 @@ void Service::PUnsubscribe(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
-// Not a real implementation. Serves as a decorator to accept some function commands
-// for testing.
 void Service::Function(CmdArgList args, ConnectionContext* cntx) {
-  ToUpper(&args[0]);
-  string_view sub_cmd = ArgS(args, 0);
-
-  if (sub_cmd == "FLUSH") {
-    return cntx->SendOk();
-  }
-
-  string err = UnknownSubCmd(sub_cmd, "FUNCTION");
-  return cntx->SendError(err, kSyntaxErrType);
+  server_family_.script_mgr()->FunctionCmd(std::move(args), cntx);
 }
 
 void Service::PubsubChannels(string_view pattern, ConnectionContext* cntx) {
@@ -2486,6 +2543,8 @@ constexpr uint32_t kUnwatch = FAST | TRANSACTION;
 constexpr uint32_t kDiscard = FAST | TRANSACTION;
 constexpr uint32_t kEval = SLOW | SCRIPTING;
 constexpr uint32_t kEvalSha = SLOW | SCRIPTING;
+constexpr uint32_t kFCall = SLOW | SCRIPTING;
+constexpr uint32_t kFCallRo = SLOW | SCRIPTING;
 constexpr uint32_t kExec = SLOW | TRANSACTION;
 constexpr uint32_t kPublish = PUBSUB | FAST;
 constexpr uint32_t kSubscribe = PUBSUB | SLOW;
@@ -2513,6 +2572,12 @@ void Service::Register(CommandRegistry* registry) {
       << CI{"EVALSHA", CO::NOSCRIPT | CO::VARIADIC_KEYS, -3, 3, 3, acl::kEvalSha}
              .MFUNC(EvalSha)
              .SetValidator(&EvalValidator)
+      << CI{"FCALL", CO::NOSCRIPT | CO::VARIADIC_KEYS, -3, 3, 3, acl::kFCall}
+             .MFUNC(FCall)
+             .SetValidator(&EvalValidator)
+      << CI{"FCALL_RO", CO::NOSCRIPT | CO::READONLY | CO::VARIADIC_KEYS, -3, 3, 3, acl::kFCallRo}
+             .MFUNC(FCallRo)
+             .SetValidator(&EvalValidator)
       << CI{"EXEC", CO::LOADING | CO::NOSCRIPT, 1, 0, 0, acl::kExec}.MFUNC(Exec)
       << CI{"PUBLISH", CO::LOADING | CO::FAST, 3, 0, 0, acl::kPublish}.MFUNC(Publish)
       << CI{"SUBSCRIBE", CO::NOSCRIPT | CO::LOADING, -2, 0, 0, acl::kSubscribe}.MFUNC(Subscribe)
@@ -2521,7 +2586,8 @@ void Service::Register(CommandRegistry* registry) {
       << CI{"PSUBSCRIBE", CO::NOSCRIPT | CO::LOADING, -2, 0, 0, acl::kPSubscribe}.MFUNC(PSubscribe)
       << CI{"PUNSUBSCRIBE", CO::NOSCRIPT | CO::LOADING, -1, 0, 0, acl::kPUnsubsribe}.MFUNC(
              PUnsubscribe)
-      << CI{"FUNCTION", CO::NOSCRIPT, 2, 0, 0, acl::kFunction}.MFUNC(Function)
+      << CI{"FUNCTION", CO::NOSCRIPT | CO::NO_KEY_TRANSACTIONAL, -2, 0, 0, acl::kFunction}.MFUNC(
+             Function)
       << CI{"MONITOR", CO::ADMIN, 1, 0, 0, acl::kMonitor}.MFUNC(Monitor)
       << CI{"PUBSUB", CO::LOADING | CO::FAST, -1, 0, 0, acl::kPubSub}.MFUNC(Pubsub)
       << CI{"COMMAND", CO::LOADING | CO::NOSCRIPT, -1, 0, 0, acl::kCommand}.MFUNC(Command);
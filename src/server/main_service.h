@@ -134,6 +134,8 @@ class Service : public facade::ServiceInterface {
   void Discard(CmdArgList args, ConnectionContext* cntx);
   void Eval(CmdArgList args, ConnectionContext* cntx);
   void EvalSha(CmdArgList args, ConnectionContext* cntx);
+  void FCall(CmdArgList args, ConnectionContext* cntx);
+  void FCallRo(CmdArgList args, ConnectionContext* cntx);
   void Exec(CmdArgList args, ConnectionContext* cntx);
   void Publish(CmdArgList args, ConnectionContext* cntx);
   void Subscribe(CmdArgList args, ConnectionContext* cntx);
@@ -152,6 +154,7 @@ class Service : public facade::ServiceInterface {
   struct EvalArgs {
     std::string_view sha;  // only one of them is defined.
     CmdArgList keys, args;
+    bool library = false;  // sha is the id of a library function called with FCALL.
   };
 
   // Return error if not all keys are owned by the server when running in cluster mode
@@ -161,7 +164,8 @@ class Service : public facade::ServiceInterface {
   void EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpreter* interpreter,
                     ConnectionContext* cntx);
   void CallSHA(CmdArgList args, std::string_view sha, Interpreter* interpreter,
-               ConnectionContext* cntx);
+               ConnectionContext* cntx, bool library = false);
+  void CallFunction(CmdArgList args, bool read_only, ConnectionContext* cntx);
 
   // Return optional payload - first received error that occured when executing commands.
   std::optional<facade::CapturingReplyBuilder::Payload> FlushEvalAsyncCmds(ConnectionContext* cntx,
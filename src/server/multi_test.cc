@@ -567,6 +567,41 @@ TEST_F(MultiTest, MultiOOO) {
     EXPECT_EQ(0, metrics.shard_stats.tx_ooo_total);
 }
 
+// Read-mostly scripts whose keys belong to a single shard run entirely inside the shard thread.
+TEST_F(MultiTest, EvalShardLocal) {
+  if (auto config = absl::GetFlag(FLAGS_default_lua_flags); config != "") {
+    GTEST_SKIP() << "Skipped EvalShardLocal test because default_lua_flags is set";
+    return;
+  }
+
+  // Sums all the keys but the last one and stores the sum into it.
+  const char* kScript = R"(
+    local sum = 0
+    for i = 1, #KEYS - 1 do
+      sum = sum + tonumber(redis.call('GET', KEYS[i]))
+    end
+    redis.call('SET', KEYS[#KEYS], sum)
+    return sum
+  )";
+
+  vector<string> cmd = {"eval", kScript, "11"};
+  for (unsigned i = 0; cmd.size() < 14; ++i) {
+    string key = absl::StrCat("key", i);
+    if (Shard(key, shard_set->size()) == 1)
+      cmd.push_back(key);
+  }
+  for (unsigned i = 0; i < 10; ++i)
+    Run({"set", cmd[3 + i], absl::StrCat(i)});
+
+  auto before = GetMetrics().coordinator_stats;
+  EXPECT_THAT(Run(absl::MakeSpan(cmd)), IntArg(45));
+  EXPECT_EQ(Run({"get", cmd.back()}), "45");
+
+  auto after = GetMetrics().coordinator_stats;
+  EXPECT_EQ(before.eval_shardlocal_coordination_cnt + 1, after.eval_shardlocal_coordination_cnt);
+  EXPECT_EQ(before.eval_io_coordination_cnt, after.eval_io_coordination_cnt);
+}
+
 // Lua scripts lock their keys ahead and thus can run out of order.
 TEST_F(MultiTest, EvalOOO) {
   if (auto config = absl::GetFlag(FLAGS_default_lua_flags); config != "") {
@@ -722,6 +757,122 @@ TEST_F(MultiTest, ScriptFlagsCommand) {
   }
 }
 
+TEST_F(MultiTest, ScriptPrecompiled) {
+  const char* kScript = "return ARGV[1] .. 'x'";
+  const char* kFailing = "local a = 1\nreturn a + nil";
+
+  auto resp = Run({"script", "load", kScript});
+  string sha{facade::ToSV(resp.GetBuf())};
+  resp = Run({"eval", kFailing, "0"});
+  ASSERT_THAT(resp, ErrArg("attempt to perform arithmetic"));
+  string error{facade::ToSV(resp.GetBuf())};
+
+  // Other threads load the bytecode compiled by the first one.
+  for (unsigned i = 1; i < pp_->size(); ++i) {
+    pp_->at(i)->Await([&] {
+      EXPECT_EQ(Run({"evalsha", sha, "0", "a"}), "ax");
+      EXPECT_EQ(Run({"eval", kScript, "0", "b"}), "bx");
+
+      // Debug info is kept in the bytecode, so errors point to the same lines.
+      auto resp = Run({"eval", kFailing, "0"});
+      EXPECT_EQ(error, facade::ToSV(resp.GetBuf()));
+    });
+  }
+
+  EXPECT_EQ(Run({"script", "flush"}), "OK");
+  EXPECT_THAT(Run({"evalsha", sha, "0", "a"}), ErrArg("NOSCRIPT"));
+}
+
+TEST_F(MultiTest, ScriptMemory) {
+  size_t before = GetMetrics().lua_memory_bytes;
+  EXPECT_EQ(Run({"eval", "local t = {} for i = 1, 1000 do t[i] = tostring(i) end return #t", "0"}),
+            IntArg(1000));
+
+  // The interpreter that ran the script is accounted for.
+  EXPECT_GT(GetMetrics().lua_memory_bytes, before);
+
+  auto resp = Run({"info", "memory"});
+  EXPECT_THAT(resp.GetString(), HasSubstr("used_memory_lua:"));
+}
+
+TEST_F(MultiTest, Functions) {
+  const char* kLib = R"(#!lua name=mylib
+redis.register_function('incr_by', function(keys, args)
+  return redis.call('INCRBY', keys[1], args[1])
+end)
+redis.register_function{function_name='get', flags={'no-writes'}, callback=function(keys, args)
+  return redis.call('GET', keys[1])
+end}
+redis.register_function{function_name='bad_get', flags={'no-writes'}, callback=function(keys)
+  return redis.call('SET', keys[1], 'x')
+end}
+)";
+
+  EXPECT_EQ(Run({"function", "load", kLib}), "mylib");
+  EXPECT_THAT(Run({"function", "load", kLib}), ErrArg("Library 'mylib' already exists"));
+  EXPECT_EQ(Run({"function", "load", "replace", kLib}), "mylib");
+  EXPECT_THAT(Run({"function", "load", "return 1"}), ErrArg("Missing library metadata"));
+
+  EXPECT_THAT(Run({"fcall", "incr_by", "1", "a", "5"}), IntArg(5));
+  EXPECT_EQ(Run({"fcall_ro", "get", "1", "a"}), "5");
+  EXPECT_THAT(Run({"fcall_ro", "incr_by", "1", "a", "5"}),
+              ErrArg("Can not execute a script with write flag"));
+  EXPECT_THAT(Run({"fcall_ro", "bad_get", "1", "a"}),
+              ErrArg("Write commands are not allowed from read-only scripts"));
+  EXPECT_THAT(Run({"fcall", "unknown", "0"}), ErrArg("Function not found"));
+
+  // Functions can not be run as scripts.
+  char sha[41];
+  Interpreter::FunctionSha1("incr_by", sha);
+  EXPECT_THAT(Run({"evalsha", sha, "1", "a", "5"}), ErrArg("NOSCRIPT"));
+
+  // Other threads load the library on their first call.
+  for (unsigned i = 1; i < pp_->size(); ++i) {
+    pp_->at(i)->Await([&] {
+      EXPECT_THAT(Run({"fcall", "incr_by", "1", "a", "1"}), IntArg(5 + i));
+    });
+  }
+
+  auto resp = Run({"function", "list"});
+  ASSERT_THAT(resp, ArrLen(6));
+  EXPECT_EQ(resp.GetVec()[1], "mylib");
+  EXPECT_THAT(resp.GetVec()[5], ArrLen(3));
+
+  EXPECT_EQ(Run({"function", "delete", "mylib"}), "OK");
+  EXPECT_THAT(Run({"fcall", "incr_by", "1", "a", "1"}), ErrArg("Function not found"));
+  EXPECT_THAT(Run({"function", "delete", "mylib"}), ErrArg("Library not found"));
+}
+
+TEST_F(MultiTest, FunctionsReplaceConcurrently) {
+  auto lib = [](int val) {
+    return absl::StrCat("#!lua name=mylib\nredis.register_function('f', function() return ", val,
+                        " end)");
+  };
+  ASSERT_EQ(Run({"function", "load", lib(0)}), "mylib");
+
+  // Replacing the library resets the interpreters while the calls hold them.
+  atomic_bool done = false;
+  vector<Fiber> fbs(pp_->size());
+  for (unsigned i = 0; i < fbs.size(); ++i) {
+    fbs[i] = pp_->at(i)->LaunchFiber([&, i] {
+      string id = absl::StrCat("caller", i);
+      while (!done) {
+        auto resp = Run(id, {"fcall", "f", "0"});
+        ASSERT_THAT(resp, ArgType(RespExpr::INT64));
+      }
+    });
+  }
+
+  for (int i = 1; i <= 20; ++i) {
+    ASSERT_EQ(Run({"function", "load", "replace", lib(i)}), "mylib");
+  }
+  done = true;
+  for (auto& fb : fbs)
+    fb.Join();
+
+  EXPECT_THAT(Run({"fcall", "f", "0"}), IntArg(20));
+}
+
 TEST_F(MultiTest, ScriptFlagsEmbedded) {
   const char* s1 = R"(
   #!lua flags=allow-undeclared-keys
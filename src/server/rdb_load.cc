@@ -24,6 +24,7 @@ extern "C" {
 #include <lz4frame.h>
 #include <zstd.h>
 
+#include <algorithm>
 #include <cstring>
 
 #include "base/endian.h"
@@ -36,6 +37,7 @@ extern "C" {
 #include "server/engine_shard_set.h"
 #include "server/error.h"
 #include "server/hset_family.h"
+#include "server/json_family.h"
 #include "server/journal/executor.h"
 #include "server/journal/serializer.h"
 #include "server/main_service.h"
@@ -722,21 +724,19 @@ void RdbLoaderBase::OpaqueObjLoader::CreateZSet(const LoadTrace* ltrace) {
 
   size_t maxelelen = 0, totelelen = 0;
 
+  // The members are only indexed while loading, and the score tree is built at once at the end.
   Iterate(*ltrace, [&](const LoadBlob& blob) {
-    sds sdsele = ToSds(blob.rdb_var);
-    if (!sdsele)
+    string_view ele = ToSV(blob.rdb_var);
+    if (ec_)
       return false;
 
-    double score = blob.score;
-
     /* Don't care about integer-encoded strings. */
-    if (sdslen(sdsele) > maxelelen)
-      maxelelen = sdslen(sdsele);
-    totelelen += sdslen(sdsele);
+    if (ele.size() > maxelelen)
+      maxelelen = ele.size();
+    totelelen += ele.size();
 
-    if (!zs->Insert(score, sdsele)) {
+    if (!zs->BulkAdd(blob.score, ele)) {
       LOG(ERROR) << "Duplicate zset fields detected";
-      sdsfree(sdsele);
       ec_ = RdbError(errc::rdb_file_corrupted);
       return false;
     }
@@ -747,6 +747,8 @@ void RdbLoaderBase::OpaqueObjLoader::CreateZSet(const LoadTrace* ltrace) {
   if (ec_)
     return;
 
+  zs->FinishBulkLoad();
+
   void* inner = zs;
   if (zs->Size() <= server.zset_max_listpack_entries &&
       maxelelen <= server.zset_max_listpack_value && lpSafeToAdd(NULL, totelelen)) {
@@ -818,10 +820,13 @@ void RdbLoaderBase::OpaqueObjLoader::CreateStream(const LoadTrace* ltrace) {
       return;
     }
 
+    vector<streamNACK*> nacks;
+    nacks.reserve(cg.pel_arr.size());
     for (const auto& pel : cg.pel_arr) {
       streamNACK* nack = streamCreateNACK(NULL);
       nack->delivery_time = pel.delivery_time;
       nack->delivery_count = pel.delivery_count;
+      streamDecodeID(const_cast<uint8_t*>(pel.rawid.data()), &nack->id);
 
       if (!raxTryInsert(cgroup->pel, const_cast<uint8_t*>(pel.rawid.data()), pel.rawid.size(), nack,
                         NULL)) {
@@ -830,6 +835,15 @@ void RdbLoaderBase::OpaqueObjLoader::CreateStream(const LoadTrace* ltrace) {
         streamFreeNACK(nack);
         return;
       }
+      nacks.push_back(nack);
+    }
+
+    // The delivery time list is not serialized, rebuild it from the loaded PEL.
+    std::stable_sort(nacks.begin(), nacks.end(), [](const streamNACK* a, const streamNACK* b) {
+      return a->delivery_time < b->delivery_time;
+    });
+    for (streamNACK* nack : nacks) {
+      streamLinkNACK(cgroup, nack);
     }
 
     for (const auto& cons : cg.cons_arr) {
@@ -1010,8 +1024,9 @@ void RdbLoaderBase::OpaqueObjLoader::HandleBlob(string_view blob) {
     auto json = JsonFromString(blob, CompactObj::memory_resource());
     if (!json) {
       ec_ = RdbError(errc::bad_json_string);
+      return;
     }
-    pv_->SetJson(std::move(*json));
+    JsonFamily::SetJsonObject(std::move(*json), pv_);
   } else {
     LOG(FATAL) << "Unsupported rdb type " << rdb_type_;
   }
@@ -1995,6 +2010,10 @@ error_code RdbLoader::Load(io::Source* src) {
 
     if (type == RDB_OPCODE_JOURNAL_BLOB) {
       FlushAllShards();  // Always flush before applying incremental on top
+      if (before_journal_cb_) {
+        RETURN_ON_ERR(before_journal_cb_());
+        before_journal_cb_ = nullptr;
+      }
       RETURN_ON_ERR(HandleJournalBlob(service_));
       continue;
     }
@@ -2210,6 +2229,8 @@ error_code RdbLoader::HandleAux() {
     // TODO
   } else if (auxkey == "lua") {
     LoadScriptFromAux(std::move(auxval));
+  } else if (auxkey == "lua-function") {
+    LoadFunctionFromAux(std::move(auxval));
   } else if (auxkey == "redis-ver") {
     VLOG(1) << "Loading RDB produced by version " << auxval;
   } else if (auxkey == "ctime") {
@@ -2384,6 +2405,14 @@ void RdbLoader::LoadScriptFromAux(string&& body) {
   }
 }
 
+void RdbLoader::LoadFunctionFromAux(string&& code) {
+  if (script_mgr_) {
+    auto res = script_mgr_->LoadLibrary(code, true);
+    if (!res)
+      LOG(ERROR) << "Error loading function library: " << res.error().Format();
+  }
+}
+
 void RdbLoader::LoadSearchIndexDefFromAux(string&& def) {
   facade::CapturingReplyBuilder crb{};
   ConnectionContext cntx{nullptr, nullptr, &crb};
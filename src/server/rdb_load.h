@@ -197,6 +197,13 @@ class RdbLoader : protected RdbLoaderBase {
     full_sync_cut_cb = std::move(cb);
   }
 
+  // Set callback that runs once before the first journal blob is applied. It allows a replica
+  // to delay journal execution until the data streamed over other connections is loaded.
+  // Loading stops with the returned error if there is any.
+  void SetBeforeJournalCb(std::function<std::error_code()> cb) {
+    before_journal_cb_ = std::move(cb);
+  }
+
   // Perform pre load procedures after transitioning into the global LOADING state.
   static void PerformPreLoad(Service* service);
 
@@ -239,6 +246,7 @@ class RdbLoader : protected RdbLoaderBase {
   void LoadItemsBuffer(DbIndex db_ind, const ItemsBuf& ib);
 
   void LoadScriptFromAux(std::string&& value);
+  void LoadFunctionFromAux(std::string&& code);
 
   // Load index definition from RESP string describing it in FT.CREATE format,
   // issues an FT.CREATE call, but does not start indexing
@@ -259,6 +267,7 @@ class RdbLoader : protected RdbLoaderBase {
 
   // Callback when receiving RDB_OPCODE_FULLSYNC_END
   std::function<void()> full_sync_cut_cb;
+  std::function<std::error_code()> before_journal_cb_;
 
   base::MPSCIntrusiveQueue<Item> item_queue_;
 };
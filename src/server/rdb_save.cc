@@ -46,6 +46,10 @@ ABSL_FLAG(dfly::CompressionMode, compression_mode, dfly::CompressionMode::MULTI_
           "set 2 for multi entry zstd compression on df snapshot and single entry on rdb snapshot,"
           "set 3 for multi entry lz4 compression on df snapshot and single entry on rdb snapshot");
 ABSL_FLAG(int, compression_level, 2, "The compression level to use on zstd/lz4 compression");
+ABSL_FLAG(uint32_t, full_sync_held_journal_mb, 64,
+          "When the full sync of a replication flow uses multiple streams, the changes made during "
+          "the sync are held back until all the streams finish. Beyond this size in MB per flow, "
+          "the remaining snapshot data of the flow is sent over a single stream.");
 
 namespace dfly {
 
@@ -616,6 +620,9 @@ error_code RdbSerializer::SaveStreamObject(const PrimeValue& pv) {
 }
 
 error_code RdbSerializer::SaveJsonObject(const PrimeValue& pv) {
+  if (pv.JsonEncoding() == kEncodingJsonFlat) {
+    return SaveString(JsonFromFlat(pv.GetFlatJson(), PMR_NS::get_default_resource()).to_string());
+  }
   auto json_string = pv.GetJson()->to_string();
   return SaveString(json_string);
 }
@@ -1024,8 +1031,30 @@ class RdbSaver::Impl {
     SliceSnapshot::DbRecord record_holder;
   };
 
+  // An additional stream that receives a share of the snapshot records, see SetPartSinks.
+  struct PartStream {
+    explicit PartStream(io::Sink* s) : sink(s), channel(16) {
+    }
+
+    io::Sink* sink;
+    SliceSnapshot::RecordChannel channel;
+    Fiber writer;
+    error_code ec;
+  };
+
   void CleanShardSnapshots();
 
+  // Writes the record either to the main sink or to one of the part streams.
+  error_code WriteRecord(SliceSnapshot::DbRecord* record);
+
+  // Closes the part streams, no records are sent to them afterwards.
+  void ClosePartStreams();
+
+  // Writes the journal records that were held back while the part streams were open.
+  error_code FlushHeldJournal();
+
+  void PartWriterFb(PartStream* part);
+
  public:
   // We pass K=sz to say how many producers are pushing data in order to maintain
   // correct closing semantics - channel is closing when K producers marked it as closed.
@@ -1039,6 +1068,8 @@ class RdbSaver::Impl {
 
   void StopSnapshotting(EngineShard* shard);
 
+  void SetPartSinks(vector<io::Sink*> sinks, string trailer);
+
   error_code ConsumeChannel(const Cancellation* cll);
 
   void FillFreqMap(RdbTypeFreqMap* dest) const;
@@ -1076,6 +1107,14 @@ class RdbSaver::Impl {
   bool push_to_sink_with_order_ = false;
   std::optional<AlignedBuffer> aligned_buf_;
 
+  vector<unique_ptr<PartStream>> parts_;
+  string part_trailer_;
+  bool parts_open_ = false;
+  unsigned next_part_ = 0;
+  vector<string> held_journal_;
+  size_t held_journal_bytes_ = 0;
+  size_t max_held_journal_bytes_ = 0;
+
   // Single entry compression is compatible with redis rdb snapshot
   // Multi entry compression is available only on df snapshot, this will
   // make snapshot size smaller and opreation faster.
@@ -1121,6 +1160,10 @@ void RdbSaver::Impl::CleanShardSnapshots() {
 }
 
 RdbSaver::Impl::~Impl() {
+  ClosePartStreams();
+  for (auto& part : parts_)
+    part->writer.JoinIfNeeded();
+
   CleanShardSnapshots();
 }
 
@@ -1190,13 +1233,22 @@ error_code RdbSaver::Impl::ConsumeChannel(const Cancellation* cll) {
         continue;
 
       DVLOG(2) << "Pulled " << record->id;
-      io_error = sink_->Write(io::Buffer(record->value));
+      io_error = WriteRecord(&*record);
       if (io_error) {
         break;
       }
     } while ((record = records_popper.TryPop()));
   }  // while (records_popper.Pop())
 
+  ClosePartStreams();
+  if (!io_error)
+    io_error = FlushHeldJournal();
+  for (auto& part : parts_) {
+    part->writer.JoinIfNeeded();
+    if (!io_error)
+      io_error = part->ec;
+  }
+
   for (auto& ptr : shard_snapshots_) {
     ptr->Join();
   }
@@ -1206,6 +1258,96 @@ error_code RdbSaver::Impl::ConsumeChannel(const Cancellation* cll) {
   return io_error;
 }
 
+void RdbSaver::Impl::SetPartSinks(vector<io::Sink*> sinks, string trailer) {
+  DCHECK(push_to_sink_with_order_) << "Part streams are supported only for single shard snapshots";
+  DCHECK(parts_.empty());
+
+  part_trailer_ = std::move(trailer);
+  for (io::Sink* sink : sinks) {
+    auto& part = parts_.emplace_back(make_unique<PartStream>(sink));
+    part->writer = fb2::Fiber("rdb_part_writer", &Impl::PartWriterFb, this, part.get());
+  }
+  parts_open_ = !parts_.empty();
+  max_held_journal_bytes_ = size_t(absl::GetFlag(FLAGS_full_sync_held_journal_mb)) << 20;
+}
+
+error_code RdbSaver::Impl::WriteRecord(SliceSnapshot::DbRecord* record) {
+  if (parts_open_) {
+    if (record->has_journal && !record->has_full_sync_cut) {
+      // The replica applies journal changes only once all the parts reached their end, and stops
+      // reading the main sink until then. Parts end when they are closed, so journal records are
+      // held back until then, or the main sink could block on a replica that does not read it.
+      held_journal_bytes_ += record->value.size();
+      held_journal_.push_back(std::move(record->value));
+      if (held_journal_bytes_ < max_held_journal_bytes_)
+        return {};
+
+      // Bound the memory under heavy writes: the rest of the bucket data goes to the main sink.
+      LOG(WARNING) << "Full sync holds " << held_journal_bytes_ << " bytes of changes, continuing "
+                   << "over a single stream instead of " << parts_.size() + 1
+                   << ". Consider increasing --full_sync_held_journal_mb";
+      ClosePartStreams();
+      return FlushHeldJournal();
+    }
+
+    if (record->has_full_sync_cut) {
+      // All the bucket data was produced, the part streams can be finished.
+      ClosePartStreams();
+      RETURN_ON_ERR(FlushHeldJournal());
+    } else {
+      // Round robin between the main sink and the part streams.
+      unsigned index = next_part_++ % (parts_.size() + 1);
+      if (index > 0) {
+        parts_[index - 1]->channel.Push(std::move(*record));
+        return {};
+      }
+    }
+  }
+
+  return sink_->Write(io::Buffer(record->value));
+}
+
+void RdbSaver::Impl::ClosePartStreams() {
+  if (!parts_open_)
+    return;
+
+  parts_open_ = false;
+  for (auto& part : parts_)
+    part->channel.StartClosing();
+}
+
+error_code RdbSaver::Impl::FlushHeldJournal() {
+  DCHECK(!parts_open_);
+  for (const string& value : held_journal_)
+    RETURN_ON_ERR(sink_->Write(io::Buffer(value)));
+
+  held_journal_.clear();
+  held_journal_bytes_ = 0;
+  return {};
+}
+
+void RdbSaver::Impl::PartWriterFb(PartStream* part) {
+  char magic[16];
+  size_t sz = absl::SNPrintF(magic, sizeof(magic), "REDIS%04d", RDB_SER_VERSION);
+  part->ec = part->sink->Write(io::Buffer(string_view{magic, sz}));
+
+  // Keep popping after an error to unblock the producer.
+  SliceSnapshot::DbRecord record;
+  while (part->channel.Pop(record)) {
+    if (!part->ec)
+      part->ec = part->sink->Write(io::Buffer(record.value));
+  }
+
+  if (part->ec)
+    return;
+
+  // EOF opcode followed by a zero checksum, same as SaveEpilog.
+  uint8_t epilog[9] = {RDB_OPCODE_EOF, 0, 0, 0, 0, 0, 0, 0, 0};
+  part->ec = part->sink->Write(io::Bytes{epilog, sizeof(epilog)});
+  if (!part->ec)
+    part->ec = part->sink->Write(io::Buffer(part_trailer_));
+}
+
 void RdbSaver::Impl::StartSnapshotting(bool stream_journal, const Cancellation* cll,
                                        EngineShard* shard) {
   auto& s = GetSnapshot(shard);
@@ -1266,7 +1408,7 @@ size_t RdbSaver::Impl::GetTotalBuffersSize() const {
 }
 
 RdbSaver::GlobalData RdbSaver::GetGlobalData(const Service* service) {
-  StringVec script_bodies, search_indices;
+  StringVec script_bodies, search_indices, function_libraries;
 
   {
     auto scripts = service->script_mgr()->GetAll();
@@ -1275,6 +1417,13 @@ RdbSaver::GlobalData RdbSaver::GetGlobalData(const Service* service) {
       script_bodies.push_back(std::move(data.body));
   }
 
+  {
+    auto libraries = service->script_mgr()->GetAllLibraries();
+    function_libraries.reserve(libraries.size());
+    for (auto& [name, data] : libraries)
+      function_libraries.push_back(std::move(data.code));
+  }
+
 #ifndef __APPLE__
   {
     shard_set->Await(0, [&] {
@@ -1288,7 +1437,8 @@ RdbSaver::GlobalData RdbSaver::GetGlobalData(const Service* service) {
   }
 #endif
 
-  return RdbSaver::GlobalData{std::move(script_bodies), std::move(search_indices)};
+  return RdbSaver::GlobalData{std::move(script_bodies), std::move(search_indices),
+                              std::move(function_libraries)};
 }
 
 void RdbSaver::Impl::FillFreqMap(RdbTypeFreqMap* dest) const {
@@ -1355,6 +1505,10 @@ void RdbSaver::StopSnapshotInShard(EngineShard* shard) {
   impl_->StopSnapshotting(shard);
 }
 
+void RdbSaver::SetPartSinks(vector<io::Sink*> sinks, string trailer) {
+  impl_->SetPartSinks(std::move(sinks), std::move(trailer));
+}
+
 error_code RdbSaver::SaveHeader(const GlobalData& glob_state) {
   char magic[16];
   // We should use RDB_VERSION here from rdb.h when we ditch redis 6 support
@@ -1414,6 +1568,10 @@ error_code RdbSaver::SaveAux(const GlobalData& glob_state) {
   for (const string& s : glob_state.lua_scripts)
     RETURN_ON_ERR(impl_->SaveAuxFieldStrStr("lua", s));
 
+  DCHECK(save_mode_ != SaveMode::SINGLE_SHARD || glob_state.lua_functions.empty());
+  for (const string& s : glob_state.lua_functions)
+    RETURN_ON_ERR(impl_->SaveAuxFieldStrStr("lua-function", s));
+
   if (save_mode_ == SaveMode::RDB) {
     if (!glob_state.search_indices.empty())
       LOG(WARNING) << "Dragonfly search index data is incompatible with the RDB format";
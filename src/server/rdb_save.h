@@ -74,6 +74,7 @@ class RdbSaver {
   struct GlobalData {
     const StringVec lua_scripts;     // bodies of lua scripts
     const StringVec search_indices;  // ft.create commands to re-create search indices
+    const StringVec lua_functions;   // code of function libraries
   };
 
   // single_shard - true means that we run RdbSaver on a single shard and we do not use
@@ -95,6 +96,13 @@ class RdbSaver {
   // Stops serialization in journal streaming mode in the shard's thread.
   void StopSnapshotInShard(EngineShard* shard);
 
+  // Spreads the bucket data of a single shard snapshot over additional sinks that are written in
+  // parallel with the main one. Each additional sink receives a standalone rdb stream followed by
+  // `trailer`, that is finished once the full sync cut is reached. Records with journal entries
+  // are always written to the main sink, after the additional sinks are finished.
+  // Must be called before SaveBody.
+  void SetPartSinks(std::vector<::io::Sink*> sinks, std::string trailer);
+
   // Stores auxiliary (meta) values and header_info
   std::error_code SaveHeader(const GlobalData& header_info);
 
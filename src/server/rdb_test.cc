@@ -33,6 +33,7 @@ using absl::StrCat;
 ABSL_DECLARE_FLAG(int32, list_compress_depth);
 ABSL_DECLARE_FLAG(int32, list_max_listpack_size);
 ABSL_DECLARE_FLAG(dfly::CompressionMode, compression_mode);
+ABSL_DECLARE_FLAG(float, snapshot_cpu_budget);
 
 namespace dfly {
 
@@ -389,6 +390,45 @@ TEST_F(RdbTest, SaveManyDbs) {
   }
 }
 
+TEST_F(RdbTest, SaveThrottled) {
+  absl::FlagSaver fs;
+  SetFlag(&FLAGS_snapshot_cpu_budget, 0.1);
+
+  Run({"debug", "populate", "200000"});
+
+  auto save_fb = pp_->at(0)->LaunchFiber([&] {
+    RespExpr resp = Run({"save"});
+    ASSERT_EQ(resp, "OK");
+  });
+
+  do {
+    usleep(10);
+  } while (!service_->server_family().TEST_IsSaving());
+
+  // Foreground traffic on the shards makes the snapshot give way to it.
+  pp_->at(1)->Await([&] {
+    for (unsigned i = 0; service_->server_family().TEST_IsSaving(); ++i) {
+      Run({"set", StrCat("key:", i % 1000), "bar"});
+    }
+  });
+
+  save_fb.Join();
+
+  auto save_info = service_->server_family().GetLastSaveInfo();
+  ASSERT_EQ(1, save_info.freq_map.size());
+  EXPECT_EQ(200000, save_info.freq_map.front().second);
+
+  auto metrics = GetMetrics();
+  EXPECT_EQ(0, metrics.snapshot_stats.keys_total);
+  EXPECT_EQ(0, metrics.snapshot_stats.keys_serialized);
+  EXPECT_GT(metrics.snapshot_stats.throttled_cnt, 0u);
+  EXPECT_GT(metrics.snapshot_stats.throttled_usec, 0u);
+
+  auto resp = Run({"debug", "reload", "NOSAVE"});
+  EXPECT_EQ(resp, "OK");
+  EXPECT_EQ(200000, GetMetrics().db_stats[0].key_count);
+}
+
 TEST_F(RdbTest, HMapBugs) {
   // Force kEncodingStrMap2 encoding.
   server.max_map_field_len = 0;
@@ -16,6 +16,7 @@ extern "C" {
 #include <absl/strings/str_cat.h>
 #include <absl/strings/strip.h>
 
+#include <algorithm>
 #include <boost/asio/ip/tcp.hpp>
 #include <memory>
 #include <utility>
@@ -39,6 +40,14 @@ ABSL_FLAG(int, master_reconnect_timeout_ms, 1000,
           "Timeout for re-establishing connection to a replication master");
 ABSL_FLAG(bool, replica_partial_sync, true,
           "Use partial sync to reconnect when a replica connection is interrupted.");
+ABSL_FLAG(uint32_t, replica_full_sync_streams, 1,
+          "Number of connections each replication flow uses during full sync. Values above 1 "
+          "split the snapshot of every master shard over multiple parallel streams, which helps "
+          "on links with high bandwidth or high latency.");
+ABSL_FLAG(uint32_t, replica_apply_workers, 1,
+          "Number of fibers each replication flow uses to apply journal changes in stable sync. "
+          "Values above 1 apply changes of unrelated keys concurrently. Ignored when "
+          "enable_multi_shard_sync is set.");
 ABSL_DECLARE_FLAG(int32_t, port);
 
 namespace dfly {
@@ -697,6 +706,17 @@ io::Result<bool> DflyShardReplica::StartSyncFlow(BlockingCounter sb, Context* cn
 
   leftover_buf_->ConsumeInput(read_resp->left_in_buffer);
 
+  // Open additional streams for the full sync data of this flow.
+  parts_.clear();
+  if (is_full_sync && master_context_.version >= DflyVersion::VER3) {
+    unsigned num_streams =
+        std::clamp(absl::GetFlag(FLAGS_replica_full_sync_streams), 1u, kMaxFullSyncStreams);
+    for (unsigned part_id = 1; part_id < num_streams; ++part_id) {
+      auto& part = parts_.emplace_back(make_unique<DflyFlowPart>(server(), &service_));
+      RETURN_ON_ERR_T(make_unexpected, part->Start(master_context_, flow_id_, part_id, cntx));
+    }
+  }
+
   // We can not discard io_buf because it may contain data
   // besides the response we parsed. Therefore we pass it further to ReplicateDFFb.
   sync_fb_ = fb2::Fiber("shard_full_sync", &DflyShardReplica::FullSyncDflyFb, this,
@@ -714,6 +734,12 @@ error_code DflyShardReplica::StartStableSyncFlow(Context* cntx) {
     return std::make_error_code(errc::io_error);
   }
 
+  if (applier_)
+    applier_->Start();
+
+  // The master closes the part connections once the full sync completes.
+  parts_.clear();
+
   sync_fb_ =
       fb2::Fiber("shard_stable_sync_read", &DflyShardReplica::StableSyncDflyReadFb, this, cntx);
   if (use_multi_shard_exe_sync_) {
@@ -729,13 +755,18 @@ void DflyShardReplica::FullSyncDflyFb(std::string eof_token, BlockingCounter bc,
   io::PrefixSource ps{leftover_buf_->InputBuffer(), Sock()};
 
   RdbLoader loader(&service_);
-  loader.SetFullSyncCutCb([bc, ran = false]() mutable {
+  loader.SetFullSyncCutCb([this, bc, cntx, ran = false]() mutable {
     if (!ran) {
+      // The flow reached the cut only when the data of all its parts is loaded.
+      JoinParts(cntx);
       bc.Dec();
       ran = true;
     }
   });
 
+  // Data streamed over the parts must be in place before journal changes are applied on top.
+  loader.SetBeforeJournalCb([this, cntx] { return JoinParts(cntx); });
+
   // Load incoming rdb stream.
   if (std::error_code ec = loader.Load(&ps); ec) {
     cntx->ReportError(ec, "Error loading rdb format");
@@ -776,6 +807,13 @@ void DflyShardReplica::FullSyncDflyFb(std::string eof_token, BlockingCounter bc,
   VLOG(1) << "FullSyncDflyFb finished after reading " << loader.bytes_read() << " bytes";
 }
 
+error_code DflyShardReplica::JoinParts(Context* cntx) {
+  for (auto& part : parts_)
+    part->Join();
+
+  return cntx->IsCancelled() ? make_error_code(errc::operation_canceled) : error_code{};
+}
+
 void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
   // Check leftover from full sync.
   io::Bytes prefix{};
@@ -807,7 +845,10 @@ void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
 
     if (tx_data->opcode == journal::Op::PING) {
       force_ping_ = true;
-      journal_rec_executed_.fetch_add(1, std::memory_order_relaxed);
+      if (applier_)
+        applier_->Skip(1);
+      else
+        journal_rec_executed_.fetch_add(1, std::memory_order_relaxed);
     } else if (tx_data->opcode == journal::Op::EXEC) {
       if (use_multi_shard_exe_sync_) {
         InsertTxDataToShardResource(std::move(*tx_data));
@@ -815,7 +856,10 @@ void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
         // On no shard sync mode we execute multi commands once they are recieved, therefor when
         // receiving exec opcode, we only increase the journal counting.
         DCHECK_EQ(tx_data->commands.size(), 0u);
-        journal_rec_executed_.fetch_add(1, std::memory_order_relaxed);
+        if (applier_)
+          applier_->Skip(1);
+        else
+          journal_rec_executed_.fetch_add(1, std::memory_order_relaxed);
       }
     } else {
       if (use_multi_shard_exe_sync_) {
@@ -826,6 +870,9 @@ void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
     }
     waker_.notify();
   }
+
+  if (applier_)
+    applier_->Shutdown();
 }
 
 void Replica::RedisStreamAcksFb() {
@@ -893,6 +940,13 @@ DflyShardReplica::DflyShardReplica(ServerContext server_context, MasterContext m
       flow_id_(flow_id) {
   use_multi_shard_exe_sync_ = GetFlag(FLAGS_enable_multi_shard_sync);
   executor_ = std::make_unique<JournalExecutor>(service);
+
+  unsigned apply_workers = GetFlag(FLAGS_replica_apply_workers);
+  if (!use_multi_shard_exe_sync_ && apply_workers > 1) {
+    applier_ = std::make_unique<ParallelTxApplier>(service, apply_workers, [this](uint32_t cnt) {
+      journal_rec_executed_.fetch_add(cnt, std::memory_order_relaxed);
+    });
+  }
 }
 
 DflyShardReplica::~DflyShardReplica() {
@@ -904,6 +958,16 @@ void DflyShardReplica::ExecuteTxWithNoShardSync(TransactionData&& tx_data, Conte
     return;
   }
 
+  if (applier_) {
+    if (!tx_data.IsGlobalCmd()) {
+      applier_->Schedule(std::move(tx_data));
+      return;
+    }
+    // Global commands are synchronized with the other flows, so everything received before
+    // them must be applied first.
+    applier_->Drain();
+  }
+
   bool was_insert = tx_data.IsGlobalCmd() &&
                     multi_shard_exe_->InsertTxToSharedMap(tx_data.txid, tx_data.shard_cnt);
 
@@ -1123,14 +1187,87 @@ uint64_t DflyShardReplica::JournalExecutedCount() const {
 }
 
 void DflyShardReplica::JoinFlow() {
+  // The full sync fiber might join the parts, so it must be joined first.
   sync_fb_.JoinIfNeeded();
+  for (auto& part : parts_)
+    part->Join();
   acks_fb_.JoinIfNeeded();
   execution_fb_.JoinIfNeeded();
 }
 
 void DflyShardReplica::Cancel() {
   CloseSocket();
+  for (auto& part : parts_)
+    part->Cancel();
+  if (applier_)
+    applier_->Cancel();
   waker_.notifyAll();
 }
 
+DflyFlowPart::DflyFlowPart(ServerContext server_context, Service* service)
+    : ProtocolClient(std::move(server_context)), service_(*service) {
+}
+
+DflyFlowPart::~DflyFlowPart() {
+  Join();
+}
+
+error_code DflyFlowPart::Start(const MasterContext& master_context, uint32_t flow_id,
+                               uint32_t part_id, Context* cntx) {
+  RETURN_ON_ERR(ConnectAndAuth(absl::GetFlag(FLAGS_master_connect_timeout_ms) * 1ms, &cntx_));
+
+  std::string cmd = StrCat("DFLY FLOW ", master_context.master_repl_id, " ",
+                           master_context.dfly_session_id, " ", flow_id, " PART ", part_id);
+
+  ResetParser(/*server_mode=*/false);
+  leftover_buf_.emplace(128);
+  RETURN_ON_ERR(SendCommand(cmd));
+  auto read_resp = ReadRespReply(&*leftover_buf_);
+  if (!read_resp.has_value()) {
+    return read_resp.error();
+  }
+
+  PC_RETURN_ON_BAD_RESPONSE(CheckRespFirstTypes({RespExpr::STRING, RespExpr::STRING}));
+  PC_RETURN_ON_BAD_RESPONSE(ToSV(LastResponseArgs()[0].GetBuf()) == "FULL");
+
+  string eof_token{ToSV(LastResponseArgs()[1].GetBuf())};
+  leftover_buf_->ConsumeInput(read_resp->left_in_buffer);
+
+  load_fb_ = fb2::Fiber("shard_full_sync_part", &DflyFlowPart::LoadFb, this, std::move(eof_token),
+                        cntx);
+  return error_code{};
+}
+
+void DflyFlowPart::LoadFb(std::string eof_token, Context* cntx) {
+  io::PrefixSource ps{leftover_buf_->InputBuffer(), Sock()};
+
+  RdbLoader loader(&service_);
+  if (std::error_code ec = loader.Load(&ps); ec) {
+    cntx->ReportError(ec, "Error loading rdb format");
+    return;
+  }
+
+  io::PrefixSource chained_tail{loader.Leftover(), &ps};
+  unique_ptr<uint8_t[]> buf{new uint8_t[eof_token.size()]};
+  io::Result<size_t> res =
+      chained_tail.ReadAtLeast(io::MutableBytes{buf.get(), eof_token.size()}, eof_token.size());
+
+  if (!res || *res != eof_token.size() || memcmp(buf.get(), eof_token.data(), *res) != 0) {
+    cntx->ReportError(std::make_error_code(errc::protocol_error),
+                      "Error finding eof token in stream");
+    return;
+  }
+
+  leftover_buf_.reset();
+  VLOG(1) << "Full sync part finished after reading " << loader.bytes_read() << " bytes";
+}
+
+void DflyFlowPart::Join() {
+  load_fb_.JoinIfNeeded();
+}
+
+void DflyFlowPart::Cancel() {
+  CloseSocket();
+}
+
 }  // namespace dfly
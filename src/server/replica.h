@@ -30,6 +30,7 @@ class ConnectionContext;
 class JournalExecutor;
 struct JournalReader;
 class DflyShardReplica;
+class DflyFlowPart;
 
 // The attributes of the master we are connecting to.
 struct MasterContext {
@@ -191,6 +192,9 @@ class DflyShardReplica : public ProtocolClient {
   // Single flow full sync fiber spawned by StartFullSyncFlow.
   void FullSyncDflyFb(std::string eof_token, util::fb2::BlockingCounter block, Context* cntx);
 
+  // Waits until all the additional full sync streams of the flow are loaded.
+  std::error_code JoinParts(Context* cntx);
+
   // Single flow stable state sync fiber spawned by StartStableSyncFlow.
   void StableSyncDflyReadFb(Context* cntx);
 
@@ -219,6 +223,9 @@ class DflyShardReplica : public ProtocolClient {
 
   std::unique_ptr<JournalExecutor> executor_;
 
+  // Applies stable sync changes concurrently if replica_apply_workers is above 1.
+  std::unique_ptr<ParallelTxApplier> applier_;
+
   // The master instance has a LSN for each journal record. This counts
   // the number of journal records executed in this flow plus the initial
   // journal offset that we received in the transition from full sync
@@ -238,6 +245,36 @@ class DflyShardReplica : public ProtocolClient {
 
   std::shared_ptr<MultiShardExecution> multi_shard_exe_;
   uint32_t flow_id_ = UINT32_MAX;  // Flow id if replica acts as a dfly flow.
+
+  // Additional connections that load a share of the full sync data of the flow.
+  // Kept open until the flow is destroyed, because the master treats their closing as the end
+  // of the replication.
+  std::vector<std::unique_ptr<DflyFlowPart>> parts_;
+};
+
+// An additional full sync connection of a DflyShardReplica. The master spreads the snapshot data
+// of the flow over the flow connection and its parts, while journal changes are sent only over
+// the flow connection. Each part carries a standalone rdb stream followed by the eof token.
+class DflyFlowPart : public ProtocolClient {
+ public:
+  DflyFlowPart(ServerContext server_context, Service* service);
+  ~DflyFlowPart();
+
+  // Registers the connection as part `part_id` of the flow and starts loading its stream.
+  std::error_code Start(const MasterContext& master_context, uint32_t flow_id, uint32_t part_id,
+                        Context* cntx);
+
+  // Waits until the part stream has been loaded or failed.
+  void Join();
+
+  void Cancel();
+
+ private:
+  void LoadFb(std::string eof_token, Context* cntx);
+
+  Service& service_;
+  std::optional<base::IoBuf> leftover_buf_;
+  Fiber load_fb_;
 };
 
 }  // namespace dfly
@@ -11,6 +11,7 @@
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_split.h>
 
+#include <algorithm>
 #include <regex>
 #include <string>
 
@@ -22,6 +23,10 @@
 #include "server/server_state.h"
 #include "server/transaction.h"
 
+extern "C" {
+#include "redis/util.h"
+}
+
 ABSL_FLAG(std::string, default_lua_flags, "",
           "Configure default flags for running Lua scripts: \n - Use 'allow-undeclared-keys' to "
           "allow accessing undeclared keys, \n - Use 'disable-atomicity' to allow "
@@ -237,6 +242,14 @@ io::Result<string, GenericError> ScriptMgr::Insert(string_view body, Interpreter
     return string{sha};
   }
 
+  // Another interpreter already compiled the script, so load its bytecode.
+  if (auto data = Find(sha); data && !data->bytecode.empty()) {
+    string error;
+    if (interpreter->AddPrecompiled(sha, data->bytecode, &error) != Interpreter::COMPILE_ERR)
+      return string{sha};
+    LOG(DFATAL) << "Failed to load precompiled script " << sha << ": " << error;
+  }
+
   string_view orig_body = body;
 
   auto params_opt = DeduceParams(&body);
@@ -253,8 +266,8 @@ io::Result<string, GenericError> ScriptMgr::Insert(string_view body, Interpreter
       body = *async_body;
   }
 
-  string result;
-  Interpreter::AddResult add_result = interpreter->AddFunction(sha, body, &result);
+  string result, bytecode;
+  Interpreter::AddResult add_result = interpreter->AddFunction(sha, body, &result, &bytecode);
   if (add_result == Interpreter::COMPILE_ERR)
     return nonstd::make_unexpected(GenericError{std::move(result)});
 
@@ -265,6 +278,7 @@ io::Result<string, GenericError> ScriptMgr::Insert(string_view body, Interpreter
     it->second.body = CharBufFromSV(body);
     if (body != orig_body)
       it->second.orig_body = CharBufFromSV(orig_body);
+    it->second.bytecode = std::move(bytecode);
   }
 
   UpdateScriptCaches(sha, it->second);
@@ -278,19 +292,18 @@ optional<ScriptMgr::ScriptData> ScriptMgr::Find(std::string_view sha) const {
 
   lock_guard lk{mu_};
   if (auto it = db_.find(sha); it != db_.end() && it->second.body)
-    return ScriptData{it->second, it->second.body.get(), {}};
+    return ScriptData{it->second, it->second.body.get(), {}, it->second.bytecode};
 
   return std::nullopt;
 }
 
 void ScriptMgr::FlushAllScript() {
-  lock_guard lk{mu_};
-  db_.clear();
+  {
+    lock_guard lk{mu_};
+    db_.clear();
+  }
 
-  shard_set->pool()->AwaitFiberOnAll([](auto* pb) {
-    ServerState* ss = ServerState::tlocal();
-    ss->ResetInterpreter();
-  });
+  ResetInterpreters();
 }
 
 vector<pair<string, ScriptMgr::ScriptData>> ScriptMgr::GetAll() const {
@@ -308,6 +321,15 @@ vector<pair<string, ScriptMgr::ScriptData>> ScriptMgr::GetAll() const {
   return res;
 }
 
+void ScriptMgr::ResetInterpreters() const {
+  // Must not be called under mu_: resetting waits for the borrowed interpreters to be returned,
+  // and their borrowers may wait for mu_ in Insert(), Find() or LoadFunction().
+  shard_set->pool()->AwaitFiberOnAll([](auto* pb) {
+    ServerState* ss = ServerState::tlocal();
+    ss->ResetInterpreter();
+  });
+}
+
 void ScriptMgr::UpdateScriptCaches(ScriptKey sha, ScriptParams params) const {
   shard_set->pool()->Await([&sha, &params](auto index, auto* pb) {
     ServerState::tlocal()->SetScriptParams(sha, params);
@@ -318,6 +340,289 @@ bool ScriptMgr::AreGlobalByDefault() const {
   return default_params_.undeclared_keys && default_params_.atomic;
 }
 
+// Parses the "#!lua name=<library>" header of a function library and returns the library name.
+io::Result<string, GenericError> ParseLibraryName(string_view code) {
+  string_view header = code.substr(0, code.find('\n'));
+  if (!absl::ConsumePrefix(&header, "#!"))
+    return nonstd::make_unexpected(GenericError{"Missing library metadata"});
+
+  vector<string_view> parts = absl::StrSplit(header, ' ', absl::SkipEmpty());
+  if (parts.empty() || !absl::EqualsIgnoreCase(parts[0], "lua")) {
+    string engine{parts.empty() ? "" : parts[0]};
+    return nonstd::make_unexpected(GenericError{"Engine '" + engine + "' not found"});
+  }
+
+  string name;
+  for (string_view part : absl::MakeSpan(parts).subspan(1)) {
+    if (!absl::ConsumePrefix(&part, "name="))
+      return nonstd::make_unexpected(GenericError{"Invalid metadata value given: " + string{part}});
+    name = part;
+  }
+
+  if (name.empty())
+    return nonstd::make_unexpected(GenericError{"Library name was not given"});
+
+  auto valid_char = [](char c) { return absl::ascii_isalnum(c) || c == '_'; };
+  if (!all_of(name.begin(), name.end(), valid_char)) {
+    return nonstd::make_unexpected(GenericError{
+        "Library names can only contain letters, numbers, or underscores(_)"});
+  }
+
+  return name;
+}
+
+// Returns the library code without the header, keeping its newline so that the line numbers in
+// errors match the original code.
+string_view LibraryBody(string_view code) {
+  size_t pos = code.find('\n');
+  return pos == string_view::npos ? string_view{} : code.substr(pos);
+}
+
+void ScriptMgr::FunctionCmd(CmdArgList args, ConnectionContext* cntx) {
+  ToUpper(&args[0]);
+  string_view subcmd = ArgS(args, 0);
+
+  if (subcmd == "HELP") {
+    string_view kHelp[] = {
+        "FUNCTION <subcommand> [<arg> [value] [opt] ...]",
+        "Subcommands are:",
+        "LOAD [REPLACE] <library code>",
+        "   Create a new library with the given library name and code.",
+        "DELETE <library name>",
+        "   Delete the given library.",
+        "LIST [LIBRARYNAME PATTERN] [WITHCODE]",
+        "   Return general information on all the libraries.",
+        "FLUSH [ASYNC|SYNC]",
+        "   Delete all the libraries.",
+        "HELP",
+        "   Prints this help."};
+    auto rb = static_cast<RedisReplyBuilder*>(cntx->reply_builder());
+    return rb->SendSimpleStrArr(kHelp);
+  }
+
+  if (subcmd == "LOAD" && args.size() > 1)
+    return FunctionLoadCmd(args, cntx);
+
+  if (subcmd == "DELETE" && args.size() == 2)
+    return FunctionDeleteCmd(args, cntx);
+
+  if (subcmd == "FLUSH" && args.size() <= 2)
+    return FunctionFlushCmd(args, cntx);
+
+  if (subcmd == "LIST")
+    return FunctionListCmd(args, cntx);
+
+  string err = absl::StrCat("Unknown subcommand or wrong number of arguments for '", subcmd,
+                            "'. Try FUNCTION HELP.");
+  cntx->SendError(err, kSyntaxErrType);
+}
+
+void ScriptMgr::FunctionLoadCmd(CmdArgList args, ConnectionContext* cntx) {
+  bool replace = false;
+  if (args.size() == 3 && absl::EqualsIgnoreCase(ArgS(args, 1), "REPLACE"))
+    replace = true;
+  else if (args.size() != 2)
+    return cntx->SendError(kSyntaxErr);
+
+  auto res = LoadLibrary(ArgS(args, args.size() - 1), replace);
+  if (!res)
+    return cntx->SendError(res.error().Format());
+
+  // Schedule empty callback inorder to journal command via transaction framework.
+  cntx->transaction->ScheduleSingleHop([](auto* t, auto* shard) { return OpStatus::OK; });
+
+  auto rb = static_cast<RedisReplyBuilder*>(cntx->reply_builder());
+  return rb->SendBulkString(res.value());
+}
+
+void ScriptMgr::FunctionDeleteCmd(CmdArgList args, ConnectionContext* cntx) {
+  {
+    lock_guard lk{mu_};
+    auto it = libraries_.find(ArgS(args, 1));
+    if (it == libraries_.end())
+      return cntx->SendError("Library not found");
+
+    for (const auto& function : it->second.functions)
+      functions_.erase(function.name);
+    libraries_.erase(it);
+  }
+
+  // Interpreters still hold the functions of the library.
+  ResetInterpreters();
+
+  // Schedule empty callback inorder to journal command via transaction framework.
+  cntx->transaction->ScheduleSingleHop([](auto* t, auto* shard) { return OpStatus::OK; });
+
+  return cntx->SendOk();
+}
+
+void ScriptMgr::FunctionFlushCmd(CmdArgList args, ConnectionContext* cntx) {
+  if (args.size() == 2) {
+    string_view mode = ArgS(args, 1);
+    if (!absl::EqualsIgnoreCase(mode, "ASYNC") && !absl::EqualsIgnoreCase(mode, "SYNC"))
+      return cntx->SendError(kSyntaxErr);
+  }
+
+  FlushAllLibraries();
+
+  // Schedule empty callback inorder to journal command via transaction framework.
+  cntx->transaction->ScheduleSingleHop([](auto* t, auto* shard) { return OpStatus::OK; });
+
+  return cntx->SendOk();
+}
+
+void ScriptMgr::FunctionListCmd(CmdArgList args, ConnectionContext* cntx) const {
+  bool with_code = false;
+  string_view pattern;
+  for (size_t i = 1; i < args.size(); ++i) {
+    string_view arg = ArgS(args, i);
+    if (absl::EqualsIgnoreCase(arg, "WITHCODE")) {
+      with_code = true;
+    } else if (absl::EqualsIgnoreCase(arg, "LIBRARYNAME") && i + 1 < args.size()) {
+      pattern = ArgS(args, ++i);
+    } else {
+      return cntx->SendError(kSyntaxErr);
+    }
+  }
+
+  vector<pair<string, LibraryData>> libraries = GetAllLibraries();
+  if (!pattern.empty()) {
+    auto not_matching = [pattern](const auto& library) {
+      const string& name = library.first;
+      return stringmatchlen(pattern.data(), pattern.size(), name.data(), name.size(), 0) == 0;
+    };
+    libraries.erase(remove_if(libraries.begin(), libraries.end(), not_matching), libraries.end());
+  }
+
+  auto rb = static_cast<RedisReplyBuilder*>(cntx->reply_builder());
+  rb->StartArray(libraries.size());
+  for (const auto& [name, data] : libraries) {
+    rb->StartCollection(with_code ? 4 : 3, RedisReplyBuilder::MAP);
+    rb->SendBulkString("library_name");
+    rb->SendBulkString(name);
+    rb->SendBulkString("engine");
+    rb->SendBulkString("LUA");
+    rb->SendBulkString("functions");
+    rb->StartArray(data.functions.size());
+    for (const auto& function : data.functions) {
+      rb->StartCollection(3, RedisReplyBuilder::MAP);
+      rb->SendBulkString("name");
+      rb->SendBulkString(function.name);
+      rb->SendBulkString("description");
+      rb->SendNull();
+      rb->SendBulkString("flags");
+      rb->SendStringArr(function.flags, RedisReplyBuilder::SET);
+    }
+    if (with_code) {
+      rb->SendBulkString("library_code");
+      rb->SendBulkString(data.code);
+    }
+  }
+}
+
+io::Result<string, GenericError> ScriptMgr::LoadLibrary(string_view code, bool replace) {
+  auto name = ParseLibraryName(code);
+  if (!name)
+    return name.get_unexpected();
+
+  // Run the library in a separate interpreter, so that a failing library does not leave
+  // functions in the interpreters that serve commands.
+  Interpreter interpreter;
+  vector<Interpreter::FunctionInfo> functions;
+  string error;
+  if (interpreter.AddLibrary(LibraryBody(code), &functions, &error) != Interpreter::ADD_OK)
+    return nonstd::make_unexpected(GenericError{std::move(error)});
+
+  vector<pair<ScriptKey, ScriptParams>> function_params;
+  for (const auto& function : functions) {
+    ScriptParams params = default_params_;
+    for (const string& flag : function.flags) {
+      if (auto err = ScriptParams::ApplyFlags(flag, &params); err)
+        return nonstd::make_unexpected(err);
+    }
+
+    char sha[41];
+    Interpreter::FunctionSha1(function.name, sha);
+    function_params.emplace_back(string_view{sha, 40}, params);
+  }
+
+  bool replaced = false;
+  {
+    lock_guard lk{mu_};
+    auto it = libraries_.find(*name);
+    if (it != libraries_.end() && !replace)
+      return nonstd::make_unexpected(GenericError{"Library '" + *name + "' already exists"});
+
+    for (const auto& function : functions) {
+      auto fit = functions_.find(function.name);
+      if (fit != functions_.end() && fit->second != *name) {
+        return nonstd::make_unexpected(
+            GenericError{"Function " + function.name + " already exists"});
+      }
+    }
+
+    if (it != libraries_.end()) {
+      for (const auto& function : it->second.functions)
+        functions_.erase(function.name);
+      replaced = true;
+    }
+
+    for (const auto& function : functions)
+      functions_[function.name] = *name;
+    libraries_[*name] = LibraryData{string{code}, std::move(functions)};
+
+    // Still under the lock, so that no thread loads the library before its params are cached.
+    shard_set->pool()->Await([&](auto index, auto* pb) {
+      for (const auto& [sha, params] : function_params)
+        ServerState::tlocal()->SetScriptParams(sha, params);
+    });
+  }
+
+  // Interpreters hold the functions of the previous version of the library. Until they are reset,
+  // the previous version may still run, with the params of the new one.
+  if (replaced)
+    ResetInterpreters();
+
+  return name;
+}
+
+GenericError ScriptMgr::LoadFunction(string_view name, Interpreter* interpreter) const {
+  string code;
+  {
+    lock_guard lk{mu_};
+    auto it = functions_.find(name);
+    if (it == functions_.end())
+      return GenericError{"Function not found"};
+    code = libraries_.at(it->second).code;
+  }
+
+  vector<Interpreter::FunctionInfo> functions;
+  string error;
+  if (interpreter->AddLibrary(LibraryBody(code), &functions, &error) != Interpreter::ADD_OK) {
+    LOG(DFATAL) << "Failed to load the library of function " << name << ": " << error;
+    return GenericError{std::move(error)};
+  }
+
+  return {};
+}
+
+vector<pair<string, ScriptMgr::LibraryData>> ScriptMgr::GetAllLibraries() const {
+  lock_guard lk{mu_};
+  vector<pair<string, LibraryData>> res{libraries_.begin(), libraries_.end()};
+  sort(res.begin(), res.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+  return res;
+}
+
+void ScriptMgr::FlushAllLibraries() {
+  {
+    lock_guard lk{mu_};
+    libraries_.clear();
+    functions_.clear();
+  }
+
+  ResetInterpreters();
+}
+
 GenericError ScriptMgr::ScriptParams::ApplyFlags(string_view config, ScriptParams* params) {
   auto parts = absl::StrSplit(config, absl::ByAnyChar(",; "), absl::SkipEmpty());
   for (auto flag : parts) {
@@ -331,8 +636,14 @@ GenericError ScriptMgr::ScriptParams::ApplyFlags(string_view config, ScriptParam
       continue;
     }
 
-    if (flag == "no-writes") {  // Used by Redis.
-      // TODO: lock read-only.
+    if (flag == "no-writes") {
+      params->read_only = true;
+      continue;
+    }
+
+    // Redis flags that do not change how scripts run in Dragonfly.
+    if (flag == "allow-oom" || flag == "allow-stale" || flag == "no-cluster" ||
+        flag == "allow-cross-slot-keys") {
       continue;
     }
 
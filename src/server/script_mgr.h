@@ -9,12 +9,12 @@
 #include <array>
 #include <optional>
 
+#include "core/interpreter.h"
 #include "server/conn_context.h"
 
 namespace dfly {
 
 class EngineShardSet;
-class Interpreter;
 
 // This class has a state through the lifetime of a server because it manipulates scripts
 class ScriptMgr {
@@ -22,17 +22,26 @@ class ScriptMgr {
   struct ScriptParams {
     bool atomic = true;            // Whether script must run atomically.
     bool undeclared_keys = false;  // Whether script accesses undeclared keys.
+    bool read_only = false;        // Whether script is not allowed to run write commands.
 
     // Return GenericError if some flag was invalid.
     // Valid flags are:
     // - allow-undeclared-keys -> undeclared_keys=true
     // - disable-atomicity     -> atomic=false
+    // - no-writes             -> read_only=true
     static GenericError ApplyFlags(std::string_view flags, ScriptParams* params);
   };
 
   struct ScriptData : public ScriptParams {
     std::string body;       // script source code present in lua interpreter
     std::string orig_body;  // original code, before removing header and adding async
+    std::string bytecode;   // precompiled body, loaded by interpreters instead of compiling it
+  };
+
+  // Function library loaded with FUNCTION LOAD.
+  struct LibraryData {
+    std::string code;  // library code, starting with the "#!lua name=<library>" header
+    std::vector<Interpreter::FunctionInfo> functions;
   };
 
   struct ScriptKey : public std::array<char, 40> {
@@ -59,6 +68,22 @@ class ScriptMgr {
   // Returns if scripts run as global transactions by default
   bool AreGlobalByDefault() const;
 
+  // Handles FUNCTION subcommands.
+  void FunctionCmd(CmdArgList args, ConnectionContext* cntx);
+
+  // Load function library and return its name. An existing library with the same name is
+  // replaced only if replace is set.
+  io::Result<std::string, GenericError> LoadLibrary(std::string_view code, bool replace);
+
+  // Load the library of the function into the interpreter, after which it runs the function by
+  // the id from Interpreter::FunctionSha1.
+  GenericError LoadFunction(std::string_view name, Interpreter* interpreter) const;
+
+  // Returns all function libraries with their names.
+  std::vector<std::pair<std::string, LibraryData>> GetAllLibraries() const;
+
+  void FlushAllLibraries();
+
  private:
   void ExistsCmd(CmdArgList args, ConnectionContext* cntx) const;
   void FlushCmd(CmdArgList args, ConnectionContext* cntx);
@@ -67,17 +92,28 @@ class ScriptMgr {
   void ListCmd(ConnectionContext* cntx) const;
   void LatencyCmd(ConnectionContext* cntx) const;
 
+  void FunctionLoadCmd(CmdArgList args, ConnectionContext* cntx);
+  void FunctionDeleteCmd(CmdArgList args, ConnectionContext* cntx);
+  void FunctionFlushCmd(CmdArgList args, ConnectionContext* cntx);
+  void FunctionListCmd(CmdArgList args, ConnectionContext* cntx) const;
+
   void UpdateScriptCaches(ScriptKey sha, ScriptParams params) const;
 
+  // Drop the scripts and functions loaded by the interpreters of all threads.
+  void ResetInterpreters() const;
+
  private:
   struct InternalScriptData : public ScriptParams {
     std::unique_ptr<char[]> body{};
     std::unique_ptr<char[]> orig_body{};
+    std::string bytecode{};  // compiled once and shared by the interpreters of all threads
   };
 
   ScriptParams default_params_;
 
   absl::flat_hash_map<ScriptKey, InternalScriptData> db_;
+  absl::flat_hash_map<std::string, LibraryData> libraries_;
+  absl::flat_hash_map<std::string, std::string> functions_;  // function name -> library name
   mutable Mutex mu_;
 };
 
@@ -249,6 +249,10 @@ unique_ptr<BaseAccessor> GetAccessor(const DbContext& db_cntx, const PrimeValue&
   DCHECK(pv.ObjType() == OBJ_HASH || pv.ObjType() == OBJ_JSON);
 
   if (pv.ObjType() == OBJ_JSON) {
+    if (pv.JsonEncoding() == kEncodingJsonFlat) {
+      return make_unique<JsonAccessor>(
+          JsonFromFlat(pv.GetFlatJson(), PMR_NS::get_default_resource()));
+    }
     DCHECK(pv.GetJson());
     return make_unique<JsonAccessor>(pv.GetJson());
   }
@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/types/span.h>
 
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -68,6 +69,10 @@ struct JsonAccessor : public BaseAccessor {
   explicit JsonAccessor(const JsonType* json) : json_{*json} {
   }
 
+  // Owns a json object that was decoded from the flat encoding.
+  explicit JsonAccessor(JsonType&& json) : owned_json_{std::move(json)}, json_{*owned_json_} {
+  }
+
   StringList GetStrings(std::string_view field) const override;
   VectorInfo GetVector(std::string_view field) const override;
   SearchDocData Serialize(const search::Schema& schema) const override;
@@ -82,6 +87,7 @@ struct JsonAccessor : public BaseAccessor {
   /// Parses `field` into a JSON path. Caches the results internally.
   JsonPathContainer* GetPath(std::string_view field) const;
 
+  std::optional<JsonType> owned_json_;  // must precede json_
   const JsonType& json_;
   mutable std::string buf_;
 
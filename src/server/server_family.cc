@@ -47,6 +47,7 @@ extern "C" {
 #include "server/error.h"
 #include "server/generic_family.h"
 #include "server/journal/journal.h"
+#include "server/journal/streamer.h"
 #include "server/main_service.h"
 #include "server/memory_cmd.h"
 #include "server/protocol_client.h"
@@ -1663,6 +1664,14 @@ static void MergeDbSliceStats(const DbSlice::Stats& src, Metrics* dest) {
 
   dest->events += src.events;
   dest->small_string_bytes += src.small_string_bytes;
+  dest->key_prefix_entries += src.key_prefix_entries;
+  dest->key_prefix_saved_bytes += src.key_prefix_saved_bytes;
+  dest->compressed_raw_bytes += src.compressed_raw_bytes;
+  dest->compressed_bytes += src.compressed_bytes;
+  dest->expiry_index_entries += src.expiry_index_entries;
+  dest->expiry_index_bytes += src.expiry_index_bytes;
+  dest->expiry_index_lag_ms = max(dest->expiry_index_lag_ms, src.expiry_index_lag_ms);
+  dest->admission_sketch_bytes += src.admission_sketch_bytes;
 }
 
 void ServerFamily::ResetStat() {
@@ -1715,6 +1724,7 @@ Metrics ServerFamily::GetMetrics() const {
     result.uptime = time(NULL) - this->start_time_;
     result.qps += uint64_t(ss->MovingSum6());
     result.facade_stats += *tl_facade_stats;
+    result.lua_memory_bytes += Interpreter::UsedThreadLocal();
 
     if (shard) {
       result.heap_used_bytes += shard->UsedMemory();
@@ -1729,8 +1739,12 @@ Metrics ServerFamily::GetMetrics() const {
       if (shard->search_indices())
         result.search_stats += shard->search_indices()->GetStats();
 
+      result.snapshot_stats += SliceSnapshot::GetThreadLocalStats();
+      result.journal_stream_stats += JournalStreamer::GetThreadLocalStats();
+
       result.traverse_ttl_per_sec += shard->GetMovingSum6(EngineShard::TTL_TRAVERSE);
       result.delete_ttl_per_sec += shard->GetMovingSum6(EngineShard::TTL_DELETE);
+      result.evicted_keys_per_sec += shard->GetMovingSum6(EngineShard::EVICTED);
       if (result.tx_queue_len < shard->txq()->size())
         result.tx_queue_len = shard->txq()->size();
     }
@@ -1744,6 +1758,7 @@ Metrics ServerFamily::GetMetrics() const {
   result.qps /= 6;
   result.traverse_ttl_per_sec /= 6;
   result.delete_ttl_per_sec /= 6;
+  result.evicted_keys_per_sec /= 6;
 
   bool is_master = ServerState::tlocal() && ServerState::tlocal()->is_master;
   if (is_master)
@@ -1829,6 +1844,9 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("used_memory_rss_human", HumanReadableNumBytes(rss));
     append("used_memory_peak_rss", rss_mem_peak.load(memory_order_relaxed));
 
+    append("used_memory_lua", m.lua_memory_bytes);
+    append("used_memory_lua_human", HumanReadableNumBytes(m.lua_memory_bytes));
+
     append("comitted_memory", GetMallocCurrentCommitted());
 
     append("maxmemory", max_memory_limit);
@@ -1853,6 +1871,15 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("listpack_blobs", total.listpack_blob_cnt);
     append("listpack_bytes", total.listpack_bytes);
     append("small_string_bytes", m.small_string_bytes);
+    append("key_prefix_entries", m.key_prefix_entries);
+    append("key_prefix_saved_bytes", m.key_prefix_saved_bytes);
+    append("compressed_strings_raw_bytes", m.compressed_raw_bytes);
+    append("compressed_strings_bytes", m.compressed_bytes);
+    append("compressed_strings_ratio",
+           m.compressed_bytes ? double(m.compressed_raw_bytes) / m.compressed_bytes : 1.0);
+    append("expiry_index_entries", m.expiry_index_entries);
+    append("expiry_index_bytes", m.expiry_index_bytes);
+    append("admission_sketch_bytes", m.admission_sketch_bytes);
     append("pipeline_cache_bytes", m.facade_stats.conn_stats.pipeline_cmd_cache_bytes);
     append("dispatch_queue_bytes", m.facade_stats.conn_stats.dispatch_queue_bytes);
     append("dispatch_queue_subscriber_bytes",
@@ -1901,13 +1928,18 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("instantaneous_output_kbps", -1);
     append("rejected_connections", -1);
     append("expired_keys", m.events.expired_keys);
+    append("expiry_index_lag_ms", m.expiry_index_lag_ms);
     append("evicted_keys", m.events.evicted_keys);
+    append("evicted_keys_per_sec", m.evicted_keys_per_sec);
     append("hard_evictions", m.events.hard_evictions);
     append("garbage_checked", m.events.garbage_checked);
     append("garbage_collected", m.events.garbage_collected);
     append("bump_ups", m.events.bumpups);
     append("stash_unloaded", m.events.stash_unloaded);
+    append("segments_split_ahead", m.events.split_ahead);
     append("oom_rejections", m.events.insertion_rejections);
+    append("admission_rejections", m.events.admission_rejections);
+    append("oom_deny_rejections", m.coordinator_stats.oom_deny_rejections);
     append("traverse_ttl_sec", m.traverse_ttl_per_sec);
     append("delete_ttl_sec", m.delete_ttl_per_sec);
     append("keyspace_hits", m.events.hits);
@@ -1962,6 +1994,10 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
 
     append("saving", is_saving);
     append("current_save_duration_sec", curent_durration_sec);
+    append("snapshot_keys_total", m.snapshot_stats.keys_total);
+    append("snapshot_keys_serialized", m.snapshot_stats.keys_serialized);
+    append("snapshot_throttled_total", m.snapshot_stats.throttled_cnt);
+    append("snapshot_throttled_usec", m.snapshot_stats.throttled_usec);
 
     for (const auto& k_v : save_info.freq_map) {
       append(StrCat("rdb_", k_v.first), k_v.second);
@@ -2016,6 +2052,9 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
                                           ",state=", r.state, ",lag=", r.lsn_lag));
       }
       append("master_replid", master_id_);
+      append("journal_stream_writes", m.journal_stream_stats.writes);
+      append("journal_stream_bytes", m.journal_stream_stats.bytes_raw);
+      append("journal_stream_sent_bytes", m.journal_stream_stats.bytes_sent);
     } else {
       append("role", "replica");
 
@@ -79,7 +79,9 @@ struct Metrics {
   TieredStats tiered_stats;          // stats for tiered storage
   IoMgrStats disk_stats;             // disk stats for io_mgr
   SearchStats search_stats;
-  ServerState::Stats coordinator_stats;  // stats on transaction running
+  SnapshotStats snapshot_stats;             // progress and throttling of running snapshots
+  JournalStreamStats journal_stream_stats;  // journal streaming to replicas and migrations
+  ServerState::Stats coordinator_stats;     // stats on transaction running
   PeakStats peak_stats;
 
   size_t uptime = 0;
@@ -87,8 +89,18 @@ struct Metrics {
 
   size_t heap_used_bytes = 0;
   size_t small_string_bytes = 0;
+  size_t lua_memory_bytes = 0;  // memory of the lua interpreters on all threads.
+  size_t key_prefix_entries = 0;
+  size_t key_prefix_saved_bytes = 0;
+  size_t compressed_raw_bytes = 0;
+  size_t compressed_bytes = 0;
+  size_t expiry_index_entries = 0;
+  size_t expiry_index_bytes = 0;
+  uint64_t expiry_index_lag_ms = 0;
+  size_t admission_sketch_bytes = 0;
   uint32_t traverse_ttl_per_sec = 0;
   uint32_t delete_ttl_per_sec = 0;
+  uint32_t evicted_keys_per_sec = 0;
   uint64_t fiber_switch_cnt = 0;
   uint64_t fiber_switch_delay_usec = 0;
 
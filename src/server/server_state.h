@@ -118,6 +118,9 @@ class ServerState {  // public struct - to allow initialization.
 
     uint64_t blocked_on_interpreter = 0;
 
+    // Write commands rejected because the used memory crossed --oom_deny_ratio.
+    uint64_t oom_deny_rejections = 0;
+
     std::valarray<uint64_t> tx_width_freq_arr;
   };
 
@@ -1570,4 +1570,12 @@ int32_t SetFamily::FieldExpireTime(const DbContext& db_context, const PrimeValue
   return GetExpiry(db_context, st, field);
 }
 
+bool SetFamily::IsMember(const DbContext& db_context, const PrimeValue& pv,
+                         std::string_view member) {
+  DCHECK_EQ(OBJ_SET, pv.ObjType());
+
+  SetType st{pv.RObjPtr(), pv.Encoding()};
+  return IsInSet(db_context, st, member);
+}
+
 }  // namespace dfly
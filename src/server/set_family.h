@@ -33,6 +33,9 @@ class SetFamily {
   static int32_t FieldExpireTime(const DbContext& db_context, const PrimeValue& pv,
                                  std::string_view field);
 
+  // Returns true if member belongs to the set held by pv.
+  static bool IsMember(const DbContext& db_context, const PrimeValue& pv, std::string_view member);
+
  private:
 };
 
@@ -8,6 +8,7 @@
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "core/heap_size.h"
 #include "server/db_slice.h"
@@ -16,14 +17,26 @@
 #include "server/rdb_extensions.h"
 #include "server/rdb_save.h"
 
+ABSL_FLAG(float, snapshot_cpu_budget, 1.0,
+          "Maximal fraction of each heartbeat tick that snapshot iteration may take on a shard "
+          "thread while the shard serves foreground commands. 1.0 disables throttling.");
+
+ABSL_DECLARE_FLAG(uint32_t, hz);
+
 namespace dfly {
 
 using namespace std;
 using namespace util;
 using namespace chrono_literals;
+using absl::GetFlag;
 
 namespace {
 thread_local absl::flat_hash_set<SliceSnapshot*> tl_slice_snapshots;
+
+// Cumulative throttling stats, outlive the snapshots themselves.
+thread_local uint64_t tl_throttled_cnt = 0;
+thread_local uint64_t tl_throttled_usec = 0;
+
 }  // namespace
 
 size_t SliceSnapshot::DbRecord::size() const {
@@ -52,6 +65,17 @@ bool SliceSnapshot::IsSnaphotInProgress() {
   return tl_slice_snapshots.size() > 0;
 }
 
+SnapshotStats SliceSnapshot::GetThreadLocalStats() {
+  SnapshotStats res;
+  for (SliceSnapshot* snapshot : tl_slice_snapshots) {
+    res.keys_total += snapshot->keys_total_;
+    res.keys_serialized += snapshot->stats_.loop_serialized + snapshot->stats_.side_saved;
+  }
+  res.throttled_cnt = tl_throttled_cnt;
+  res.throttled_usec = tl_throttled_usec;
+  return res;
+}
+
 void SliceSnapshot::Start(bool stream_journal, const Cancellation* cll) {
   DCHECK(!snapshot_fb_.IsJoinable());
 
@@ -95,6 +119,7 @@ void SliceSnapshot::StartIncremental(Context* cntx, LSN start_lsn) {
         // The replica sends the LSN of the next entry is wants to receive.
         while (!cntx->IsCancelled() && journal->IsLSNInBuffer(lsn)) {
           serializer_->WriteJournalEntry(journal->GetEntry(lsn));
+          journal_in_buffer_ = true;
           PushSerializedToChannel(false);
           lsn++;
         }
@@ -114,6 +139,7 @@ void SliceSnapshot::StartIncremental(Context* cntx, LSN start_lsn) {
           {
             FiberAtomicGuard fg;
             serializer_->SendFullSyncCut();
+            cut_in_buffer_ = true;
           }
           auto journal_cb = absl::bind_front(&SliceSnapshot::OnJournalEntry, this);
           journal_cb_id_ = journal->RegisterOnChange(std::move(journal_cb));
@@ -136,6 +162,7 @@ void SliceSnapshot::Stop() {
   if (journal_cb_id_) {
     auto* journal = db_slice_->shard_owner()->journal();
     serializer_->SendJournalOffset(journal->GetLsn());
+    journal_in_buffer_ = true;
     journal->UnregisterOnChange(journal_cb_id_);
   }
 
@@ -180,6 +207,11 @@ void SliceSnapshot::IterateBucketsFb(const Cancellation* cll) {
     ThisFiber::SetName(std::move(fiber_name));
   }
 
+  for (const auto& db : db_array_) {
+    if (db)
+      keys_total_ += db->prime.size();
+  }
+
   PrimeTable::Cursor cursor;
   for (DbIndex db_indx = 0; db_indx < db_array_.size(); ++db_indx) {
     if (cll->IsCancelled())
@@ -197,9 +229,11 @@ void SliceSnapshot::IterateBucketsFb(const Cancellation* cll) {
       if (cll->IsCancelled())
         return;
 
+      uint64_t start_ns = absl::GetCurrentTimeNanos();
       PrimeTable::Cursor next =
           pt->Traverse(cursor, absl::bind_front(&SliceSnapshot::BucketSaveCb, this));
       cursor = next;
+      ThrottleIfNeeded(absl::GetCurrentTimeNanos() - start_ns);
       PushSerializedToChannel(false);
 
       if (stats_.loop_serialized >= last_yield + 100) {
@@ -220,6 +254,7 @@ void SliceSnapshot::IterateBucketsFb(const Cancellation* cll) {
 
   CHECK(!serialize_bucket_running_);
   CHECK(!serializer_->SendFullSyncCut());
+  cut_in_buffer_ = true;
   PushSerializedToChannel(true);
 
   // serialized + side_saved must be equal to the total saved.
@@ -295,7 +330,11 @@ bool SliceSnapshot::PushSerializedToChannel(bool force) {
 
   auto id = rec_id_++;
   DVLOG(2) << "Pushed " << id;
-  DbRecord db_rec{.id = id, .value = std::move(sfile.val)};
+  DbRecord db_rec{.id = id,
+                  .value = std::move(sfile.val),
+                  .has_journal = journal_in_buffer_,
+                  .has_full_sync_cut = cut_in_buffer_};
+  journal_in_buffer_ = cut_in_buffer_ = false;
 
   dest_->Push(std::move(db_rec));
 
@@ -331,6 +370,7 @@ void SliceSnapshot::OnJournalEntry(const journal::JournalItem& item, bool await)
     return;
 
   serializer_->WriteJournalEntry(item.data);
+  journal_in_buffer_ = true;
 
   if (await) {
     // This is the only place that flushes in streaming mode
@@ -339,6 +379,37 @@ void SliceSnapshot::OnJournalEntry(const journal::JournalItem& item, bool await)
   }
 }
 
+void SliceSnapshot::ThrottleIfNeeded(uint64_t busy_ns) {
+  const float budget = GetFlag(FLAGS_snapshot_cpu_budget);
+  if (budget >= 1.0)
+    return;
+
+  const uint64_t window_ns = 1'000'000'000ULL / std::max<uint32_t>(1, GetFlag(FLAGS_hz));
+  const EngineShard::Stats& shard_stats = db_slice_->shard_owner()->stats();
+  uint64_t now = absl::GetCurrentTimeNanos();
+
+  throttle_.busy_ns += busy_ns;
+  uint64_t elapsed = now - throttle_.window_start_ns;
+  if (elapsed < window_ns) {
+    if (throttle_.busy_ns <= uint64_t(window_ns * std::max(budget, 0.0f)))
+      return;
+
+    // Adapt to the foreground load: if no transactions ran on the shard during this window,
+    // there is no one to give way to and we continue at full speed.
+    if (shard_stats.poll_execution_total != throttle_.fg_polls) {
+      uint64_t sleep_ns = window_ns - elapsed;
+      ThisFiber::SleepFor(chrono::nanoseconds(sleep_ns));
+      ++tl_throttled_cnt;
+      tl_throttled_usec += sleep_ns / 1000;
+      now = absl::GetCurrentTimeNanos();
+    }
+  }
+
+  throttle_.window_start_ns = now;
+  throttle_.busy_ns = 0;
+  throttle_.fg_polls = shard_stats.poll_execution_total;
+}
+
 void SliceSnapshot::CloseRecordChannel() {
   CHECK(!serialize_bucket_running_);
   // Make sure we close the channel only once with a CAS check.
@@ -46,12 +46,23 @@ struct Entry;
 // and submitting all values to an output channel.
 // In journal streaming mode, the snapshot continues submitting changes
 // over the channel until explicitly stopped.
+//
+// IterateBucketsFb competes with foreground commands on the shard thread. When
+// snapshot_cpu_budget is below 1, the iteration is paced so that it does not use more than
+// that fraction of each heartbeat tick while the shard serves foreground transactions.
+// OnDbChange serialization is not throttled, as it must complete before the bucket changes.
 class SliceSnapshot {
  public:
   struct DbRecord {
     uint64_t id;
     std::string value;
 
+    // Set if the record contains journal entries or the full sync cut. Such records must stay
+    // ordered with respect to all the records before them, while records with bucket data only
+    // can be spread over multiple streams.
+    bool has_journal = false;
+    bool has_full_sync_cut = false;
+
     size_t size() const;
   };
 
@@ -63,6 +74,9 @@ class SliceSnapshot {
   static size_t GetThreadLocalMemoryUsage();
   static bool IsSnaphotInProgress();
 
+  // Returns progress of the snapshots running on this thread and throttling stats.
+  static SnapshotStats GetThreadLocalStats();
+
   // Initialize snapshot, start bucket iteration fiber, register listeners.
   // In journal streaming mode it needs to be stopped by either Stop or Cancel.
   void Start(bool stream_journal, const Cancellation* cll);
@@ -110,6 +124,10 @@ class SliceSnapshot {
   // Close dest channel if not closed yet.
   void CloseRecordChannel();
 
+  // Accounts busy_ns of iteration work in the current budget window and sleeps until the window
+  // ends if the snapshot exceeded its cpu budget while foreground transactions were running.
+  void ThrottleIfNeeded(uint64_t busy_ns);
+
   // Push serializer's internal buffer to channel.
   // Push regardless of buffer size if force is true.
   // Return if pushed.
@@ -150,6 +168,18 @@ class SliceSnapshot {
   uint32_t journal_cb_id_ = 0;
   uint64_t rec_id_ = 0;
 
+  // Describe the contents of serializer_ buffer since the last push, see DbRecord.
+  bool journal_in_buffer_ = false;
+  bool cut_in_buffer_ = false;
+
+  size_t keys_total_ = 0;  // number of keys in all databases when the snapshot started.
+
+  struct ThrottleState {
+    uint64_t window_start_ns = 0;  // start of the current budget window.
+    uint64_t busy_ns = 0;          // time spent iterating in the current window.
+    uint64_t fg_polls = 0;         // shard poll_execution_total at the window start.
+  } throttle_;
+
   struct Stats {
     size_t loop_serialized = 0, skipped = 0, side_saved = 0;
     size_t savecb_calls = 0;
@@ -7,6 +7,7 @@
 #include <absl/strings/str_cat.h>
 
 extern "C" {
+#include "redis/redis_aux.h"
 #include "redis/stream.h"
 #include "redis/zmalloc.h"
 }
@@ -161,8 +162,6 @@ const char kXGroupKeyNotFound[] =
 const char kSameStreamFound[] = "Same stream specified multiple time";
 
 const uint32_t STREAM_LISTPACK_MAX_SIZE = 1 << 30;
-const uint32_t kStreamNodeMaxBytes = 4096;
-const uint32_t kStreamNodeMaxEntries = 100;
 const uint32_t STREAM_LISTPACK_MAX_PRE_ALLOCATE = 4096;
 
 /* Every stream item inside the listpack, has a flags field that is used to
@@ -427,22 +426,25 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
    * if we need to switch to the next one. 'lp' will be set to NULL if
    * the current node is full. */
   if (lp != NULL) {
-    size_t node_max_bytes = kStreamNodeMaxBytes;
+    size_t node_max_bytes = server.stream_node_max_bytes;
     if (node_max_bytes == 0 || node_max_bytes > STREAM_LISTPACK_MAX_SIZE)
       node_max_bytes = STREAM_LISTPACK_MAX_SIZE;
-    if (lp_bytes + totelelen >= node_max_bytes) {
-      lp = NULL;
-    } else if (kStreamNodeMaxEntries) {
+
+    bool full = lp_bytes + totelelen >= node_max_bytes;
+    if (!full && server.stream_node_max_entries) {
       unsigned char* lp_ele = lpFirst(lp);
       /* Count both live entries and deleted ones. */
       int64_t count = lpGetInteger(lp_ele) + lpGetInteger(lpNext(lp, lp_ele));
-      if (count >= kStreamNodeMaxEntries) {
-        /* Shrink extra pre-allocated memory */
-        lp = lpShrinkToFit(lp);
-        if (ri.data != lp)
-          raxInsert(s->rax_tree, ri.key, ri.key_len, lp, NULL);
-        lp = NULL;
-      }
+      full = count >= server.stream_node_max_entries;
+    }
+
+    if (full) {
+      /* Shrink extra pre-allocated memory. Large nodes grow by reallocation, so the slack
+       * left in them may be significant. */
+      lp = lpShrinkToFit(lp);
+      if (ri.data != lp)
+        raxInsert(s->rax_tree, ri.key, ri.key_len, lp, NULL);
+      lp = NULL;
     }
   }
 
@@ -574,6 +576,8 @@ streamNACK* StreamCreateNACK(streamConsumer* consumer) {
   nack->delivery_time = GetCurrentTimeMs();
   nack->delivery_count = 1;
   nack->consumer = consumer;
+  nack->id.ms = nack->id.seq = 0;
+  nack->idle_prev = nack->idle_next = nullptr;
   return nack;
 }
 
@@ -727,12 +731,15 @@ OpResult<RecordVec> OpRange(const OpArgs& op_args, string_view key, const RangeO
         raxRemove(nack->consumer->pel, buf, sizeof(buf), NULL);
         /* Update the consumer and NACK metadata. */
         nack->consumer = opts.consumer;
-        nack->delivery_time = GetCurrentTimeMs();
+        streamSetDeliveryTime(opts.group, nack, GetCurrentTimeMs());
         nack->delivery_count = 1;
         /* Add the entry in the new consumer local PEL. */
         raxInsert(opts.consumer->pel, buf, sizeof(buf), nack, NULL);
       } else if (group_inserted == 1 && consumer_inserted == 0) {
         return OpStatus::SKIPPED;  // ("NACK half-created. Should not be possible.");
+      } else {
+        nack->id = id;
+        streamLinkNACK(opts.group, nack);
       }
     }
     if (opts.count == result.size())
@@ -777,7 +784,7 @@ OpResult<RecordVec> OpRangeFromConsumerPEL(const OpArgs& op_args, string_view ke
       result.push_back(Record{id, vector<pair<string, string>>()});
     } else {
       streamNACK* nack = static_cast<streamNACK*>(ri.data);
-      nack->delivery_time = GetCurrentTimeMs();
+      streamSetDeliveryTime(opts.group, nack, GetCurrentTimeMs());
       nack->delivery_count++;
       result.push_back(std::move(op_result.value()[0]));
     }
@@ -1263,6 +1270,7 @@ OpResult<ClaimInfo> OpClaim(const OpArgs& op_args, string_view key, const ClaimO
         /* Release the NACK */
         raxRemove(cgr_res->cg->pel, buf.begin(), sizeof(buf), nullptr);
         raxRemove(nack->consumer->pel, buf.begin(), sizeof(buf), nullptr);
+        streamUnlinkNACK(cgr_res->cg, nack);
         streamFreeNACK(nack);
       }
       continue;
@@ -1273,7 +1281,9 @@ OpResult<ClaimInfo> OpClaim(const OpArgs& op_args, string_view key, const ClaimO
     if ((opts.flags & kClaimForce) && nack == raxNotFound) {
       /* Create the NACK. */
       nack = streamCreateNACK(nullptr);
+      nack->id = id;
       raxInsert(cgr_res->cg->pel, buf.begin(), sizeof(buf), nack, nullptr);
+      streamLinkNACK(cgr_res->cg, nack);
     }
 
     // We found the nack, continue.
@@ -1306,7 +1316,7 @@ OpResult<ClaimInfo> OpClaim(const OpArgs& op_args, string_view key, const ClaimO
         }
       }
       // Set the delivery time for the entry.
-      nack->delivery_time = opts.delivery_time;
+      streamSetDeliveryTime(cgr_res->cg, nack, opts.delivery_time);
       /* Set the delivery attempts counter if given, otherwise
        * autoincrement unless JUSTID option provided */
       if (opts.retry >= 0) {
@@ -1556,6 +1566,7 @@ OpResult<uint32_t> OpAck(const OpArgs& op_args, string_view key, string_view gna
     if (nack != raxNotFound) {
       raxRemove(res->cg->pel, buf, sizeof(buf), nullptr);
       raxRemove(nack->consumer->pel, buf, sizeof(buf), nullptr);
+      streamUnlinkNACK(res->cg, nack);
       streamFreeNACK(nack);
       acknowledged++;
     }
@@ -1563,6 +1574,24 @@ OpResult<uint32_t> OpAck(const OpArgs& op_args, string_view key, string_view gna
   return acknowledged;
 }
 
+// Collects the entries of the group PEL with ID >= start that were delivered at or before
+// deadline, in ID order. They are a prefix of the delivery time list. Returns false if the prefix
+// is longer than max_visits, in which case scanning the PEL by ID is cheaper.
+bool CollectIdleNacks(streamCG* cg, const streamID& start, mstime_t deadline, int64_t max_visits,
+                      vector<streamNACK*>* dest) {
+  for (streamNACK* nack = cg->idle_head; nack && nack->delivery_time <= deadline;
+       nack = nack->idle_next) {
+    if (max_visits-- <= 0)
+      return false;
+    if (streamCompareID(&nack->id, &start) >= 0)
+      dest->push_back(nack);
+  }
+
+  std::sort(dest->begin(), dest->end(),
+            [](streamNACK* a, streamNACK* b) { return streamCompareID(&a->id, &b->id) < 0; });
+  return true;
+}
+
 OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const ClaimOpts& opts) {
   auto cgr_res = FindGroup(op_args, key, opts.group);
   if (!cgr_res)
@@ -1581,39 +1610,22 @@ OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const Cl
   // multiplying <count>'s value by 10 (hard-coded).
   int64_t attempts = opts.count * 10;
 
-  unsigned char start_key[sizeof(streamID)];
-  streamID start_id = opts.start;
-  streamEncodeID(start_key, &start_id);
-  raxIterator ri;
-  raxStart(&ri, group->pel);
-  raxSeek(&ri, ">=", start_key, sizeof(start_key));
-
   ClaimInfo result;
   result.justid = (opts.flags & kClaimJustID);
 
   auto now = GetCurrentTimeMs();
   int count = opts.count;
-  while (attempts-- && count && raxNext(&ri)) {
-    streamNACK* nack = (streamNACK*)ri.data;
 
-    streamID id;
-    streamDecodeID(ri.key, &id);
-
-    if (!streamEntryExists(stream, &id)) {
-      raxRemove(group->pel, ri.key, ri.key_len, nullptr);
-      raxRemove(nack->consumer->pel, ri.key, ri.key_len, nullptr);
-      streamFreeNACK(nack);
-      result.deleted_ids.push_back(id);
-      raxSeek(&ri, ">=", ri.key, ri.key_len);
-      continue;
-    }
-
-    if (opts.min_idle_time) {
-      mstime_t this_idle = now - nack->delivery_time;
-      if (this_idle < opts.min_idle_time)
-        continue;
-    }
+  // Removes the entry of a deleted message from the PEL.
+  auto remove_deleted = [&](streamNACK* nack, unsigned char* id_key) {
+    raxRemove(group->pel, id_key, sizeof(streamID), nullptr);
+    raxRemove(nack->consumer->pel, id_key, sizeof(streamID), nullptr);
+    result.deleted_ids.push_back(nack->id);
+    streamUnlinkNACK(group, nack);
+    streamFreeNACK(nack);
+  };
 
+  auto claim = [&](streamNACK* nack, unsigned char* id_key) {
     op_args.shard->tmp_str1 =
         sdscpylen(op_args.shard->tmp_str1, opts.consumer.data(), opts.consumer.size());
     if (consumer == nullptr) {
@@ -1625,22 +1637,71 @@ OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const Cl
 
     if (nack->consumer != consumer) {
       if (nack->consumer) {
-        raxRemove(nack->consumer->pel, ri.key, ri.key_len, nullptr);
+        raxRemove(nack->consumer->pel, id_key, sizeof(streamID), nullptr);
       }
     }
 
-    nack->delivery_time = now;
+    streamSetDeliveryTime(group, nack, now);
     if (!result.justid) {
       nack->delivery_count++;
     }
 
     if (nack->consumer != consumer) {
-      raxInsert(consumer->pel, ri.key, ri.key_len, nack, nullptr);
+      raxInsert(consumer->pel, id_key, sizeof(streamID), nack, nullptr);
       nack->consumer = consumer;
     }
 
-    AppendClaimResultItem(result, stream, id);
+    AppendClaimResultItem(result, stream, nack->id);
     count--;
+  };
+
+  streamID start_id = opts.start;
+  if (opts.min_idle_time) {
+    // The delivery time list is ordered, so the entries that are idle enough are served from its
+    // head without scanning the entries that are not. The cursor is the next idle entry.
+    vector<streamNACK*> idle;
+    if (CollectIdleNacks(group, start_id, now - opts.min_idle_time, attempts, &idle)) {
+      size_t i = 0;
+      for (; i < idle.size() && count; ++i) {
+        unsigned char id_key[sizeof(streamID)];
+        streamEncodeID(id_key, &idle[i]->id);
+        if (!streamEntryExists(stream, &idle[i]->id)) {
+          remove_deleted(idle[i], id_key);
+        } else {
+          claim(idle[i], id_key);
+        }
+      }
+      if (i < idle.size())
+        result.end_id = idle[i]->id;
+      return result;
+    }
+  }
+
+  unsigned char start_key[sizeof(streamID)];
+  streamEncodeID(start_key, &start_id);
+  raxIterator ri;
+  raxStart(&ri, group->pel);
+  raxSeek(&ri, ">=", start_key, sizeof(start_key));
+
+  while (attempts-- && count && raxNext(&ri)) {
+    streamNACK* nack = (streamNACK*)ri.data;
+
+    streamID id;
+    streamDecodeID(ri.key, &id);
+
+    if (!streamEntryExists(stream, &id)) {
+      remove_deleted(nack, ri.key);
+      raxSeek(&ri, ">=", ri.key, ri.key_len);
+      continue;
+    }
+
+    if (opts.min_idle_time) {
+      mstime_t this_idle = now - nack->delivery_time;
+      if (this_idle < opts.min_idle_time)
+        continue;
+    }
+
+    claim(nack, ri.key);
   }
 
   raxNext(&ri);
@@ -1717,12 +1778,67 @@ PendingReducedResult GetPendingReducedResult(streamCG* cg) {
   return result;
 }
 
+PendingExtendedResult MakePendingItem(const streamNACK* nack, const streamID& id, mstime_t now) {
+  /* Milliseconds elapsed since last delivery. */
+  mstime_t elapsed = now - nack->delivery_time;
+  if (elapsed < 0) {
+    elapsed = 0;
+  }
+
+  return {.start = id,
+          .consumer_name = nack->consumer->name,
+          .delivery_count = nack->delivery_count,
+          .elapsed = elapsed};
+}
+
+// Serves XPENDING with IDLE by walking the delivery time list of the group from the oldest entry,
+// so the entries that are not idle enough are never visited. Returns false if too many idle
+// entries are outside of the requested range, in which case scanning the PEL by ID is cheaper.
+bool GetIdlePendingResult(streamCG* cg, streamConsumer* consumer, const PendingOpts& opts,
+                          mstime_t now, PendingExtendedResultList* result) {
+  const size_t max_visits = std::max<size_t>(1024, opts.count * 10);
+  streamID sstart = opts.start.val, send = opts.end.val;
+  vector<streamNACK*> nacks;
+  size_t visits = 0;
+
+  for (streamNACK* nack = cg->idle_head; nack; nack = nack->idle_next) {
+    if (now - nack->delivery_time < opts.min_idle_time)
+      break;
+    if (++visits > max_visits)
+      return false;
+    if (consumer && nack->consumer != consumer)
+      continue;
+    if (streamCompareID(&nack->id, &sstart) < 0 || streamCompareID(&nack->id, &send) > 0)
+      continue;
+    nacks.push_back(nack);
+  }
+
+  auto id_less = [](streamNACK* a, streamNACK* b) { return streamCompareID(&a->id, &b->id) < 0; };
+  size_t count = std::min<size_t>(nacks.size(), opts.count);
+  std::partial_sort(nacks.begin(), nacks.begin() + count, nacks.end(), id_less);
+
+  result->reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    result->push_back(MakePendingItem(nacks[i], nacks[i]->id, now));
+  }
+  return true;
+}
+
 PendingExtendedResultList GetPendingExtendedResult(streamCG* cg, streamConsumer* consumer,
                                                    const PendingOpts& opts) {
   PendingExtendedResultList result;
+  mstime_t now = GetCurrentTimeMs();
+
+  if (opts.min_idle_time) {
+    // The delivery time list is ordered, so nothing is pending if its head is not idle enough.
+    if (!cg->idle_head || now - cg->idle_head->delivery_time < opts.min_idle_time)
+      return result;
+    if (GetIdlePendingResult(cg, consumer, opts, now, &result))
+      return result;
+  }
+
   rax* pel = consumer ? consumer->pel : cg->pel;
   streamID sstart = opts.start.val, send = opts.end.val;
-  auto now = GetCurrentTimeMs();
   unsigned char start_key[sizeof(streamID)];
   unsigned char end_key[sizeof(streamID)];
   raxIterator ri;
@@ -1751,18 +1867,7 @@ PendingExtendedResultList GetPendingExtendedResult(streamCG* cg, streamConsumer*
     /* Entry ID. */
     streamID id;
     streamDecodeID(ri.key, &id);
-
-    /* Milliseconds elapsed since last delivery. */
-    mstime_t elapsed = now - nack->delivery_time;
-    if (elapsed < 0) {
-      elapsed = 0;
-    }
-
-    PendingExtendedResult item = {.start = id,
-                                  .consumer_name = nack->consumer->name,
-                                  .delivery_count = nack->delivery_count,
-                                  .elapsed = elapsed};
-    result.push_back(item);
+    result.push_back(MakePendingItem(nack, id, now));
   }
   raxStop(&ri);
   return result;
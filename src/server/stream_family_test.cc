@@ -4,6 +4,8 @@
 
 #include "server/stream_family.h"
 
+#include <absl/flags/reflection.h>
+
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
@@ -663,6 +665,39 @@ TEST_F(StreamFamilyTest, XPending) {
   EXPECT_THAT(resp, ArrLen(0));
 }
 
+TEST_F(StreamFamilyTest, XPendingIdle) {
+  Run({"xgroup", "create", "foo", "group", "0", "mkstream"});
+  for (unsigned i = 0; i < 6; ++i) {
+    Run({"xadd", "foo", absl::StrCat("1-", i), "k", "v"});
+    Run({"xreadgroup", "group", "group", i % 2 ? "bob" : "alice", "count", "1", "streams", "foo",
+         ">"});
+    AdvanceTime(1000);
+  }
+
+  // 1-0 and 1-1 were delivered 6 and 5 seconds ago, but 1-1 is claimed again now.
+  Run({"xclaim", "foo", "group", "alice", "0", "1-1"});
+  auto resp = Run({"xpending", "foo", "group", "IDLE", "3000", "-", "+", "10"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(
+                        RespArray(ElementsAre("1-0", "alice", ArgType(RespExpr::INT64), IntArg(1))),
+                        RespArray(ElementsAre("1-2", "alice", ArgType(RespExpr::INT64), IntArg(1))),
+                        RespArray(ElementsAre("1-3", "bob", ArgType(RespExpr::INT64), IntArg(1))))));
+
+  resp = Run({"xpending", "foo", "group", "IDLE", "3000", "1-1", "+", "1"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre("1-2", "alice", ArgType(RespExpr::INT64), IntArg(1)));
+
+  resp = Run({"xpending", "foo", "group", "IDLE", "3000", "-", "+", "10", "bob"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre("1-3", "bob", ArgType(RespExpr::INT64), IntArg(1)));
+
+  // Acknowledged entries are no longer pending.
+  Run({"xack", "foo", "group", "1-0", "1-2"});
+  resp = Run({"xpending", "foo", "group", "IDLE", "3000", "-", "+", "10"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre("1-3", "bob", ArgType(RespExpr::INT64), IntArg(1)));
+
+  AdvanceTime(3000);
+  resp = Run({"xpending", "foo", "group", "IDLE", "3000", "-", "+", "10"});
+  EXPECT_THAT(resp, ArrLen(4));
+}
+
 TEST_F(StreamFamilyTest, XPendingInvalidArgs) {
   Run({"xadd", "foo", "1-0", "k1", "v1"});
   Run({"xadd", "foo", "1-1", "k2", "v2"});
@@ -902,6 +937,58 @@ TEST_F(StreamFamilyTest, XAutoClaim) {
                                   RespArray(ElementsAre("1-2", "1-4")))));
 }
 
+TEST_F(StreamFamilyTest, XAutoClaimIdle) {
+  Run({"xgroup", "create", "foo", "group", "0", "mkstream"});
+  for (unsigned i = 0; i < 5; ++i) {
+    Run({"xadd", "foo", absl::StrCat("1-", i), "k", "v"});
+  }
+  Run({"xreadgroup", "group", "group", "alice", "streams", "foo", ">"});
+  AdvanceTime(1000);
+
+  // Back-dated entries are idle before the entries delivered earlier.
+  Run({"xclaim", "foo", "group", "alice", "0", "1-3", "time", "1", "justid"});
+  auto resp = Run({"xautoclaim", "foo", "group", "bob", "10000", "0-0", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0-0", RespArray(ElementsAre("1-3")),
+                                          RespArray(ElementsAre()))));
+
+  // The cursor is the next entry that is idle enough.
+  AdvanceTime(20000);
+  resp = Run({"xautoclaim", "foo", "group", "bob", "10000", "0-0", "count", "2", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("1-2", RespArray(ElementsAre("1-0", "1-1")),
+                                          RespArray(ElementsAre()))));
+
+  Run({"xdel", "foo", "1-2"});
+  resp = Run({"xautoclaim", "foo", "group", "carol", "10000", "1-2", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0-0", RespArray(ElementsAre("1-3", "1-4")),
+                                          RespArray(ElementsAre("1-2")))));
+
+  resp = Run({"xpending", "foo", "group", "-", "+", "10", "carol"});
+  EXPECT_THAT(resp, ArrLen(2));
+}
+
+TEST_F(StreamFamilyTest, NodeLimits) {
+  absl::FlagSaver fs;
+
+  EXPECT_EQ(Run({"config", "set", "stream_node_max_entries", "10"}), "OK");
+  for (unsigned i = 1; i <= 25; ++i) {
+    Run({"xadd", "s1", absl::StrCat(i, "-1"), "temperature", absl::StrCat(i)});
+  }
+  auto resp = Run({"xinfo", "stream", "s1"});
+  EXPECT_THAT(resp.GetVec()[3], IntArg(3));  // radix-tree-keys
+
+  EXPECT_EQ(Run({"config", "set", "stream_node_max_entries", "0"}), "OK");
+  EXPECT_EQ(Run({"config", "set", "stream_node_max_bytes", "0"}), "OK");
+  for (unsigned i = 1; i <= 300; ++i) {
+    Run({"xadd", "s2", absl::StrCat(i, "-1"), "temperature", absl::StrCat(i)});
+  }
+  resp = Run({"xinfo", "stream", "s2"});
+  EXPECT_THAT(resp.GetVec()[3], IntArg(1));
+
+  resp = Run({"xrange", "s2", "150", "151"});
+  EXPECT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec()[0].GetVec(), ElementsAre("150-1", _));
+}
+
 TEST_F(StreamFamilyTest, XInfoStream) {
   Run({"del", "mystream"});
   Run({"xgroup", "create", "mystream", "mygroup", "$", "MKSTREAM"});
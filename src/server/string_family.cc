@@ -442,7 +442,7 @@ OpResult<array<int64_t, 5>> OpThrottle(const OpArgs& op_args, const string_view
   if (!limited) {
     if (IsValid(res.it)) {
       if (IsValid(res.exp_it)) {
-        res.exp_it->second = db_slice.FromAbsoluteTime(new_tat_ms);
+        db_slice.SetExpireTime(op_args.db_cntx.db_index, res.it, res.exp_it, new_tat_ms);
       } else {
         db_slice.AddExpire(op_args.db_cntx.db_index, res.it, new_tat_ms);
       }
@@ -497,15 +497,12 @@ SinkReplyBuilder::MGetResponse OpMGet(bool fetch_mcflag, bool fetch_mcver, const
 
   SinkReplyBuilder::MGetResponse response(keys.size());
   absl::InlinedVector<PrimeConstIterator, 32> iters(keys.size());
+  db_slice.FindManyReadOnly(t->GetDbContext(), keys, OBJ_STRING, true, absl::MakeSpan(iters));
 
   size_t total_size = 0;
-  for (size_t i = 0; i < keys.size(); ++i) {
-    OpResult<PrimeConstIterator> it_res =
-        db_slice.FindAndFetchReadOnly(t->GetDbContext(), keys[i], OBJ_STRING);
-    if (!it_res)
-      continue;
-    iters[i] = *it_res;
-    total_size += (*it_res)->second.Size();
+  for (const auto& it : iters) {
+    if (!it.is_done())
+      total_size += it->second.Size();
   }
 
   response.storage_list = SinkReplyBuilder::AllocMGetStorage(total_size);
@@ -641,7 +638,7 @@ OpStatus SetCmd::SetExisting(const SetParams& params, PrimeIterator it, ExpireIt
     if (at_ms) {  // Command has an expiry paramater.
       if (IsValid(e_it)) {
         // Updated existing expiry information.
-        e_it->second = db_slice.FromAbsoluteTime(at_ms);
+        db_slice.SetExpireTime(op_args_.db_cntx.db_index, it, e_it, at_ms);
       } else {
         // Add new expiry information.
         db_slice.AddExpire(op_args_.db_cntx.db_index, it, at_ms);
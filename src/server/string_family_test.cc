@@ -237,6 +237,32 @@ TEST_F(StringFamilyTest, MGetSet) {
   set_fb.Join();
 }
 
+TEST_F(StringFamilyTest, MGetMany) {
+  // More keys per shard than a single prefetch group, with missing and mistyped keys.
+  vector<string> args = {"mget"};
+  for (unsigned i = 0; i < 60; ++i) {
+    string key = StrCat("key", i);
+    if (i % 3 == 0)
+      Run({"set", key, StrCat(i)});
+    else if (i % 3 == 1)
+      Run({"lpush", key, "a"});
+    args.push_back(key);
+  }
+
+  auto resp = Run(absl::MakeSpan(args));
+  ASSERT_THAT(resp, ArrLen(60));
+  const auto& vec = resp.GetVec();
+  for (unsigned i = 0; i < 60; ++i) {
+    if (i % 3 == 0)
+      EXPECT_EQ(vec[i].GetString(), StrCat(i));
+    else
+      EXPECT_EQ(vec[i].type, RespExpr::NIL) << i;
+  }
+
+  args[0] = "exists";
+  EXPECT_THAT(Run(absl::MakeSpan(args)), IntArg(40));
+}
+
 TEST_F(StringFamilyTest, MGetCachingModeBug2276) {
   absl::FlagSaver fs;
   SetTestFlag("cache_mode", "true");
@@ -57,6 +57,65 @@ SlotStats& SlotStats::operator+=(const SlotStats& o) {
   return *this;
 }
 
+void ExpiryIndex::Add(uint64_t key_hash, uint64_t expire_at_ms) {
+  auto [it, inserted] = buckets_.try_emplace(expire_at_ms / 1000);
+  size_t bytes = inserted ? 0 : BucketBytes(it->second);
+  it->second[key_hash]++;
+
+  mem_usage_ += BucketBytes(it->second) - bytes;
+  size_++;
+}
+
+void ExpiryIndex::Remove(uint64_t key_hash, uint64_t expire_at_ms) {
+  auto it = buckets_.find(expire_at_ms / 1000);
+  if (it == buckets_.end())
+    return;
+
+  auto hash_it = it->second.find(key_hash);
+  if (hash_it == it->second.end())
+    return;
+
+  size_--;
+  if (--hash_it->second == 0)
+    it->second.erase(hash_it);
+
+  if (it->second.empty()) {
+    mem_usage_ -= BucketBytes(it->second);
+    buckets_.erase(it);
+  }
+}
+
+void ExpiryIndex::PopDue(uint64_t now_ms, size_t limit, std::vector<uint64_t>* dest) {
+  // A bucket is due once its whole second has passed.
+  while (!buckets_.empty() && buckets_.begin()->first < now_ms / 1000 && limit > 0) {
+    Bucket& hashes = buckets_.begin()->second;
+    for (auto it = hashes.begin(); it != hashes.end() && limit > 0; --limit) {
+      dest->push_back(it->first);
+      size_ -= it->second;
+      hashes.erase(it++);
+    }
+
+    if (hashes.empty()) {
+      mem_usage_ -= BucketBytes(hashes);
+      buckets_.erase(buckets_.begin());
+    }
+  }
+}
+
+uint64_t ExpiryIndex::LagMs(uint64_t now_ms) const {
+  if (buckets_.empty())
+    return 0;
+
+  uint64_t due_ms = (buckets_.begin()->first + 1) * 1000;
+  return now_ms > due_ms ? now_ms - due_ms : 0;
+}
+
+void ExpiryIndex::Clear() {
+  buckets_.clear();
+  size_ = 0;
+  mem_usage_ = 0;
+}
+
 void LockTable::Key::MakeOwned() const {
   if (std::holds_alternative<std::string_view>(val_))
     val_ = std::string{std::get<std::string_view>(val_)};
@@ -99,6 +158,7 @@ DbTable::DbTable(PMR_NS::memory_resource* mr, DbIndex db_index)
     : prime(kInitSegmentLog, detail::PrimeTablePolicy{}, mr),
       expire(0, detail::ExpireTablePolicy{}, mr),
       mcflag(0, detail::ExpireTablePolicy{}, mr),
+      expiry_index(mr),
       top_keys({.enabled = absl::GetFlag(FLAGS_enable_top_keys_tracking)}),
       index(db_index) {
   if (ClusterConfig::IsEnabled()) {
@@ -116,6 +176,7 @@ void DbTable::Clear() {
   prime.Clear();
   expire.Clear();
   mcflag.Clear();
+  expiry_index.Clear();
   stats = DbTableStats{};
 }
 
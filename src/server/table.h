@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <absl/container/btree_map.h>
 #include <absl/container/flat_hash_map.h>
 
 #include <boost/smart_ptr/intrusive_ptr.hpp>
@@ -121,6 +122,55 @@ class LockTable {
   absl::flat_hash_map<Key, IntentLock> locks_;
 };
 
+// Hashes of the keys with expiry, bucketed by the second at which they expire.
+// Entries are removed when the expiry of a key changes or the key is deleted. The index allocates
+// from the memory resource of the shard, so it is accounted in the used memory.
+class ExpiryIndex {
+ public:
+  explicit ExpiryIndex(PMR_NS::memory_resource* mr) : buckets_(mr) {
+  }
+
+  void Add(uint64_t key_hash, uint64_t expire_at_ms);
+
+  // Removes an entry added with the same arguments, if it has not been popped yet.
+  void Remove(uint64_t key_hash, uint64_t expire_at_ms);
+
+  // Pops up to limit hashes from the buckets whose keys have all expired by now_ms, oldest first.
+  void PopDue(uint64_t now_ms, size_t limit, std::vector<uint64_t>* dest);
+
+  // How long ago the keys of the oldest due bucket expired, 0 if none is due.
+  uint64_t LagMs(uint64_t now_ms) const;
+
+  size_t size() const {
+    return size_;
+  }
+
+  size_t MemUsage() const {
+    return mem_usage_;
+  }
+
+  void Clear();
+
+ private:
+  // Maps a hash to the number of keys with it, which is almost always 1.
+  using Bucket =
+      absl::flat_hash_map<uint64_t, uint32_t, absl::Hash<uint64_t>, std::equal_to<uint64_t>,
+                          PMR_NS::polymorphic_allocator<std::pair<const uint64_t, uint32_t>>>;
+  using BucketMap =
+      absl::btree_map<uint64_t, Bucket, std::less<uint64_t>,
+                      PMR_NS::polymorphic_allocator<std::pair<const uint64_t, Bucket>>>;
+
+  // Approximate bytes of a bucket: its node in the map and the slots and control bytes of its
+  // hash table.
+  static size_t BucketBytes(const Bucket& bucket) {
+    return sizeof(BucketMap::value_type) + bucket.capacity() * (sizeof(Bucket::value_type) + 1);
+  }
+
+  BucketMap buckets_;
+  size_t size_ = 0;
+  size_t mem_usage_ = 0;
+};
+
 // A single Db table that represents a table that can be chosen with "SELECT" command.
 struct DbTable : boost::intrusive_ref_counter<DbTable, boost::thread_unsafe_counter> {
   PrimeTable prime;
@@ -136,6 +186,8 @@ struct DbTable : boost::intrusive_ref_counter<DbTable, boost::thread_unsafe_coun
   mutable DbTableStats stats;
   std::vector<SlotStats> slots_stats;
   ExpireTable::Cursor expire_cursor;
+  PrimeTable::Cursor compress_cursor;
+  ExpiryIndex expiry_index;  // used only with --expiry_index.
 
   TopKeys top_keys;
   DbIndex index;
@@ -387,7 +387,7 @@ RespExpr BaseFamilyTest::Run(std::string_view id, ArgSlice slice) {
   DCHECK(context->transaction == nullptr);
 
   auto cmd = absl::AsciiStrToUpper(slice.front());
-  if (cmd == "EVAL" || cmd == "EVALSHA" || cmd == "EXEC") {
+  if (CO::IsEvalKind(cmd) || cmd == "EXEC") {
     shard_set->AwaitRunningOnShardQueue([](auto*) {});  // Wait for async UnlockMulti.
   }
 
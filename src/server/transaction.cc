@@ -169,7 +169,7 @@ cv_status Transaction::BatonBarrier::Wait(time_point tp) {
 Transaction::Transaction(const CommandId* cid) : cid_{cid} {
   InitTxTime();
   string_view cmd_name(cid_->name());
-  if (cmd_name == "EXEC" || cmd_name == "EVAL" || cmd_name == "EVALSHA") {
+  if (cmd_name == "EXEC" || CO::IsEvalKind(cmd_name)) {
     multi_.reset(new MultiData);
     multi_->shard_journal_write.resize(shard_set->size(), false);
 
@@ -333,7 +333,7 @@ void Transaction::StoreKeysInArgs(const KeyIndex& key_index) {
 
 void Transaction::InitByKeys(const KeyIndex& key_index) {
   if (key_index.start == full_args_.size()) {  // eval with 0 keys.
-    CHECK(absl::StartsWith(cid_->name(), "EVAL")) << cid_->name();
+    CHECK(CO::IsEvalKind(cid_->name())) << cid_->name();
     return;
   }
 
@@ -1655,7 +1655,7 @@ OpResult<KeyIndex> DetermineKeys(const CommandId* cid, CmdArgList args) {
       key_index.bonus = 0;  // Z<xxx>STORE <key> commands
 
     unsigned num_keys_index;
-    if (absl::StartsWith(name, "EVAL"))
+    if (CO::IsEvalKind(name))
       num_keys_index = 1;
     else
       num_keys_index = key_index.bonus ? *key_index.bonus + 1 : 0;
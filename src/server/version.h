@@ -29,8 +29,19 @@ enum class DflyVersion {
   // Supports limited partial sync
   VER2,
 
+  // - Supports splitting the full sync of a flow over multiple connections
+  //   with DFLY FLOW ... PART <part_id>
+  VER3,
+
+  // - Accepts LZ4 compressed batches of journal entries in stable sync
+  VER4,
+
   // Always points to the latest version
-  CURRENT_VER = VER2,
+  CURRENT_VER = VER4,
 };
 
+// The maximal number of connections, the flow connection included, that a replication flow uses
+// during full sync since DflyVersion::VER3.
+constexpr unsigned kMaxFullSyncStreams = 16;
+
 }  // namespace dfly
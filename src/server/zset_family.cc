@@ -4,6 +4,10 @@
 
 #include "server/zset_family.h"
 
+#include <absl/strings/numbers.h>
+
+#include <numeric>
+
 #include "server/acl/acl_commands_def.h"
 
 extern "C" {
@@ -28,6 +32,7 @@ extern "C" {
 #include "server/container_utils.h"
 #include "server/engine_shard_set.h"
 #include "server/error.h"
+#include "server/set_family.h"
 #include "server/transaction.h"
 
 namespace dfly {
@@ -792,19 +797,45 @@ void InterScoredMap(ScoredMap* dest, ScoredMap* src, AggType agg_type) {
 
 using KeyIterWeightVec = vector<pair<PrimeConstIterator, double>>;
 
+// Calls cb(member, score) for every member of the sorted set, straight from its encoding.
+template <typename F> void IterateScored(const PrimeValue& pv, F&& cb) {
+  auto visit = [&cb](container_utils::ContainerEntry ce, double score) {
+    if (ce.value) {
+      cb(string_view{ce.value, ce.length}, score);
+    } else {
+      char buf[32];
+      char* next = absl::numbers_internal::FastIntToBuffer(ce.longval, buf);
+      cb(string_view{buf, size_t(next - buf)}, score);
+    }
+    return true;
+  };
+  container_utils::IterateSortedSet(pv.GetRobjWrapper(), visit, 0, -1, false, true);
+}
+
 ScoredMap UnionShardKeysWithScore(const KeyIterWeightVec& key_iter_weight_vec, AggType agg_type) {
-  ScoredMap result;
+  size_t max_size = 0;
   for (const auto& key_iter_weight : key_iter_weight_vec) {
-    if (key_iter_weight.first.is_done()) {
+    if (!key_iter_weight.first.is_done())
+      max_size = max(max_size, key_iter_weight.first->second.Size());
+  }
+
+  // Sources are aggregated into the result without materializing them first,
+  // so every distinct member is copied once.
+  ScoredMap result;
+  result.reserve(max_size);
+  for (const auto& [key_iter, weight] : key_iter_weight_vec) {
+    if (key_iter.is_done()) {
       continue;
     }
 
-    ScoredMap sm = FromObject(key_iter_weight.first->second, key_iter_weight.second);
-    if (result.empty()) {
-      result.swap(sm);
-    } else {
-      UnionScoredMap(&result, &sm, agg_type);
-    }
+    IterateScored(key_iter->second, [&, weight = weight](string_view member, double score) {
+      score *= weight;
+      auto it = result.find(member);
+      if (it == result.end())
+        result.emplace(member, score);
+      else
+        it->second = Aggregate(it->second, score, agg_type);
+    });
   }
   return result;
 }
@@ -913,25 +944,54 @@ OpResult<ScoredMap> OpInter(EngineShard* shard, Transaction* t, string_view dest
                                                  cmdargs_keys_offset)};
   }
 
-  ScoredMap result;
-  for (auto it = it_arr.begin(); it != it_arr.end(); ++it) {
-    if (it->first.it.is_done()) {
+  for (const auto& [it_res, weight] : it_arr) {
+    if (it_res.it.is_done())
       return ScoredMap{};
-    }
+  }
 
-    ScoredMap sm;
-    if (it->first.it->second.ObjType() == OBJ_ZSET)
-      sm = FromObject(it->first.it->second, it->second);
-    else
-      sm = ZSetFromSet(it->first.it->second, it->second);
+  // Only the smallest source is copied into the result. Its members are then probed in the other
+  // sources in place, from the smallest to the largest, so the result only shrinks.
+  vector<unsigned> order(it_arr.size());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&it_arr](unsigned l, unsigned r) {
+    return it_arr[l].first.it->second.Size() < it_arr[r].first.it->second.Size();
+  });
 
-    if (result.empty())
-      result.swap(sm);
-    else
-      InterScoredMap(&result, &sm, agg_type);
+  const auto& [smallest, smallest_weight] = it_arr[order.front()];
+  ScoredMap result;
+  if (smallest.it->second.ObjType() == OBJ_ZSET) {
+    double weight = smallest_weight;
+    result.reserve(smallest.it->second.Size());
+    IterateScored(smallest.it->second, [&](string_view member, double score) {
+      result.emplace(member, score * weight);
+    });
+  } else {
+    result = ZSetFromSet(smallest.it->second, smallest_weight);
+  }
+
+  sds& tmp_str = shard->tmp_str1;
+  for (size_t i = 1; i < order.size() && !result.empty(); ++i) {
+    const auto& [it_res, weight] = it_arr[order[i]];
+    const PrimeValue& pv = it_res.it->second;
+    bool is_zset = pv.ObjType() == OBJ_ZSET;
+
+    for (auto it = result.begin(); it != result.end();) {
+      optional<double> score;
+      if (is_zset) {
+        tmp_str = sdscpylen(tmp_str, it->first.data(), it->first.size());
+        score = GetZsetScore(pv.GetRobjWrapper(), tmp_str);
+      } else if (SetFamily::IsMember(t->GetDbContext(), pv, it->first)) {
+        score = 1;
+      }
 
-    if (result.empty())
-      return result;
+      if (!score) {
+        auto copy_it = it++;
+        result.erase(copy_it);
+      } else {
+        it->second = Aggregate(it->second, *score * weight, agg_type);
+        ++it;
+      }
+    }
   }
 
   return result;
@@ -988,6 +1048,24 @@ OpResult<AddResult> OpAdd(const OpArgs& op_args, const ZParams& zparams, string_
   detail::RobjWrapper* robj_wrapper = res_it->it->second.GetRobjWrapper();
   bool is_list_pack = robj_wrapper->encoding() == OBJ_ENCODING_LISTPACK;
 
+  // A fresh sorted map, e.g. the destination of a store command, is bulk-loaded.
+  // Members are unique or the last one wins, as with ZsetAdd without flags.
+  // NaN scores, e.g. inf + -inf from an aggregation, are dropped as ZsetAdd does.
+  if (!is_list_pack && zparams.flags == 0 && !zparams.ch) {
+    detail::SortedMap* sm = (detail::SortedMap*)robj_wrapper->inner_obj();
+    if (sm->Size() == 0) {
+      sm->Reserve(members.size());
+      for (const auto& m : members) {
+        if (!isnan(m.first))
+          added += sm->BulkAdd(m.first, m.second);
+      }
+      sm->FinishBulkLoad();
+
+      aresult.num_updated = added;
+      return aresult;
+    }
+  }
+
   // opportunistically reserve space if multiple entries are about to be added.
   if ((zparams.flags & ZADD_IN_XX) == 0 && members.size() > 2) {
     if (is_list_pack) {
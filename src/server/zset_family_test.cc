@@ -181,6 +181,50 @@ TEST_F(ZSetFamilyTest, LargeSet) {
   EXPECT_EQ(2, CheckedInt({"zremrangebyscore", "key", "127", "(129"}));
 }
 
+TEST_F(ZSetFamilyTest, BulkLoad) {
+  // A ZADD of many members into a new key bulk-loads the sorted map.
+  vector<string> args = {"zadd", "key"};
+  for (unsigned i = 0; i < 300; ++i) {
+    args.push_back(absl::StrCat(300 - i));
+    args.push_back(absl::StrCat("m", i));
+  }
+  args.push_back("1000");
+  args.push_back("m0");
+  EXPECT_THAT(Run(absl::MakeSpan(args)), IntArg(300));
+  EXPECT_THAT(Run({"zcard", "key"}), IntArg(300));
+  EXPECT_THAT(Run({"zrange", "key", "0", "1"}).GetVec(), ElementsAre("m299", "m298"));
+  EXPECT_EQ(Run({"zscore", "key", "m0"}), "1000");
+  EXPECT_THAT(Run({"zrank", "key", "m0"}), IntArg(299));
+
+  EXPECT_THAT(Run({"zunionstore", "dest", "1", "key", "weights", "2"}), IntArg(300));
+  EXPECT_THAT(Run({"zrange", "dest", "-1", "-1", "withscores"}).GetVec(),
+              ElementsAre("m0", "2000"));
+  EXPECT_THAT(Run({"zadd", "dest", "0", "m0"}), IntArg(0));
+  EXPECT_THAT(Run({"zrank", "dest", "m0"}), IntArg(0));
+}
+
+TEST_F(ZSetFamilyTest, BulkLoadNaN) {
+  // Members that appear in both sets sum up to inf + -inf and are dropped.
+  vector<string> args1 = {"zadd", "key1"}, args2 = {"zadd", "key2"};
+  for (unsigned i = 0; i < 300; ++i) {
+    args1.push_back(absl::StrCat(i + 1));
+    args1.push_back(absl::StrCat("m", i));
+    if (i % 2 == 0) {
+      args2.push_back(absl::StrCat(i + 1));
+      args2.push_back(absl::StrCat("m", i));
+    }
+  }
+  EXPECT_THAT(Run(absl::MakeSpan(args1)), IntArg(300));
+  EXPECT_THAT(Run(absl::MakeSpan(args2)), IntArg(150));
+
+  Run({"zunionstore", "dest", "2", "key1", "key2", "weights", "inf", "-inf"});
+  EXPECT_THAT(Run({"zcard", "dest"}), IntArg(150));
+  EXPECT_THAT(Run({"zscore", "dest", "m0"}), ArgType(RespExpr::NIL));
+  EXPECT_EQ(Run({"zscore", "dest", "m1"}), "inf");
+  EXPECT_THAT(Run({"zrangebyscore", "dest", "-inf", "+inf"}), ArrLen(150));
+  EXPECT_THAT(Run({"zrank", "dest", "m99"}), IntArg(149));
+}
+
 TEST_F(ZSetFamilyTest, ZRemRangeRank) {
   Run({"zadd", "x", "1.1", "a", "2.1", "b"});
   EXPECT_THAT(Run({"ZREMRANGEBYRANK", "y", "0", "1"}), IntArg(0));
@@ -541,6 +585,27 @@ TEST_F(ZSetFamilyTest, ZInter) {
   EXPECT_THAT(resp, ArrLen(0));
 }
 
+TEST_F(ZSetFamilyTest, ZInterMixedEncodings) {
+  // "large" is a skiplist, "small" a listpack with integer members and "s" an intset.
+  for (unsigned i = 0; i < 200; ++i) {
+    Run({"zadd", "large", absl::StrCat(i), absl::StrCat(i)});
+  }
+  EXPECT_EQ(3, CheckedInt({"zadd", "small", "1", "5", "1", "7", "1", "500"}));
+  EXPECT_EQ(3, CheckedInt({"sadd", "s", "5", "7", "8"}));
+
+  EXPECT_EQ(2, CheckedInt({"zinterstore", "dest", "3", "large", "small", "s", "weights", "1",
+                           "2", "3"}));
+  auto resp = Run({"zrange", "dest", "0", "-1", "withscores"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre("5", "10", "7", "12"));
+
+  resp = Run({"zinter", "2", "small", "large", "aggregate", "max", "withscores"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre("5", "5", "7", "7"));
+
+  EXPECT_EQ(201, CheckedInt({"zunionstore", "dest", "2", "large", "small"}));
+  EXPECT_THAT(Run({"zscore", "dest", "5"}), "6");
+  EXPECT_THAT(Run({"zscore", "dest", "500"}), "1");
+}
+
 TEST_F(ZSetFamilyTest, ZInterCard) {
   EXPECT_EQ(3, CheckedInt({"zadd", "z1", "1", "a", "2", "b", "3", "c"}));
   EXPECT_EQ(3, CheckedInt({"zadd", "z2", "2", "b", "3", "c", "4", "d"}));
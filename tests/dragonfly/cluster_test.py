@@ -3,6 +3,7 @@ import re
 import json
 import redis
 from redis import asyncio as aioredis
+from redis.crc import key_slot
 import asyncio
 
 from .instance import DflyInstanceFactory, DflyInstance
@@ -955,6 +956,94 @@ async def test_cluster_data_migration(df_local_factory: DflyInstanceFactory):
     await close_clients(*c_nodes, *c_nodes_admin)
 
 
+@dfly_args({"proactor_threads": 4, "cluster_mode": "yes"})
+async def test_cluster_data_migration_multi_stream(df_local_factory: DflyInstanceFactory):
+    # Migrate over several streams per shard with a bandwidth cap and check the progress report
+    nodes = [
+        df_local_factory.create(
+            port=BASE_PORT + i,
+            admin_port=BASE_PORT + i + 1000,
+            cluster_migration_streams=3,
+            cluster_migration_max_bandwidth_mb=1,
+        )
+        for i in range(2)
+    ]
+
+    df_local_factory.start_all(nodes)
+
+    c_nodes = [node.client() for node in nodes]
+    c_nodes_admin = [node.admin_client() for node in nodes]
+
+    node_ids = await asyncio.gather(*(get_node_id(c) for c in c_nodes_admin))
+
+    config = f"""
+      [
+        {{
+          "slot_ranges": [ {{ "start": 0, "end": LAST_SLOT_CUTOFF }} ],
+          "master": {{ "id": "{node_ids[0]}", "ip": "localhost", "port": {nodes[0].port} }},
+          "replicas": []
+        }},
+        {{
+          "slot_ranges": [ {{ "start": NEXT_SLOT_CUTOFF, "end": 16383 }} ],
+          "master": {{ "id": "{node_ids[1]}", "ip": "localhost", "port": {nodes[1].port} }},
+          "replicas": []
+        }}
+      ]
+    """
+
+    await push_config(
+        config.replace("LAST_SLOT_CUTOFF", "9000").replace("NEXT_SLOT_CUTOFF", "9001"),
+        c_nodes_admin,
+    )
+
+    # About 2MB of data, so the transfer takes a couple of seconds at the capped rate
+    keys = [f"key:{i}" for i in range(20000) if 0 < key_slot(f"key:{i}".encode()) <= 9000][:10000]
+    pipe = c_nodes[0].pipeline(transaction=False)
+    for key in keys:
+        pipe.set(key, "x" * 200)
+    await pipe.execute()
+
+    res = await c_nodes_admin[1].execute_command(
+        "DFLYCLUSTER", "START-SLOT-MIGRATION", "127.0.0.1", str(nodes[0].admin_port), "1", "9000"
+    )
+    assert 1 == res
+
+    seen_progress = False
+    while True:
+        status = await c_nodes_admin[0].execute_command(
+            "DFLYCLUSTER", "SLOT-MIGRATION-STATUS", "127.0.0.1", str(nodes[1].port)
+        )
+        if status == "STABLE_SYNC":
+            break
+        if status.startswith("FULL_SYNC"):
+            assert re.search(r"keys=\d+/\d+ rate=.+/s eta=\S+", status), status
+            seen_progress = True
+        await asyncio.sleep(0.05)
+    assert seen_progress
+
+    res = await c_nodes_admin[0].execute_command("DFLYCLUSTER", "SLOT-MIGRATION-FINALIZE", "1")
+    assert "OK" == res
+
+    while (
+        await c_nodes_admin[1].execute_command(
+            "DFLYCLUSTER", "SLOT-MIGRATION-STATUS", "127.0.0.1", str(nodes[0].admin_port)
+        )
+        != "FINISHED"
+    ):
+        await asyncio.sleep(0.05)
+
+    await push_config(
+        config.replace("LAST_SLOT_CUTOFF", "0").replace("NEXT_SLOT_CUTOFF", "1"),
+        c_nodes_admin,
+    )
+
+    assert await c_nodes[1].execute_command("DBSIZE") == len(keys)
+    for key in keys[::100]:
+        assert await c_nodes[1].get(key) == "x" * 200
+
+    await close_clients(*c_nodes, *c_nodes_admin)
+
+
 from dataclasses import dataclass
 
 
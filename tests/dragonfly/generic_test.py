@@ -137,3 +137,27 @@ async def test_reply_guard_oom(df_local_factory, df_seeder_factory):
 
     info = await c_master.info("stats")
     assert info["evicted_keys"] > 0, "Weak testcase: policy based eviction was not triggered."
+
+
+@pytest.mark.asyncio
+async def test_proactive_eviction(df_local_factory, df_seeder_factory):
+    max_memory = 256 * 1024 * 1024
+    master = df_local_factory.create(
+        proactor_threads=2,
+        cache_mode="true",
+        maxmemory="256mb",
+        enable_heartbeat_eviction="false",
+        eviction_soft_watermark=0.8,
+    )
+    df_local_factory.start_all([master])
+    c_master = master.client()
+
+    seeder = df_seeder_factory.create(
+        port=master.port, keys=400000, val_size=1000, stop_on_failure=False
+    )
+    await seeder.run(target_ops=600000)
+
+    info = await c_master.info()
+    assert info["evicted_keys"] > 0, "Weak testcase: the eviction controller was not triggered."
+    assert info["oom_deny_rejections"] == 0
+    assert info["used_memory"] < max_memory
@@ -114,6 +114,151 @@ async def test_replication_all(
     await disconnect_clients(c_master, *c_replicas)
 
 
+"""
+Test full sync that splits every flow over multiple connections while data is streamed.
+"""
+
+
+@pytest.mark.parametrize("t_master, t_replica, streams", [(1, 4, 4), (4, 2, 3)])
+async def test_replication_multi_stream_full_sync(
+    df_local_factory: DflyInstanceFactory, t_master, t_replica, streams
+):
+    master = df_local_factory.create(proactor_threads=t_master)
+    replica = df_local_factory.create(proactor_threads=t_replica, replica_full_sync_streams=streams)
+
+    df_local_factory.start_all([master, replica])
+    c_master = master.client()
+    c_replica = replica.client()
+
+    seeder = SeederV2(key_target=20_000)
+    await seeder.run(c_master, target_deviation=0.01)
+
+    stream_task = asyncio.create_task(seeder.run(c_master))
+    await asyncio.sleep(0.0)
+
+    await c_replica.execute_command(f"REPLICAOF localhost {master.port}")
+    async with async_timeout.timeout(20):
+        await wait_for_replicas_state(c_replica)
+
+    await seeder.stop(c_master)
+    await stream_task
+
+    await check_all_replicas_finished([c_replica], c_master)
+    hashes = await asyncio.gather(*(SeederV2.capture(c) for c in [c_master, c_replica]))
+    assert len(set(hashes)) == 1
+
+    # The part connections are closed once the full sync completes, and stable sync goes on
+    clients = await c_master.client_list()
+    assert not [c for c in clients if c["name"].startswith("repl_flow_part_")]
+    await c_master.set("after_parts_closed", "1")
+    await check_all_replicas_finished([c_replica], c_master)
+    assert await c_replica.get("after_parts_closed") == "1"
+
+    await disconnect_clients(c_master, c_replica)
+
+
+"""
+Test multi stream full sync of a dataset much larger than the socket buffers under constant writes.
+Journal changes must not block the flow connection while the replica waits for the parts.
+"""
+
+
+@pytest.mark.opt_only
+async def test_replication_multi_stream_full_sync_writes(df_local_factory: DflyInstanceFactory):
+    master = df_local_factory.create(proactor_threads=2)
+    replica = df_local_factory.create(proactor_threads=2, replica_full_sync_streams=4)
+
+    df_local_factory.start_all([master, replica])
+    c_master = master.client()
+    c_replica = replica.client()
+
+    # About 500MB, so the full sync takes a while
+    await c_master.execute_command("DEBUG POPULATE 500000 key 1000")
+
+    stop_writes = False
+
+    async def write_loop():
+        i = 0
+        while not stop_writes:
+            await c_master.set(f"written:{i}", i)
+            await c_master.incr("counter")
+            i += 1
+
+    write_task = asyncio.create_task(write_loop())
+    await asyncio.sleep(0.1)
+
+    await c_replica.execute_command(f"REPLICAOF localhost {master.port}")
+    async with async_timeout.timeout(120):
+        await wait_for_replicas_state(c_replica)
+
+    stop_writes = True
+    await write_task
+
+    await check_all_replicas_finished([c_replica], c_master, timeout=60)
+    assert await c_replica.dbsize() == await c_master.dbsize()
+    assert await c_replica.get("counter") == await c_master.get("counter")
+
+    await disconnect_clients(c_master, c_replica)
+
+
+@pytest.mark.parametrize("t_master, t_replica, workers", [(4, 4, 4), (2, 4, 8)])
+async def test_replication_parallel_apply(
+    df_local_factory: DflyInstanceFactory, t_master, t_replica, workers
+):
+    master = df_local_factory.create(proactor_threads=t_master)
+    replica = df_local_factory.create(proactor_threads=t_replica, replica_apply_workers=workers)
+
+    df_local_factory.start_all([master, replica])
+    c_master = master.client()
+    c_replica = replica.client()
+
+    await c_replica.execute_command(f"REPLICAOF localhost {master.port}")
+    async with async_timeout.timeout(20):
+        await wait_for_replicas_state(c_replica)
+
+    # All the changes arrive during stable sync, so they are applied by the parallel workers.
+    seeder = SeederV2(key_target=20_000)
+    await seeder.run(c_master, target_deviation=0.01)
+
+    stream_task = asyncio.create_task(seeder.run(c_master))
+    await asyncio.sleep(1.0)
+    await seeder.stop(c_master)
+    await stream_task
+
+    await check_all_replicas_finished([c_replica], c_master)
+    hashes = await asyncio.gather(*(SeederV2.capture(c) for c in [c_master, c_replica]))
+    assert len(set(hashes)) == 1
+
+    await disconnect_clients(c_master, c_replica)
+
+
+async def test_replication_batched_compressed_journal(df_local_factory: DflyInstanceFactory):
+    master = df_local_factory.create(
+        proactor_threads=4, journal_stream_batch_usec=1000, journal_stream_compression=True
+    )
+    replica = df_local_factory.create(proactor_threads=2)
+
+    df_local_factory.start_all([master, replica])
+    c_master = master.client()
+    c_replica = replica.client()
+
+    await c_replica.execute_command(f"REPLICAOF localhost {master.port}")
+    async with async_timeout.timeout(20):
+        await wait_for_replicas_state(c_replica)
+
+    seeder = SeederV2(key_target=20_000)
+    await seeder.run(c_master, target_deviation=0.01)
+
+    await check_all_replicas_finished([c_replica], c_master)
+    hashes = await asyncio.gather(*(SeederV2.capture(c) for c in [c_master, c_replica]))
+    assert len(set(hashes)) == 1
+
+    info = await c_master.info("replication")
+    assert info["journal_stream_sent_bytes"] < info["journal_stream_bytes"]
+
+    await disconnect_clients(c_master, c_replica)
+
+
 async def check_replica_finished_exec(c_replica: aioredis.Redis, m_offset):
     role = await c_replica.role()
     if role[0] != "replica" or role[3] != "stable_sync":
@@ -1147,6 +1292,53 @@ async def test_readonly_script(df_local_factory):
         assert "READONLY " in str(roe)
 
 
+FUNCTION_LIBRARY = """#!lua name=synced
+redis.register_function('set_key', function(keys, args)
+  return redis.call('SET', keys[1], args[1])
+end)
+redis.register_function{function_name='get_key', flags={'no-writes'}, callback=function(keys)
+  return redis.call('GET', keys[1])
+end}
+"""
+
+JOURNAL_LIBRARY = """#!lua name=streamed
+redis.register_function{function_name='echo', flags={'no-writes'}, callback=function(keys, args)
+  return args[1]
+end}
+"""
+
+
+@pytest.mark.asyncio
+async def test_functions(df_local_factory):
+    master = df_local_factory.create(proactor_threads=2)
+    replica = df_local_factory.create(proactor_threads=2)
+
+    df_local_factory.start_all([master, replica])
+
+    c_master = master.client()
+    c_replica = replica.client()
+
+    # Loaded before the replica connects, so the library arrives with the full sync.
+    assert await c_master.execute_command("FUNCTION LOAD", FUNCTION_LIBRARY) == "synced"
+
+    await c_replica.execute_command(f"REPLICAOF localhost {master.port}")
+    await wait_available_async(c_replica)
+
+    # Loaded after the full sync, so the library arrives through the journal.
+    assert await c_master.execute_command("FUNCTION LOAD", JOURNAL_LIBRARY) == "streamed"
+    await c_master.execute_command("FCALL", "set_key", 1, "key", "value")
+    await check_all_replicas_finished([c_replica], c_master)
+
+    assert await c_replica.execute_command("FCALL_RO", "get_key", 1, "key") == "value"
+    assert await c_replica.execute_command("FCALL_RO", "echo", 0, "hello") == "hello"
+
+    try:
+        await c_replica.execute_command("FCALL", "set_key", 1, "key", "other")
+        assert False
+    except aioredis.ResponseError as roe:
+        assert "READONLY " in str(roe)
+
+
 take_over_cases = [
     [2, 2],
     [2, 4],
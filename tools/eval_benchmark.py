@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+
+import argparse
+import multiprocessing
+import time
+import redis
+from urllib.parse import urlparse
+
+'''
+Run EVAL benchmark for a read-mostly script: it reads N keys and writes the sum into one more key.
+The same script is run in every script mode, so their cost can be compared:
+    shardlocal - all the keys belong to one shard, the script runs inside its thread
+    lockahead  - the keys are spread across shards, the script is coordinated by the connection
+    nonatomic  - the keys belong to one shard, but the script runs with disable-atomicity
+    global     - the keys belong to one shard, but the script runs with allow-undeclared-keys
+    multiexec  - the same reads and write in MULTI/EXEC instead of a script, run the server with
+                 different --multi_exec_mode values to compare them
+Keys that belong to one shard are built with hashtags, so the server must run with
+--lock_on_hashtags (or in cluster mode) for shardlocal, nonatomic and global modes.
+The eval_*_coordination counters of INFO are printed to verify which path was taken.
+'''
+
+SCRIPT = '''
+local sum = 0
+for i = 1, #KEYS - 1 do
+  sum = sum + tonumber(redis.call('GET', KEYS[i]) or 0)
+end
+redis.call('SET', KEYS[#KEYS], sum)
+return sum
+'''
+
+FLAGS = {
+    'shardlocal': '',
+    'lockahead': '',
+    'nonatomic': '#!lua flags=disable-atomicity\n',
+    'global': '#!lua flags=allow-undeclared-keys\n',
+    'multiexec': '',
+}
+
+
+def make_keys(mode, worker, i, num_keys):
+    if mode == 'lockahead':
+        return [f'eval-{worker}-{i}-{k}' for k in range(num_keys + 1)]
+    return [f'{{eval-{worker}-{i}}}-{k}' for k in range(num_keys + 1)]
+
+
+def run_worker(ctx):
+    r = redis.StrictRedis(host=ctx['host'], port=ctx['port'])
+    sha = r.script_load(FLAGS[ctx['mode']] + SCRIPT)
+    worker, count, num_keys = ctx['worker'], ctx['count'], ctx['keys']
+
+    for i in range(ctx['groups']):
+        keys = make_keys(ctx['mode'], worker, i, num_keys)
+        r.mset({k: 1 for k in keys[:-1]})
+
+    s0 = time.time()
+    for i in range(count):
+        keys = make_keys(ctx['mode'], worker, i % ctx['groups'], num_keys)
+        if ctx['mode'] == 'multiexec':
+            p = r.pipeline(transaction=True)
+            for k in keys[:-1]:
+                p.get(k)
+            p.set(keys[-1], num_keys)
+            p.execute()
+        else:
+            r.evalsha(sha, len(keys), *keys)
+    return time.time() - s0
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='EVAL Benchmark',
+                                     formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument('-c', '--count', type=int, default=100000, help='total number of scripts')
+    parser.add_argument('-k', '--keys', type=int, default=10, help='number of keys read by a script')
+    parser.add_argument('-g', '--groups', type=int, default=1000, help='key groups per worker')
+    parser.add_argument('-w', '--workers', type=int, default=8, help='number of worker processes')
+    parser.add_argument('-m', '--modes', type=str, default='shardlocal,lockahead,nonatomic,global,multiexec',
+                        help='comma separated script modes to run')
+    parser.add_argument('-u', '--uri', type=str, default='redis://localhost:6379',
+                        help='Redis server URI')
+    args = parser.parse_args()
+    uri = urlparse(args.uri)
+
+    r = redis.Redis(host=uri.hostname, port=uri.port)
+    pool = multiprocessing.Pool(args.workers)
+    print(f'Count: {args.count}, Keys: {args.keys}, Workers: {args.workers}')
+
+    for mode in args.modes.split(','):
+        before = r.info('transaction')
+        ctxs = [{
+            'mode': mode,
+            'worker': w,
+            'count': args.count // args.workers,
+            'keys': args.keys,
+            'groups': args.groups,
+            'host': uri.hostname,
+            'port': uri.port,
+        } for w in range(args.workers)]
+
+        # Workers run in parallel, so the slowest one defines the runtime.
+        s1 = max(pool.map(run_worker, ctxs))
+
+        after = r.info('transaction')
+        counters = {name: after.get(name, 0) - before.get(name, 0)
+                    for name in ('eval_io_coordination_total',
+                                 'eval_shardlocal_coordination_total')}
+        print(f'{mode}: {round(args.count / s1, 2):,} scripts per second, {counters}')
@@ -19,7 +19,9 @@ We want to the overall time it takes
 to save and access keys that contains
 JSON values with this benchmark.
 This also verify that the basic functionalities
-for using JSON types work correctly
+for using JSON types work correctly.
+The memory used by the keys is reported as well, so running it
+with and without --experimental_flat_json compares the encodings.
 '''
 
 def ping(r):
@@ -117,6 +119,7 @@ if __name__ == '__main__':
     print (f'Using hireds: {redis.utils.HIREDIS_AVAILABLE}')
     print (f'Runtime: {round(s1, 2):,} seconds')
     print (f'Throughput: {round(count/s1, 2):,} requests per second')
+    print (f'Used memory: {r.info("memory")["used_memory"]:,} bytes')
     for k, v in sorted(agg.items()):
         perc = 100.0 * v / count
         print (f'{perc:.4f}% <= {k:,} milliseconds')